@@ -0,0 +1,106 @@
+//
+// Copyright (c) 2014 Jakub Jabłoński
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "mfbench.h"
+
+static void usage(const char* argv0)
+{
+	std::fprintf(stderr, "usage: %s [--csv] [--min-time=seconds] [filter...]\n", argv0);
+}
+
+int main(int argc, char **argv)
+{
+	bool csv = false;
+	double min_time = 0.2;
+	std::vector<const char*> filters;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (!std::strcmp(argv[i], "--csv"))
+		{
+			csv = true;
+		}
+		else if (!std::strncmp(argv[i], "--min-time=", 11))
+		{
+			min_time = std::atof(argv[i] + 11);
+		}
+		else if (argv[i][0] == '-')
+		{
+			usage(argv[0]);
+			return 1;
+		}
+		else
+		{
+			filters.push_back(argv[i]);
+		}
+	}
+
+	if (csv)
+	{
+		std::printf("name,iterations,ns_per_iteration,items_per_second,bytes_per_second,counters\n");
+	}
+	else
+	{
+		std::printf("%-60s %14s %14s %12s\n", "benchmark", "ns/iter", "items/s", "MB/s");
+	}
+
+	for (std::size_t i = 0; i < mfbench::registry().size(); ++i)
+	{
+		const mfbench::entry& e = mfbench::registry()[i];
+		bool selected = filters.empty();
+		for (std::size_t f = 0; f < filters.size(); ++f)
+		{
+			selected = selected || std::strstr(e.name, filters[f]);
+		}
+		if (!selected)
+		{
+			continue;
+		}
+
+		mfbench b(e.name, min_time);
+		e.fn(b);
+		for (std::size_t r = 0; r < b.results().size(); ++r)
+		{
+			const mfbench::result& x = b.results()[r];
+			if (csv)
+			{
+				std::printf("%s,%zu,%.3f,%.1f,%.1f,", x.name.c_str(), x.iterations, x.ns_per_iteration,
+				            x.items_per_second, x.bytes_per_second);
+			}
+			else
+			{
+				std::printf("%-60s %14.1f %14.4g %12.1f", x.name.c_str(), x.ns_per_iteration,
+				            x.items_per_second, x.bytes_per_second / 1e6);
+			}
+			for (std::size_t c = 0; c < x.counters.size(); ++c)
+			{
+				const char* separator = csv ? (c ? ";" : "") : " ";
+				std::printf(csv ? "%s%s=%g" : "%s%s=%.4g", separator, x.counters[c].first.c_str(), x.counters[c].second);
+			}
+			std::printf("\n");
+			std::fflush(stdout);
+		}
+	}
+	return 0;
+}
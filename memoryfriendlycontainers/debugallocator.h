@@ -3,8 +3,10 @@
 #ifndef DEBUGALLOCATOR_H
 #define DEBUGALLOCATOR_H
 
-#include <iostream>
-#include <iomanip>
+#include <cstddef>
+#include <new>
+
+#include "mftrackingallocator.h"
 
 /* =======================================================
  * = .
@@ -66,9 +68,9 @@ public:
     // allocate but don't initialize num elements of type T
     pointer allocate (size_type num, const void* = 0)
     {
-        // print message and allocate memory with global new
+        // count the call (see mftracking_report) and allocate memory with global new
         pointer ret = (pointer)(::operator new(num*sizeof(T)));
-        std::cerr << "DebugAllocator at " << this << ": allocated " << num << " element(s)" << " of size " << sizeof(T) << " at " << (void*)ret << std::endl;
+        mftracking_allocated(mftracking_key<T>(), num*sizeof(T));
         return ret;
     }
     
@@ -89,8 +91,8 @@ public:
     // deallocate storage p of deleted elements
     void deallocate (pointer p, size_type num)
     {
-        // print message and deallocate memory with global delete
-        std::cerr << "DebugAllocator at " << this << ": deallocate " << num << " element(s)" << " of size " << sizeof(T) << " at " << (void*)p << std::endl;
+        // count the call and deallocate memory with global delete
+        mftracking_freed(mftracking_key<T>(), num*sizeof(T));
         ::operator delete((void*)p);
     }
 };
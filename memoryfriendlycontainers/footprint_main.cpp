@@ -0,0 +1,229 @@
+//
+// Copyright (c) 2014 Jakub Jabłoński
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "mfbitvector.h"
+#include "mfflatmap.h"
+#include "mffootprint.h"
+#include "mfhashmapsc.h"
+#include "mfpackedvector.h"
+#include "mfringbuffer.h"
+#include "mfsegvector.h"
+#include "mfsoavector.h"
+#include "mfvector.h"
+
+/*
+ * Prints where the bytes go for common container instantiations holding the
+ * same number of elements, so that the densest layout can be picked.
+ */
+
+static bool csv = false;
+
+static void usage(const char* argv0)
+{
+	std::fprintf(stderr, "usage: %s [--csv] [elements]\n", argv0);
+}
+
+static void heading(const char* title)
+{
+	if (csv)
+	{
+		return;
+	}
+	std::printf("\n%s\n", title);
+	std::printf("%-36s %10s %8s %10s %9s %9s %9s %9s %6s %9s\n", "container", "total", "B/elem", "payload", "padding",
+	            "links", "buckets", "unused", "header", "allocator");
+}
+
+static void row(const char* name, const mffootprint& f)
+{
+	if (csv)
+	{
+		std::printf("%s,%zu,%zu,%zu,%zu,%zu,%zu,%zu,%zu,%zu,%zu\n", name, f.elements, f.total(), f.payload, f.padding,
+		            f.links, f.empty_buckets, f.unused, f.header, f.allocator, f.allocations);
+		return;
+	}
+	std::printf("%-36s %10zu %8.2f %10zu %9zu %9zu %9zu %9zu %6zu %9zu\n", name, f.total(), f.bytes_per_element(),
+	            f.payload, f.padding, f.links, f.empty_buckets, f.unused, f.header, f.allocator);
+}
+
+/** Maps from int keys: chained hash maps at full and half load, flat maps, vectors of pairs and columns. */
+template<typename V>
+static void maps(const char* value_name, std::size_t n)
+{
+	char title[128];
+	std::snprintf(title, sizeof(title), "int -> %s: sizeof/alignment %zu/%zu, %zu elements", value_name, sizeof(V),
+	              std::alignment_of<V>::value, n);
+	heading(title);
+
+	std::vector<std::pair<int, V> > sorted;
+	for (std::size_t i = 0; i < n; ++i)
+	{
+		sorted.push_back(std::make_pair(int(i), V()));
+	}
+
+	char name[128];
+	for (std::size_t load = 1; load <= 2; ++load)
+	{
+		mfhashmapsc<int, V> m(n * load);
+		for (std::size_t i = 0; i < n; ++i)
+		{
+			m.insert(int(i), V());
+		}
+		std::snprintf(name, sizeof(name), "mfhashmapsc<int, %s> %s", value_name, load == 1 ? "full" : "half");
+		row(name, m.memory_footprint());
+	}
+
+	mfflatmap<int, V> flat(sorted.begin(), sorted.end());
+	std::snprintf(name, sizeof(name), "mfflatmap<int, %s>", value_name);
+	row(name, flat.memory_footprint());
+
+	mfflatmap<int, V, mfflatmap_eytzinger> eytzinger(sorted.begin(), sorted.end());
+	std::snprintf(name, sizeof(name), "mfflatmap<int, %s, eytzinger>", value_name);
+	row(name, eytzinger.memory_footprint());
+
+	mfvector<std::pair<int, V> > pairs(n);
+	for (std::size_t i = 0; i < n; ++i)
+	{
+		pairs.push_back(sorted[i]);
+	}
+	std::snprintf(name, sizeof(name), "mfvector<pair<int, %s>>", value_name);
+	mffootprint f = pairs.memory_footprint();
+	// The vector only sees whole pairs; split them like the maps do.
+	f.padding = n * (sizeof(std::pair<int, V>) - sizeof(int) - sizeof(V));
+	f.payload -= f.padding;
+	row(name, f);
+
+	mfsoavector<int, V> columns(n);
+	for (std::size_t i = 0; i < n; ++i)
+	{
+		columns.push_back(int(i), V());
+	}
+	std::snprintf(name, sizeof(name), "mfsoavector<int, %s>", value_name);
+	row(name, columns.memory_footprint());
+}
+
+/** Sequences of T: one block, segments, a ring. */
+template<typename T>
+static void sequences(const char* type_name, std::size_t n)
+{
+	char title[128];
+	std::snprintf(title, sizeof(title), "%s: sizeof/alignment %zu/%zu, %zu elements", type_name, sizeof(T),
+	              std::alignment_of<T>::value, n);
+	heading(title);
+
+	char name[128];
+	mfvector<T, mfgrowth_geometric> v;
+	for (std::size_t i = 0; i < n; ++i)
+	{
+		v.push_back(T());
+	}
+	std::snprintf(name, sizeof(name), "mfvector<%s> grown", type_name);
+	row(name, v.memory_footprint());
+
+	mfsegvector<T, 10> seg;
+	for (std::size_t i = 0; i < n; ++i)
+	{
+		seg.push_back(T());
+	}
+	std::snprintf(name, sizeof(name), "mfsegvector<%s, 10>", type_name);
+	row(name, seg.memory_footprint());
+
+	mfringbuffer<T> ring(n);
+	for (std::size_t i = 0; i < n; ++i)
+	{
+		ring.try_push(T());
+	}
+	std::snprintf(name, sizeof(name), "mfringbuffer<%s>", type_name);
+	row(name, ring.memory_footprint());
+}
+
+/** Small integers: bits, packed and plain vectors. */
+static void bits(std::size_t n)
+{
+	char title[128];
+	std::snprintf(title, sizeof(title), "small integers, %zu elements", n);
+	heading(title);
+
+	mfbitvector b(n);
+	for (std::size_t i = 0; i < n; ++i)
+	{
+		b.push_back(i & 1);
+	}
+	row("mfbitvector", b.memory_footprint());
+	b.build_rank_index();
+	row("mfbitvector with rank index", b.memory_footprint());
+
+	mfvector<bool> flags(n);
+	flags.resize(n);
+	row("mfvector<bool>", flags.memory_footprint());
+
+	mfpackedvector<12> packed(n);
+	for (std::size_t i = 0; i < n; ++i)
+	{
+		packed.push_back(std::uint32_t(i & 0xfff));
+	}
+	row("mfpackedvector<12>", packed.memory_footprint());
+
+	mfvector<std::uint16_t> shorts(n);
+	shorts.resize(n);
+	row("mfvector<uint16_t>", shorts.memory_footprint());
+}
+
+int main(int argc, char **argv)
+{
+	std::size_t n = 100000;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (!std::strcmp(argv[i], "--csv"))
+		{
+			csv = true;
+		}
+		else if (argv[i][0] >= '0' && argv[i][0] <= '9')
+		{
+			n = std::strtoul(argv[i], 0, 10);
+		}
+		else
+		{
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (csv)
+	{
+		std::printf("container,elements,total,payload,padding,links,empty_buckets,unused,header,allocator,allocations\n");
+	}
+	maps<char>("char", n);
+	maps<int>("int", n);
+	maps<double>("double", n);
+	sequences<int>("int", n);
+	sequences<double>("double", n);
+	bits(n);
+	return 0;
+}
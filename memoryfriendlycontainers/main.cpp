@@ -19,10 +19,7 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 // THE SOFTWARE.
 
-#include <iostream>
 #include <vector>
-#include <type_traits>
-#include <unordered_map>
 
 #include "mfvector.h"
 #include "mfhashmapsc.h"
@@ -30,12 +27,6 @@
 #include "gtest/gtest.h"
 #include "debugallocator.h"
 
-template<typename T>
-void type_size_alignment(const char *n)
-{
-	std::cout << "sizeof/alignment of " << n << ": " << sizeof(T) << " / " << std::alignment_of<T>::value << std::endl;
-}
-
 int main(int argc, char **argv)
 {
     ::testing::InitGoogleTest(&argc, argv);
@@ -0,0 +1,169 @@
+//
+// Copyright (c) 2014 Jakub Jabłoński
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef memoryfriendlycontainers_mfbench_h
+#define memoryfriendlycontainers_mfbench_h
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * Minimal benchmark harness. Benchmarks are defined with MFBENCH and time
+ * code with mfbench::run, which repeats it until min_time has passed:
+ *
+ * MFBENCH(vector_sum)
+ * {
+ *     ...
+ *     b.run("sum/1000", 1000, 4000, [&] { mfbench_keep(mfsum(first, last)); });
+ * }
+ *
+ * bench_main.cpp runs all benchmarks whose name contains the filter given on
+ * the command line and prints a table, or CSV with --csv.
+ */
+class mfbench
+{
+public:
+	struct result
+	{
+		std::string name;
+		std::size_t iterations;
+		double ns_per_iteration;
+		double items_per_second;
+		double bytes_per_second;
+		std::vector<std::pair<std::string, double> > counters;
+
+		/** Attaches another measured quantity, e.g. bytes per entry. */
+		result& counter(const std::string& counter_name, double value)
+		{
+			counters.push_back(std::make_pair(counter_name, value));
+			return *this;
+		}
+	};
+
+	typedef void (*function)(mfbench& b);
+
+	struct entry
+	{
+		const char* name;
+		function fn;
+	};
+
+	static std::vector<entry>& registry()
+	{
+		static std::vector<entry> entries;
+		return entries;
+	}
+
+	explicit mfbench(const char* name, double min_time = 0.2) : name_(name), min_time_(min_time)
+	{}
+
+	/**
+	 * Times f, where one call processes the given number of items and bytes
+	 * (0 if not meaningful), and records the result as "<benchmark>/<label>".
+	 */
+	template<typename F>
+	result& run(const std::string& label, std::size_t items, std::size_t bytes, F f)
+	{
+		typedef std::chrono::steady_clock clock;
+		f(); // warm up caches and lazily initialized state
+		std::size_t n = 1;
+		double elapsed = 0;
+		for (;;)
+		{
+			clock::time_point start = clock::now();
+			for (std::size_t i = 0; i < n; ++i)
+			{
+				f();
+			}
+			elapsed = std::chrono::duration<double>(clock::now() - start).count();
+			if (elapsed >= min_time_ || n >= (std::size_t(1) << 40))
+			{
+				break;
+			}
+			n = elapsed > 0 ? std::size_t(n * std::min(100.0, 1.4 * min_time_ / elapsed)) + 1 : n * 100;
+		}
+		result r;
+		r.name = std::string(name_) + "/" + label;
+		r.iterations = n;
+		r.ns_per_iteration = elapsed * 1e9 / n;
+		r.items_per_second = items * n / elapsed;
+		r.bytes_per_second = bytes * n / elapsed;
+		results_.push_back(r);
+		return results_.back();
+	}
+
+	/** Records a value measured by the benchmark itself. */
+	result& report(const std::string& label, double ns_per_iteration, std::size_t items = 0, std::size_t bytes = 0)
+	{
+		result r;
+		r.name = std::string(name_) + "/" + label;
+		r.iterations = 1;
+		r.ns_per_iteration = ns_per_iteration;
+		r.items_per_second = ns_per_iteration > 0 ? items * 1e9 / ns_per_iteration : 0;
+		r.bytes_per_second = ns_per_iteration > 0 ? bytes * 1e9 / ns_per_iteration : 0;
+		results_.push_back(r);
+		return results_.back();
+	}
+
+	const std::vector<result>& results() const
+	{
+		return results_;
+	}
+
+private:
+	const char* name_;
+	double min_time_;
+	std::vector<result> results_;
+};
+
+struct mfbench_registrar
+{
+	mfbench_registrar(const char* name, mfbench::function fn)
+	{
+		mfbench::entry e = { name, fn };
+		mfbench::registry().push_back(e);
+	}
+};
+
+#define MFBENCH(name) \
+	static void mfbench_##name(mfbench& b); \
+	static mfbench_registrar mfbench_registrar_##name(#name, mfbench_##name); \
+	static void mfbench_##name(mfbench& b)
+
+/** Keeps the compiler from optimizing away the computation of x. */
+template<typename T>
+inline void mfbench_keep(const T& x)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	__asm__ __volatile__("" : : "g"(&x) : "memory");
+#else
+	static volatile const void* sink;
+	sink = &x;
+#endif
+}
+
+#endif
@@ -0,0 +1,641 @@
+//
+// Copyright (c) 2014 Jakub Jabłoński
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef memoryfriendlycontainers_mfbitvector_h
+#define memoryfriendlycontainers_mfbitvector_h
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+#include <ostream>
+
+#include "mffootprint.h"
+#include "mfsimd.h"
+#include "mfvector.h"
+
+/**
+ * Word kernels of mfbitvector. count() and the bulk operations go through
+ * mfbits_count/mfbits_apply/mfbits_find, which pick the AVX2, SSE2 or
+ * scalar kernel by mfsimd_level().
+ */
+
+enum mfbits_op
+{
+	mfbits_and,
+	mfbits_or,
+	mfbits_xor
+};
+
+struct mfbits_scalar
+{
+	static std::size_t count(const std::uint64_t* p, std::size_t n)
+	{
+		std::size_t c = 0;
+		for (std::size_t i = 0; i < n; ++i)
+		{
+			c += __builtin_popcountll(p[i]);
+		}
+		return c;
+	}
+
+	static void apply(mfbits_op op, std::uint64_t* a, const std::uint64_t* b, std::size_t n)
+	{
+		switch (op)
+		{
+			case mfbits_and:
+				for (std::size_t i = 0; i < n; ++i)
+				{
+					a[i] &= b[i];
+				}
+				break;
+			case mfbits_or:
+				for (std::size_t i = 0; i < n; ++i)
+				{
+					a[i] |= b[i];
+				}
+				break;
+			case mfbits_xor:
+				for (std::size_t i = 0; i < n; ++i)
+				{
+					a[i] ^= b[i];
+				}
+				break;
+		}
+	}
+
+	/** Index of the first non-zero word, or n. */
+	static std::size_t find(const std::uint64_t* p, std::size_t n)
+	{
+		std::size_t i = 0;
+		while (i < n && !p[i])
+		{
+			++i;
+		}
+		return i;
+	}
+
+	/** Set bits in the n words at p and in p[n] & mask. */
+	static std::size_t rank(const std::uint64_t* p, std::size_t n, std::uint64_t mask)
+	{
+		return count(p, n) + (mask ? __builtin_popcountll(p[n] & mask) : 0);
+	}
+
+	/** Position of the k-th (from 0) set bit in the n words at p, or n * 64. */
+	static std::size_t select(const std::uint64_t* p, std::size_t n, std::size_t k)
+	{
+		for (std::size_t w = 0; w < n; ++w)
+		{
+			std::size_t c = __builtin_popcountll(p[w]);
+			if (k < c)
+			{
+				std::uint64_t x = p[w];
+				while (k--)
+				{
+					x &= x - 1;
+				}
+				return w * 64 + __builtin_ctzll(x);
+			}
+			k -= c;
+		}
+		return n * 64;
+	}
+};
+
+#if MFSIMD_X86
+
+/**
+ * SSE2 kernels, two words per step; popcount by adding bit pairs, nibbles
+ * and bytes in the register, as SSE2 machines may lack popcnt.
+ */
+struct mfbits_sse2
+{
+	static MFSIMD_SSE2 std::size_t count(const std::uint64_t* p, std::size_t n)
+	{
+		const __m128i m1 = _mm_set1_epi8(0x55);
+		const __m128i m2 = _mm_set1_epi8(0x33);
+		const __m128i m4 = _mm_set1_epi8(0x0f);
+		__m128i total = _mm_setzero_si128();
+		std::size_t i = 0;
+		for (; i + 2 <= n; i += 2)
+		{
+			__m128i x = _mm_loadu_si128((const __m128i*) (p + i));
+			x = _mm_sub_epi8(x, _mm_and_si128(_mm_srli_epi64(x, 1), m1));
+			x = _mm_add_epi8(_mm_and_si128(x, m2), _mm_and_si128(_mm_srli_epi64(x, 2), m2));
+			x = _mm_and_si128(_mm_add_epi8(x, _mm_srli_epi64(x, 4)), m4);
+			total = _mm_add_epi64(total, _mm_sad_epu8(x, _mm_setzero_si128()));
+		}
+		std::uint64_t l[2];
+		_mm_storeu_si128((__m128i*) l, total);
+		return l[0] + l[1] + mfbits_scalar::count(p + i, n - i);
+	}
+
+	static MFSIMD_SSE2 void apply(mfbits_op op, std::uint64_t* a, const std::uint64_t* b, std::size_t n)
+	{
+		std::size_t i = 0;
+		for (; i + 2 <= n; i += 2)
+		{
+			__m128i x = _mm_loadu_si128((const __m128i*) (a + i));
+			__m128i y = _mm_loadu_si128((const __m128i*) (b + i));
+			x = op == mfbits_and ? _mm_and_si128(x, y) : op == mfbits_or ? _mm_or_si128(x, y) : _mm_xor_si128(x, y);
+			_mm_storeu_si128((__m128i*) (a + i), x);
+		}
+		mfbits_scalar::apply(op, a + i, b + i, n - i);
+	}
+
+	static MFSIMD_SSE2 std::size_t find(const std::uint64_t* p, std::size_t n)
+	{
+		std::size_t i = 0;
+		for (; i + 2 <= n; i += 2)
+		{
+			__m128i x = _mm_loadu_si128((const __m128i*) (p + i));
+			if (_mm_movemask_epi8(_mm_cmpeq_epi8(x, _mm_setzero_si128())) != 0xffff)
+			{
+				break;
+			}
+		}
+		return i + mfbits_scalar::find(p + i, n - i);
+	}
+};
+
+/**
+ * AVX2 kernels, four words per step; popcount with a nibble lookup table
+ * in vpshufb, single words with popcnt, select with pdep.
+ */
+struct mfbits_avx2
+{
+	static MFSIMD_AVX2 std::size_t count(const std::uint64_t* p, std::size_t n)
+	{
+		const __m256i table = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+		                                       0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+		const __m256i low = _mm256_set1_epi8(0x0f);
+		__m256i total = _mm256_setzero_si256();
+		std::size_t i = 0;
+		for (; i + 4 <= n; i += 4)
+		{
+			__m256i x = _mm256_loadu_si256((const __m256i*) (p + i));
+			__m256i c = _mm256_add_epi8(_mm256_shuffle_epi8(table, _mm256_and_si256(x, low)),
+			                            _mm256_shuffle_epi8(table, _mm256_and_si256(_mm256_srli_epi16(x, 4), low)));
+			total = _mm256_add_epi64(total, _mm256_sad_epu8(c, _mm256_setzero_si256()));
+		}
+		std::uint64_t l[4];
+		_mm256_storeu_si256((__m256i*) l, total);
+		std::size_t c = l[0] + l[1] + l[2] + l[3];
+		for (; i < n; ++i)
+		{
+			c += _mm_popcnt_u64(p[i]);
+		}
+		return c;
+	}
+
+	static MFSIMD_AVX2 void apply(mfbits_op op, std::uint64_t* a, const std::uint64_t* b, std::size_t n)
+	{
+		std::size_t i = 0;
+		for (; i + 4 <= n; i += 4)
+		{
+			__m256i x = _mm256_loadu_si256((const __m256i*) (a + i));
+			__m256i y = _mm256_loadu_si256((const __m256i*) (b + i));
+			x = op == mfbits_and ? _mm256_and_si256(x, y) : op == mfbits_or ? _mm256_or_si256(x, y) : _mm256_xor_si256(x, y);
+			_mm256_storeu_si256((__m256i*) (a + i), x);
+		}
+		mfbits_scalar::apply(op, a + i, b + i, n - i);
+	}
+
+	static MFSIMD_AVX2 std::size_t find(const std::uint64_t* p, std::size_t n)
+	{
+		std::size_t i = 0;
+		for (; i + 4 <= n; i += 4)
+		{
+			__m256i x = _mm256_loadu_si256((const __m256i*) (p + i));
+			if (!_mm256_testz_si256(x, x))
+			{
+				break;
+			}
+		}
+		return i + mfbits_scalar::find(p + i, n - i);
+	}
+
+	static MFSIMD_AVX2 std::size_t rank(const std::uint64_t* p, std::size_t n, std::uint64_t mask)
+	{
+		std::size_t c = 0;
+		for (std::size_t i = 0; i < n; ++i)
+		{
+			c += _mm_popcnt_u64(p[i]);
+		}
+		return c + (mask ? _mm_popcnt_u64(p[n] & mask) : 0);
+	}
+
+	static MFSIMD_AVX2 std::size_t select(const std::uint64_t* p, std::size_t n, std::size_t k)
+	{
+		for (std::size_t w = 0; w < n; ++w)
+		{
+			std::size_t c = _mm_popcnt_u64(p[w]);
+			if (k < c)
+			{
+				return w * 64 + _tzcnt_u64(_pdep_u64(std::uint64_t(1) << k, p[w]));
+			}
+			k -= c;
+		}
+		return n * 64;
+	}
+};
+
+#endif
+
+inline std::size_t mfbits_count(const std::uint64_t* p, std::size_t n)
+{
+#if MFSIMD_X86
+	switch (mfsimd_level())
+	{
+		case mfsimd_avx2:
+			return mfbits_avx2::count(p, n);
+		case mfsimd_sse2:
+			return mfbits_sse2::count(p, n);
+		default:
+			break;
+	}
+#endif
+	return mfbits_scalar::count(p, n);
+}
+
+inline void mfbits_apply(mfbits_op op, std::uint64_t* a, const std::uint64_t* b, std::size_t n)
+{
+#if MFSIMD_X86
+	switch (mfsimd_level())
+	{
+		case mfsimd_avx2:
+			return mfbits_avx2::apply(op, a, b, n);
+		case mfsimd_sse2:
+			return mfbits_sse2::apply(op, a, b, n);
+		default:
+			break;
+	}
+#endif
+	mfbits_scalar::apply(op, a, b, n);
+}
+
+inline std::size_t mfbits_find(const std::uint64_t* p, std::size_t n)
+{
+#if MFSIMD_X86
+	switch (mfsimd_level())
+	{
+		case mfsimd_avx2:
+			return mfbits_avx2::find(p, n);
+		case mfsimd_sse2:
+			return mfbits_sse2::find(p, n);
+		default:
+			break;
+	}
+#endif
+	return mfbits_scalar::find(p, n);
+}
+
+/*
+ * rank and select work on a few words, too few for SSE2 to pay off; only
+ * popcnt/pdep make a difference.
+ */
+
+inline std::size_t mfbits_rank(const std::uint64_t* p, std::size_t n, std::uint64_t mask)
+{
+#if MFSIMD_X86
+	if (mfsimd_level() == mfsimd_avx2)
+	{
+		return mfbits_avx2::rank(p, n, mask);
+	}
+#endif
+	return mfbits_scalar::rank(p, n, mask);
+}
+
+inline std::size_t mfbits_select(const std::uint64_t* p, std::size_t n, std::size_t k)
+{
+#if MFSIMD_X86
+	if (mfsimd_level() == mfsimd_avx2)
+	{
+		return mfbits_avx2::select(p, n, k);
+	}
+#endif
+	return mfbits_scalar::select(p, n, k);
+}
+
+/** Returned by the mfbitvector searches when there is no such bit. */
+static const std::size_t mfbitvector_npos = std::size_t(-1);
+
+class mfbitvector;
+std::ostream& operator<<(std::ostream&, const mfbitvector& v);
+
+/**
+ * Vector of bits packed 64 to a word, with capacity fixed at construction
+ * like mfvector: push_back on a full vector is a no-op.
+ *
+ * Bits past size() in the last word are kept zero, so count() and the
+ * searches work on whole words.
+ *
+ * build_rank_index() adds one 64-bit count per 512 bits (a cache line of
+ * words), making rank() O(1) and select() a binary search over the counts.
+ * The index describes the bits as they were when it was built.
+ */
+class mfbitvector
+{
+	friend std::ostream& operator<<(std::ostream& o, const mfbitvector& v);
+
+public:
+	static const std::size_t word_bits = 64;
+	static const std::size_t block_words = 8;
+
+	explicit mfbitvector(std::size_t capacity = 0) : words_(words_for(capacity)), capacity_(capacity), size_(0)
+	{}
+
+	std::size_t capacity() const
+	{
+		return capacity_;
+	}
+
+	std::size_t size() const
+	{
+		return size_;
+	}
+
+	bool empty() const
+	{
+		return size_ == 0;
+	}
+
+	bool test(std::size_t n) const
+	{
+		return (words_[n / word_bits] >> (n % word_bits)) & 1;
+	}
+
+	bool operator[](std::size_t n) const
+	{
+		return test(n);
+	}
+
+	void set(std::size_t n)
+	{
+		words_[n / word_bits] |= bit(n);
+	}
+
+	void set(std::size_t n, bool value)
+	{
+		std::uint64_t& w = words_[n / word_bits];
+		w = (w & ~bit(n)) | (std::uint64_t(value) << (n % word_bits));
+	}
+
+	void reset(std::size_t n)
+	{
+		words_[n / word_bits] &= ~bit(n);
+	}
+
+	void flip(std::size_t n)
+	{
+		words_[n / word_bits] ^= bit(n);
+	}
+
+	void push_back(bool value)
+	{
+		if (size_ < capacity_)
+		{
+			if (size_ % word_bits == 0)
+			{
+				words_.push_back(0);
+			}
+			set(size_++, value);
+		}
+	}
+
+	void pop_back()
+	{
+		if (size_ == 0)
+		{
+			return;
+		}
+		resize(size_ - 1);
+	}
+
+	/** Sets the size to n (at most the capacity); new bits get value. */
+	void resize(std::size_t n, bool value = false)
+	{
+		n = std::min(n, capacity_);
+		std::size_t old = size_;
+		if (n < old)
+		{
+			words_.resize(words_for(n));
+			size_ = n;
+			clear_tail();
+			return;
+		}
+		words_.resize(words_for(n), value ? ~std::uint64_t(0) : 0);
+		size_ = n;
+		if (old % word_bits)
+		{
+			std::uint64_t& w = words_[old / word_bits];
+			w = value ? w | (~std::uint64_t(0) << (old % word_bits)) : w;
+		}
+		clear_tail();
+	}
+
+	void clear()
+	{
+		words_.clear();
+		size_ = 0;
+	}
+
+	void set_all()
+	{
+		std::fill(words_.begin(), words_.end(), ~std::uint64_t(0));
+		clear_tail();
+	}
+
+	void reset_all()
+	{
+		std::fill(words_.begin(), words_.end(), 0);
+	}
+
+	/** Number of set bits. */
+	std::size_t count() const
+	{
+		return mfbits_count(words_.begin(), words_.size());
+	}
+
+	/** Position of the first set bit, or mfbitvector_npos. */
+	std::size_t find_first() const
+	{
+		return find_from_word(0);
+	}
+
+	/** Position of the first set bit after pos, or mfbitvector_npos. */
+	std::size_t find_next(std::size_t pos) const
+	{
+		std::size_t n = pos + 1;
+		if (n >= size_)
+		{
+			return mfbitvector_npos;
+		}
+		std::size_t w = n / word_bits;
+		std::uint64_t x = words_[w] & (~std::uint64_t(0) << (n % word_bits));
+		return x ? w * word_bits + __builtin_ctzll(x) : find_from_word(w + 1);
+	}
+
+	/*
+	 * Bulk operations over the common size; bits of a shorter rhs that are
+	 * missing count as zero.
+	 */
+
+	mfbitvector& operator&=(const mfbitvector& rhs)
+	{
+		std::size_t n = std::min(words_.size(), rhs.words_.size());
+		mfbits_apply(mfbits_and, words_.begin(), rhs.words_.begin(), n);
+		std::fill(words_.begin() + n, words_.end(), 0);
+		return *this;
+	}
+
+	mfbitvector& operator|=(const mfbitvector& rhs)
+	{
+		mfbits_apply(mfbits_or, words_.begin(), rhs.words_.begin(), std::min(words_.size(), rhs.words_.size()));
+		clear_tail();
+		return *this;
+	}
+
+	mfbitvector& operator^=(const mfbitvector& rhs)
+	{
+		mfbits_apply(mfbits_xor, words_.begin(), rhs.words_.begin(), std::min(words_.size(), rhs.words_.size()));
+		clear_tail();
+		return *this;
+	}
+
+	/** Builds (or rebuilds after changes) the index used by rank() and select(). */
+	void build_rank_index()
+	{
+		std::size_t blocks = words_.size() / block_words + 1;
+		rank_ = mfvector<std::uint64_t>(blocks);
+		std::uint64_t r = 0;
+		rank_.push_back(r);
+		for (std::size_t b = 1; b < blocks; ++b)
+		{
+			r += mfbits_count(words_.begin() + (b - 1) * block_words, block_words);
+			rank_.push_back(r);
+		}
+	}
+
+	bool has_rank_index() const
+	{
+		return rank_.size() != 0;
+	}
+
+	/** Number of set bits before position n; needs build_rank_index(). */
+	std::size_t rank(std::size_t n) const
+	{
+		std::size_t w = n / word_bits;
+		std::size_t b = w / block_words;
+		return rank_[b] + mfbits_rank(words_.begin() + b * block_words, w - b * block_words, bit(n) - 1);
+	}
+
+	/** Position of the k-th (from 0) set bit, or mfbitvector_npos; needs build_rank_index(). */
+	std::size_t select(std::size_t k) const
+	{
+		const std::uint64_t* b = std::upper_bound(rank_.begin(), rank_.end(), std::uint64_t(k)) - 1;
+		std::size_t w = (b - rank_.begin()) * block_words;
+		std::size_t n = std::min(std::size_t(block_words), words_.size() - w);
+		std::size_t pos = mfbits_select(words_.begin() + w, n, k - *b);
+		return pos < n * word_bits ? w * word_bits + pos : mfbitvector_npos;
+	}
+
+	const std::uint64_t* words() const
+	{
+		return words_.begin();
+	}
+
+	std::size_t word_count() const
+	{
+		return words_.size();
+	}
+
+	/** Bytes taken by the words; the rank index counts as links. */
+	mffootprint memory_footprint() const
+	{
+		mffootprint f;
+		mffootprint words = words_.memory_footprint();
+		mffootprint rank = rank_.memory_footprint();
+		f.elements = size_;
+		f.payload = (size_ + 7) / 8;
+		f.unused = words.payload + words.unused - f.payload;
+		f.links = rank.payload + rank.unused;
+		f.header = sizeof(*this);
+		f.allocator = words.allocator + rank.allocator;
+		f.allocations = words.allocations + rank.allocations;
+		return f;
+	}
+
+	void swap(mfbitvector& v)
+	{
+		words_.swap(v.words_);
+		rank_.swap(v.rank_);
+		std::swap(capacity_, v.capacity_);
+		std::swap(size_, v.size_);
+	}
+
+private:
+	mfvector<std::uint64_t> words_;
+	mfvector<std::uint64_t> rank_;
+	std::size_t capacity_;
+	std::size_t size_;
+
+	static std::size_t words_for(std::size_t bits)
+	{
+		return (bits + word_bits - 1) / word_bits;
+	}
+
+	static std::uint64_t bit(std::size_t n)
+	{
+		return std::uint64_t(1) << (n % word_bits);
+	}
+
+	/** Zeroes the bits of the last word past size_. */
+	void clear_tail()
+	{
+		if (size_ % word_bits)
+		{
+			words_[size_ / word_bits] &= bit(size_) - 1;
+		}
+	}
+
+	std::size_t find_from_word(std::size_t w) const
+	{
+		w += mfbits_find(words_.begin() + w, words_.size() - w);
+		return w < words_.size() ? w * word_bits + __builtin_ctzll(words_[w]) : mfbitvector_npos;
+	}
+};
+
+inline void swap(mfbitvector& a, mfbitvector& b)
+{
+	a.swap(b);
+}
+
+inline std::ostream& operator<<(std::ostream& o, const mfbitvector& v)
+{
+	o << "mfbitvector at " << std::hex << (void *) &v << std::dec << "(size " << v.size_
+	  << ", capacity " << v.capacity_ << ", words " << std::hex << (void *) v.words_.begin() << std::dec
+	  << ", rank index " << v.rank_.size() << " blocks)";
+	return o;
+}
+
+
+#endif
@@ -0,0 +1,121 @@
+//
+// Copyright (c) 2014 Jakub Jabłoński
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "mfbench.h"
+#include "mfbitvector.h"
+
+static const char* level_names[] = { "scalar", "sse2", "avx2" };
+
+/**
+ * std::vector<bool> versus mfbitvector at each instruction set available,
+ * for a cache resident and a memory bound vector with 1 in 8 bits set.
+ */
+MFBENCH(bitvector)
+{
+	static const std::size_t sizes[] = { 1 << 15, 1 << 30 };
+	for (std::size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s)
+	{
+		std::size_t n = sizes[s];
+		std::vector<bool> ref(n);
+		mfbitvector v(n), w(n);
+		v.resize(n);
+		w.resize(n);
+		std::srand(1);
+		for (std::size_t i = 0; i < n; ++i)
+		{
+			if (std::rand() % 8 == 0)
+			{
+				ref[i] = true;
+				v.set(i);
+			}
+			if (std::rand() % 2)
+			{
+				w.set(i);
+			}
+		}
+		static const std::size_t queries = 1 << 16;
+		std::vector<std::size_t> positions(queries), ranks(queries);
+		std::size_t ones = std::count(ref.begin(), ref.end(), true);
+		for (std::size_t q = 0; q < queries; ++q)
+		{
+			positions[q] = (std::size_t(std::rand()) << 15 ^ std::rand()) % n;
+			ranks[q] = (std::size_t(std::rand()) << 15 ^ std::rand()) % ones;
+		}
+		std::size_t bytes = n / 8;
+		std::string suffix = "/" + std::to_string(n);
+
+		b.run("std_count" + suffix, n, bytes, [&] { mfbench_keep(std::count(ref.begin(), ref.end(), true)); });
+		b.run("std_iterate" + suffix, n, bytes, [&] {
+			std::size_t sum = 0;
+			for (std::size_t i = 0; i < n; ++i)
+			{
+				sum += ref[i] ? i : 0;
+			}
+			mfbench_keep(sum);
+		});
+
+		for (int l = mfsimd_scalar; l <= mfsimd_avx2; ++l)
+		{
+			if (mfsimd_set_level(mfsimd_level_t(l)) != l)
+			{
+				continue;
+			}
+			std::string name = std::string("/") + level_names[l] + suffix;
+			b.run("count" + name, n, bytes, [&] { mfbench_keep(v.count()); });
+			b.run("and" + name, n, 2 * bytes, [&] { w &= v; });
+			b.run("xor" + name, n, 2 * bytes, [&] { w ^= v; });
+			b.run("find_next" + name, n, bytes, [&] {
+				std::size_t sum = 0;
+				for (std::size_t i = v.find_first(); i != mfbitvector_npos; i = v.find_next(i))
+				{
+					sum += i;
+				}
+				mfbench_keep(sum);
+			});
+
+			v.build_rank_index();
+			b.run("rank" + name, queries, 0, [&] {
+				std::size_t sum = 0;
+				for (std::size_t q = 0; q < queries; ++q)
+				{
+					sum += v.rank(positions[q]);
+				}
+				mfbench_keep(sum);
+			});
+			b.run("select" + name, queries, 0, [&] {
+				std::size_t sum = 0;
+				for (std::size_t q = 0; q < queries; ++q)
+				{
+					sum += v.select(ranks[q]);
+				}
+				mfbench_keep(sum);
+			});
+		}
+		mfsimd_set_level(mfsimd_avx2);
+	}
+}
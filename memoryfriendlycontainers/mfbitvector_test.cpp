@@ -0,0 +1,189 @@
+//
+// Copyright (c) 2014 Jakub Jabłoński
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#include <cstdlib>
+#include <vector>
+
+#include "mfbitvector.h"
+#include "gtest/gtest.h"
+
+class BitVectorTest : public ::testing::TestWithParam<mfsimd_level_t>
+{
+protected:
+    BitVectorTest() : bits(1000), reference(1000)
+    {
+        std::srand(11);
+        for (int i = 0; i < 1000; ++i)
+        {
+            bool b = std::rand() % 5 == 0;
+            bits.push_back(b);
+            reference[i] = b;
+        }
+        mfsimd_set_level(GetParam());
+    }
+    
+    ~BitVectorTest()
+    {
+        mfsimd_set_level(mfsimd_avx2);
+    }
+    
+    std::size_t reference_count(std::size_t n) const
+    {
+        std::size_t c = 0;
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            c += reference[i];
+        }
+        return c;
+    }
+    
+    mfbitvector bits;
+    std::vector<bool> reference;
+};
+
+TEST_P(BitVectorTest, SetTest)
+{
+    mfbitvector v(130);
+    EXPECT_EQ(0, v.size());
+    EXPECT_EQ(130, v.capacity());
+    
+    v.resize(130);
+    v.set(0);
+    v.set(64, true);
+    v.set(129);
+    v.flip(65);
+    EXPECT_TRUE(v[0]);
+    EXPECT_TRUE(v.test(64));
+    EXPECT_TRUE(v[65]);
+    EXPECT_TRUE(v[129]);
+    EXPECT_FALSE(v[1]);
+    EXPECT_EQ(4, v.count());
+    
+    v.reset(64);
+    v.set(65, false);
+    EXPECT_EQ(2, v.count());
+    
+    v.push_back(true);
+    EXPECT_EQ(130, v.size());
+}
+
+TEST_P(BitVectorTest, Resize)
+{
+    mfbitvector v(200);
+    v.resize(10, true);
+    v.resize(100, false);
+    v.resize(150, true);
+    EXPECT_EQ(60, v.count());
+    EXPECT_FALSE(v[99]);
+    EXPECT_TRUE(v[100]);
+    
+    v.resize(105);
+    EXPECT_EQ(15, v.count());
+    v.pop_back();
+    EXPECT_EQ(104, v.size());
+    EXPECT_EQ(14, v.count());
+    
+    v.set_all();
+    EXPECT_EQ(104, v.count());
+    v.reset_all();
+    EXPECT_EQ(0, v.count());
+    v.clear();
+    EXPECT_EQ(0, v.size());
+    v.pop_back();
+    EXPECT_EQ(0, v.size());
+    EXPECT_EQ(0, v.count());
+}
+
+TEST_P(BitVectorTest, Count)
+{
+    EXPECT_EQ(reference_count(1000), bits.count());
+}
+
+TEST_P(BitVectorTest, Find)
+{
+    std::size_t i = bits.find_first();
+    for (std::size_t j = 0; j < 1000; ++j)
+    {
+        if (reference[j])
+        {
+            ASSERT_EQ(j, i);
+            i = bits.find_next(i);
+        }
+    }
+    EXPECT_EQ(mfbitvector_npos, i);
+    
+    mfbitvector sparse(5000);
+    sparse.resize(5000);
+    EXPECT_EQ(mfbitvector_npos, sparse.find_first());
+    sparse.set(4097);
+    sparse.set(4999);
+    EXPECT_EQ(4097, sparse.find_first());
+    EXPECT_EQ(4999, sparse.find_next(4097));
+    EXPECT_EQ(mfbitvector_npos, sparse.find_next(4999));
+}
+
+TEST_P(BitVectorTest, Bulk)
+{
+    mfbitvector other(1000);
+    for (int i = 0; i < 1000; ++i)
+    {
+        other.push_back(i % 3 == 0);
+    }
+    
+    mfbitvector a(bits), o(bits), x(bits);
+    a &= other;
+    o |= other;
+    x ^= other;
+    for (int i = 0; i < 1000; ++i)
+    {
+        ASSERT_EQ(reference[i] && i % 3 == 0, a[i]);
+        ASSERT_EQ(reference[i] || i % 3 == 0, o[i]);
+        ASSERT_EQ(reference[i] != (i % 3 == 0), x[i]);
+    }
+    
+    mfbitvector shorter(100);
+    shorter.resize(100, true);
+    a = bits;
+    a &= shorter;
+    EXPECT_EQ(reference_count(100), a.count());
+}
+
+TEST_P(BitVectorTest, RankSelect)
+{
+    bits.build_rank_index();
+    ASSERT_TRUE(bits.has_rank_index());
+    for (std::size_t n = 0; n <= 1000; ++n)
+    {
+        ASSERT_EQ(reference_count(n), bits.rank(n));
+    }
+    std::size_t k = 0;
+    for (std::size_t j = 0; j < 1000; ++j)
+    {
+        if (reference[j])
+        {
+            ASSERT_EQ(j, bits.select(k++));
+        }
+    }
+    EXPECT_EQ(mfbitvector_npos, bits.select(k));
+}
+
+INSTANTIATE_TEST_CASE_P(Levels, BitVectorTest, ::testing::Values(mfsimd_scalar, mfsimd_sse2, mfsimd_avx2));
@@ -0,0 +1,199 @@
+//
+// Copyright (c) 2014 Jakub Jabłoński
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#ifndef memoryfriendlycontainers_mfbloom_h
+#define memoryfriendlycontainers_mfbloom_h
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+
+#include "mfsimd.h"
+
+/** Bits per key by default: about 1% false positives. */
+static const unsigned mfbloom_bits_per_key = 10;
+
+static const std::size_t mfbloom_block_bytes = 64;
+static const unsigned mfbloom_block_words = mfbloom_block_bytes / sizeof(std::uint64_t);
+
+/** Odd multipliers picking the bit a key sets in each word of its block. */
+static const std::uint32_t mfbloom_salt[mfbloom_block_words] = {
+	0x47b6137bu, 0x44974d91u, 0x8824ad5bu, 0xa2b7289du, 0x705495c7u, 0x2df1424bu, 0x9efc4947u, 0x5c6bfb31u
+};
+
+#if MFSIMD_X86
+/** Tests the eight bits of a hash in its block at once: two 256-bit ANDNOTs. */
+MFSIMD_AVX2 bool mfbloom_may_contain_avx2(const std::uint64_t* block, std::uint64_t hash)
+{
+	__m256i shift = _mm256_srli_epi32(_mm256_mullo_epi32(_mm256_set1_epi32(int(std::uint32_t(hash))),
+	                                                     _mm256_loadu_si256((const __m256i*) mfbloom_salt)), 26);
+	__m256i one = _mm256_set1_epi64x(1);
+	__m256i lo = _mm256_sllv_epi64(one, _mm256_cvtepu32_epi64(_mm256_castsi256_si128(shift)));
+	__m256i hi = _mm256_sllv_epi64(one, _mm256_cvtepu32_epi64(_mm256_extracti128_si256(shift, 1)));
+	return _mm256_testc_si256(_mm256_load_si256((const __m256i*) block), lo)
+	       & _mm256_testc_si256(_mm256_load_si256((const __m256i*) (block + 4)), hi);
+}
+#endif
+
+/**
+ * Blocked Bloom filter over 64-bit hashes. The high half of a hash picks a
+ * 64-byte, cache-line aligned block and the low half one bit in each of
+ * the block's eight words, so adding or testing a key touches one cache
+ * line (and up to 2^32 blocks can be addressed). Tests use AVX2 if
+ * mfsimd_level() allows it when the filter is set up. Keys can't be removed; clear() and adding the remaining keys again
+ * is the way to drop them.
+ */
+class mfblockedbloom
+{
+public:
+	mfblockedbloom() : raw_(0), blocks_(0), block_count_(0), avx2_(false)
+	{}
+
+	mfblockedbloom(std::size_t keys, unsigned bits_per_key = mfbloom_bits_per_key) : raw_(0), blocks_(0), block_count_(0), avx2_(false)
+	{
+		reset(keys, bits_per_key);
+	}
+
+	~mfblockedbloom()
+	{
+		delete [] raw_;
+	}
+
+	/** Makes room for keys at bits_per_key and clears; 0 keys frees the filter. */
+	void reset(std::size_t keys, unsigned bits_per_key = mfbloom_bits_per_key)
+	{
+		delete [] raw_;
+		raw_ = 0;
+		blocks_ = 0;
+		block_count_ = 0;
+		avx2_ = mfsimd_level() == mfsimd_avx2;
+		if (keys && bits_per_key)
+		{
+			block_count_ = (keys * bits_per_key + mfbloom_block_bytes * 8 - 1) / (mfbloom_block_bytes * 8);
+			raw_ = new unsigned char[block_count_ * mfbloom_block_bytes + mfbloom_block_bytes - 1];
+			std::uintptr_t p = std::uintptr_t(raw_);
+			blocks_ = (std::uint64_t*) ((p + mfbloom_block_bytes - 1) & ~std::uintptr_t(mfbloom_block_bytes - 1));
+			clear();
+		}
+	}
+
+	void clear()
+	{
+		if (blocks_)
+		{
+			std::memset(blocks_, 0, block_count_ * mfbloom_block_bytes);
+		}
+	}
+
+	bool enabled() const
+	{
+		return block_count_ != 0;
+	}
+
+	std::size_t block_count() const
+	{
+		return block_count_;
+	}
+
+	/** Bytes of the blocks, and what their allocation takes with the room for aligning them. */
+	std::size_t size_in_bytes() const
+	{
+		return block_count_ * mfbloom_block_bytes;
+	}
+
+	std::size_t allocated_bytes() const
+	{
+		return raw_ ? block_count_ * mfbloom_block_bytes + mfbloom_block_bytes - 1 : 0;
+	}
+
+	void add(std::uint64_t hash)
+	{
+		std::uint64_t* b = block(hash);
+		for (unsigned i = 0; i < mfbloom_block_words; ++i)
+		{
+			b[i] |= bit(hash, i);
+		}
+	}
+
+	/** add() that may run in several threads at once. */
+	void concurrent_add(std::uint64_t hash)
+	{
+		std::uint64_t* b = block(hash);
+		for (unsigned i = 0; i < mfbloom_block_words; ++i)
+		{
+			__atomic_fetch_or(&b[i], bit(hash, i), __ATOMIC_RELAXED);
+		}
+	}
+
+	/** False if hash was never added; true if it was, or by chance. */
+	bool may_contain(std::uint64_t hash) const
+	{
+		const std::uint64_t* b = block(hash);
+#if MFSIMD_X86
+		if (avx2_)
+		{
+			return mfbloom_may_contain_avx2(b, hash);
+		}
+#endif
+		std::uint64_t missing = 0;
+		for (unsigned i = 0; i < mfbloom_block_words; ++i)
+		{
+			missing |= bit(hash, i) & ~b[i];
+		}
+		return missing == 0;
+	}
+
+	void swap(mfblockedbloom& f)
+	{
+		std::swap(raw_, f.raw_);
+		std::swap(blocks_, f.blocks_);
+		std::swap(block_count_, f.block_count_);
+		std::swap(avx2_, f.avx2_);
+	}
+
+private:
+	mfblockedbloom(const mfblockedbloom&);
+	mfblockedbloom& operator=(const mfblockedbloom&);
+
+	unsigned char* raw_;
+	std::uint64_t* blocks_;
+	std::size_t block_count_;
+	bool avx2_;
+
+	std::uint64_t* block(std::uint64_t hash) const
+	{
+		return blocks_ + ((hash >> 32) * block_count_ >> 32) * mfbloom_block_words;
+	}
+
+	static std::uint64_t bit(std::uint64_t hash, unsigned word)
+	{
+		return std::uint64_t(1) << ((std::uint32_t(hash) * mfbloom_salt[word]) >> 26);
+	}
+};
+
+inline void swap(mfblockedbloom& a, mfblockedbloom& b)
+{
+	a.swap(b);
+}
+
+#endif
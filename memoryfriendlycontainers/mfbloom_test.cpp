@@ -0,0 +1,94 @@
+//
+// Copyright (c) 2014 Jakub Jabłoński
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+
+
+#include <cstdint>
+
+#include "mfbloom.h"
+#include "mfhash.h"
+#include "gtest/gtest.h"
+
+class BloomTest : public ::testing::TestWithParam<mfsimd_level_t>
+{
+protected:
+    BloomTest()
+    {
+        mfsimd_set_level(GetParam());
+    }
+    
+    ~BloomTest()
+    {
+        mfsimd_set_level(mfsimd_avx2);
+    }
+};
+
+TEST_P(BloomTest, Disabled)
+{
+    mfblockedbloom f;
+    EXPECT_FALSE(f.enabled());
+    EXPECT_EQ(0, f.size_in_bytes());
+    f.reset(0);
+    EXPECT_FALSE(f.enabled());
+    f.clear();
+}
+
+TEST_P(BloomTest, NoFalseNegativesFewFalsePositives)
+{
+    static const std::size_t n = 100000;
+    mfblockedbloom f(n);
+    EXPECT_TRUE(f.enabled());
+    EXPECT_EQ((n * mfbloom_bits_per_key + 511) / 512, f.block_count());
+    for (std::uint64_t i = 0; i < n; ++i)
+    {
+        f.add(mfhash_mix(i));
+    }
+    for (std::uint64_t i = 0; i < n; ++i)
+    {
+        ASSERT_TRUE(f.may_contain(mfhash_mix(i))) << i;
+    }
+    std::size_t false_positives = 0;
+    for (std::uint64_t i = n; i < 2 * n; ++i)
+    {
+        false_positives += f.may_contain(mfhash_mix(i));
+    }
+    // a blocked filter with 10 bits per key lands near 1%
+    EXPECT_LT(false_positives, n * 3 / 100);
+
+    f.clear();
+    EXPECT_FALSE(f.may_contain(mfhash_mix(0)));
+}
+
+TEST_P(BloomTest, ConcurrentAddAndSwap)
+{
+    mfblockedbloom a(1000), b;
+    a.concurrent_add(mfhash_mix(42));
+    EXPECT_TRUE(a.may_contain(mfhash_mix(42)));
+    swap(a, b);
+    EXPECT_FALSE(a.enabled());
+    EXPECT_TRUE(b.may_contain(mfhash_mix(42)));
+    b.reset(10, 16);
+    EXPECT_EQ(1, b.block_count());
+    EXPECT_FALSE(b.may_contain(mfhash_mix(42)));
+}
+
+INSTANTIATE_TEST_CASE_P(Levels, BloomTest, ::testing::Values(mfsimd_scalar, mfsimd_avx2));
@@ -0,0 +1,317 @@
+//
+// Copyright (c) 2014 Jakub Jabłoński
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#ifndef memoryfriendlycontainers_mfconstmap_h
+#define memoryfriendlycontainers_mfconstmap_h
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+#include "mffootprint.h"
+#include "mfhash.h"
+
+/**
+ * Hash and equality of mfconstmap keys, usable at compile time. Integers
+ * and C strings (compared by contents) are supported; specialize it for
+ * other literal types.
+ */
+template<typename K, typename Enable = void>
+struct mfconstmap_key;
+
+template<typename K>
+struct mfconstmap_key<K, typename std::enable_if<std::is_integral<K>::value || std::is_enum<K>::value>::type>
+{
+	static constexpr std::uint64_t hash(K key, std::uint64_t seed)
+	{
+		return mfhash_mix(std::uint64_t(key) + seed);
+	}
+
+	static constexpr bool equal(K a, K b)
+	{
+		return a == b;
+	}
+};
+
+template<>
+struct mfconstmap_key<const char*>
+{
+	/** FNV-1a over the characters, then mixed with the seed. */
+	static constexpr std::uint64_t hash(const char* key, std::uint64_t seed)
+	{
+		std::uint64_t h = 0xcbf29ce484222325ULL;
+		for (; *key; ++key)
+		{
+			h = (h ^ (unsigned char) *key) * 0x100000001b3ULL;
+		}
+		return mfhash_mix(h + seed);
+	}
+
+	static constexpr bool equal(const char* a, const char* b)
+	{
+		for (; *a && *a == *b; ++a, ++b)
+		{
+		}
+		return *a == *b;
+	}
+};
+
+template<typename K, typename V>
+struct mfconstmap_entry
+{
+	K first;
+	V second;
+};
+
+/** Seeds tried before giving up on finding a perfect hash. */
+static const unsigned mfconstmap_max_seeds = 16;
+
+/*
+ * Not constexpr: building an mfconstmap at compile time that reaches one
+ * of these fails to compile with an error naming it.
+ */
+inline void mfconstmap_duplicate_key()
+{}
+
+inline void mfconstmap_no_perfect_hash_found()
+{}
+
+/**
+ * Read-only map of N keys fixed at compile time, with a minimal perfect
+ * hash: the N entries sit in N slots, one per key.
+ *
+ *   constexpr std::pair<const char*, int> names[] = { { "host", 1 }, { "accept", 2 } };
+ *   constexpr auto headers = mfconstmap_make(names);
+ *   static_assert(headers["accept"] == 2, "");
+ *
+ * Built with hash and displace: the key's hash picks one of (N + 1) / 2
+ * buckets with its high half, and the bucket's displacement, found while
+ * building, is mixed into the low half to pick the slot. Buckets are
+ * placed largest first, each with the first displacement that sends all of
+ * its keys to free slots. A lookup hashes once, reads the displacement and
+ * compares the key in the one slot it can be in.
+ *
+ * Declared constexpr, the map is built by the compiler and lives in
+ * read-only data; nothing runs at startup and nothing is allocated.
+ * Building takes roughly N log N steps, well within the compilers' default
+ * constexpr limits for a few thousand keys.
+ */
+template<typename K, typename V, std::size_t N>
+class mfconstmap
+{
+	static_assert(N > 0, "mfconstmap needs at least one key");
+
+public:
+	typedef K key_type;
+	typedef V mapped_type;
+	typedef mfconstmap_entry<K, V> value_type;
+	typedef const value_type* const_iterator;
+	typedef std::size_t size_type;
+
+	static constexpr std::size_t bucket_count = (N + 1) / 2;
+
+	constexpr explicit mfconstmap(const std::pair<K, V> (&pairs)[N]) : entries_(), displacement_(), seed_(0), none_()
+	{
+		for (unsigned attempt = 0; attempt < mfconstmap_max_seeds; ++attempt)
+		{
+			if (build(pairs, mfhash_mix(attempt)))
+			{
+				return;
+			}
+		}
+		mfconstmap_no_perfect_hash_found();
+	}
+
+	constexpr std::size_t size() const
+	{
+		return N;
+	}
+
+	/** The value of key, or nullptr if key is not in the map. */
+	constexpr const V* find(const K& key) const
+	{
+		std::uint64_t h = mfconstmap_key<K>::hash(key, seed_);
+		const value_type& e = entries_[slot(h, displacement_[bucket(h)])];
+		return mfconstmap_key<K>::equal(e.first, key) ? &e.second : nullptr;
+	}
+
+	/** The value of key, or none() if key is not in the map. */
+	constexpr const V& operator[](const K& key) const
+	{
+		return find(key) ? *find(key) : none_;
+	}
+
+	constexpr std::size_t count(const K& key) const
+	{
+		return find(key) != nullptr;
+	}
+
+	constexpr const V& none() const
+	{
+		return none_;
+	}
+
+	/** Entries in slot order, which is not the order they were given in. */
+	constexpr const_iterator begin() const
+	{
+		return entries_;
+	}
+
+	constexpr const_iterator end() const
+	{
+		return entries_ + N;
+	}
+
+	/** Bytes of the map; the displacements count as links. Nothing is on the heap. */
+	mffootprint memory_footprint() const
+	{
+		mffootprint f;
+		f.elements = N;
+		f.payload = N * (sizeof(K) + sizeof(V));
+		f.padding = sizeof(entries_) - f.payload;
+		f.links = sizeof(displacement_);
+		f.header = sizeof(*this) - sizeof(entries_) - sizeof(displacement_);
+		return f;
+	}
+
+private:
+	value_type entries_[N];
+	std::uint32_t displacement_[bucket_count];
+	std::uint64_t seed_;
+
+	/** Value returned from different functions in case of error. */
+	V none_;
+
+	static constexpr std::size_t bucket(std::uint64_t h)
+	{
+		return std::size_t(((h >> 32) * bucket_count) >> 32);
+	}
+
+	/** Slot of a hash given its bucket's displacement; the multiplication carries low bits into high ones. */
+	static constexpr std::size_t slot(std::uint64_t h, std::uint32_t displacement)
+	{
+		return std::size_t((std::uint64_t(std::uint32_t((std::uint32_t(h) ^ displacement) * 0x9e3779b1u)) * N) >> 32);
+	}
+
+	/** Places all keys with the given seed; false if some bucket can't be placed. */
+	constexpr bool build(const std::pair<K, V> (&pairs)[N], std::uint64_t seed)
+	{
+		std::uint64_t hash[N] = {};
+		std::size_t size[bucket_count] = {};
+		std::size_t largest = 0;
+		for (std::size_t i = 0; i < N; ++i)
+		{
+			hash[i] = mfconstmap_key<K>::hash(pairs[i].first, seed);
+			std::size_t b = bucket(hash[i]);
+			largest = ++size[b] > largest ? size[b] : largest;
+		}
+
+		// Keys grouped by bucket: those of bucket b are keys[first[b]] to keys[first[b + 1]].
+		std::size_t first[bucket_count + 1] = {};
+		for (std::size_t b = 0; b < bucket_count; ++b)
+		{
+			first[b + 1] = first[b] + size[b];
+		}
+		std::size_t keys[N] = {};
+		std::size_t fill[bucket_count] = {};
+		for (std::size_t i = 0; i < N; ++i)
+		{
+			std::size_t b = bucket(hash[i]);
+			keys[first[b] + fill[b]++] = i;
+		}
+
+		bool taken[N] = {};
+		for (std::size_t n = largest; n > 0; --n)
+		{
+			for (std::size_t b = 0; b < bucket_count; ++b)
+			{
+				if (size[b] == n && !place(pairs, hash, keys + first[b], n, taken, displacement_[b]))
+				{
+					return false;
+				}
+			}
+		}
+		for (std::size_t i = 0; i < N; ++i)
+		{
+			std::size_t b = bucket(hash[i]);
+			value_type& e = entries_[slot(hash[i], displacement_[b])];
+			e.first = pairs[i].first;
+			e.second = pairs[i].second;
+		}
+		seed_ = seed;
+		return true;
+	}
+
+	/** Finds a displacement sending the n keys to distinct free slots and takes them. */
+	static constexpr bool place(const std::pair<K, V> (&pairs)[N], const std::uint64_t* hash, const std::size_t* keys,
+	                            std::size_t n, bool* taken, std::uint32_t& displacement)
+	{
+		for (std::size_t i = 0; i < n; ++i)
+		{
+			for (std::size_t j = 0; j < i; ++j)
+			{
+				if (mfconstmap_key<K>::equal(pairs[keys[i]].first, pairs[keys[j]].first))
+				{
+					mfconstmap_duplicate_key();
+					return false;
+				}
+			}
+		}
+		for (std::uint64_t d = 0; d < 64 * N + 64; ++d)
+		{
+			std::uint32_t candidate = std::uint32_t(mfhash_mix(d));
+			std::size_t placed = 0;
+			for (; placed < n; ++placed)
+			{
+				std::size_t s = slot(hash[keys[placed]], candidate);
+				if (taken[s])
+				{
+					break;
+				}
+				taken[s] = true;
+			}
+			if (placed == n)
+			{
+				displacement = candidate;
+				return true;
+			}
+			for (std::size_t i = 0; i < placed; ++i)
+			{
+				taken[slot(hash[keys[i]], candidate)] = false;
+			}
+		}
+		return false;
+	}
+};
+
+template<typename K, typename V, std::size_t N>
+constexpr std::size_t mfconstmap<K, V, N>::bucket_count;
+
+/** Builds an mfconstmap from an array of pairs; declare the result constexpr. */
+template<typename K, typename V, std::size_t N>
+constexpr mfconstmap<K, V, N> mfconstmap_make(const std::pair<K, V> (&pairs)[N])
+{
+	return mfconstmap<K, V, N>(pairs);
+}
+
+#endif
@@ -0,0 +1,134 @@
+//
+// Copyright (c) 2014 Jakub Jabłoński
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+
+
+#include <cstring>
+#include <set>
+#include <string>
+#include <utility>
+
+#include "mfconstmap.h"
+#include "gtest/gtest.h"
+
+namespace
+{
+    enum header_id { header_none, header_host, header_accept, header_content_type, header_content_length, header_cookie };
+
+    constexpr std::pair<const char*, header_id> header_names[] = {
+        { "host", header_host },
+        { "accept", header_accept },
+        { "content-type", header_content_type },
+        { "content-length", header_content_length },
+        { "cookie", header_cookie },
+    };
+
+    constexpr auto headers = mfconstmap_make(header_names);
+
+    static_assert(headers["content-length"] == header_content_length, "looked up at compile time");
+    static_assert(headers["content"] == header_none, "missing keys give none()");
+    static_assert(headers.count("cookie") == 1, "");
+
+    int add(int a, int b) { return a + b; }
+    int sub(int a, int b) { return a - b; }
+    int mul(int a, int b) { return a * b; }
+
+    typedef int (*handler)(int, int);
+    constexpr std::pair<unsigned char, handler> opcode_handlers[] = { { 0x01, add }, { 0x02, sub }, { 0x10, mul } };
+    constexpr auto opcodes = mfconstmap_make(opcode_handlers);
+
+    /** Keys 0, 7, 14, ... with values key + 1. */
+    template<std::size_t N>
+    struct multiples
+    {
+        std::pair<int, int> pairs[N];
+
+        constexpr multiples() : pairs()
+        {
+            for (std::size_t i = 0; i < N; ++i)
+            {
+                pairs[i].first = int(i) * 7;
+                pairs[i].second = int(i) * 7 + 1;
+            }
+        }
+    };
+}
+
+TEST(ConstmapTest, Strings)
+{
+    EXPECT_EQ(5, headers.size());
+    for (std::size_t i = 0; i < 5; ++i)
+    {
+        std::string name = header_names[i].first;
+        EXPECT_EQ(header_names[i].second, headers[name.c_str()]) << name;
+    }
+    EXPECT_EQ(nullptr, headers.find("hosts"));
+    EXPECT_EQ(nullptr, headers.find(""));
+    EXPECT_EQ(header_none, headers.none());
+
+    std::set<std::string> seen;
+    for (auto i = headers.begin(); i != headers.end(); ++i)
+    {
+        seen.insert(i->first);
+    }
+    EXPECT_EQ(5, seen.size());
+}
+
+TEST(ConstmapTest, FunctionPointers)
+{
+    EXPECT_EQ(5, opcodes[0x01](2, 3));
+    EXPECT_EQ(-1, opcodes[0x02](2, 3));
+    EXPECT_EQ(6, opcodes[0x10](2, 3));
+    EXPECT_EQ(nullptr, opcodes[0x03]);
+}
+
+TEST(ConstmapTest, ManyKeys)
+{
+    static constexpr multiples<1000> input;
+    static constexpr mfconstmap<int, int, 1000> m(input.pairs);
+    static_assert(m[700] == 701, "");
+    for (int k = -10; k < 7100; ++k)
+    {
+        if (k >= 0 && k % 7 == 0 && k < 7000)
+        {
+            ASSERT_EQ(k + 1, m[k]) << k;
+        }
+        else
+        {
+            ASSERT_EQ(0, m.count(k)) << k;
+        }
+    }
+}
+
+TEST(ConstmapTest, OneKeyAndFootprint)
+{
+    static constexpr std::pair<int, int> one[] = { { 42, 1 } };
+    static constexpr auto m = mfconstmap_make(one);
+    EXPECT_EQ(1, m[42]);
+    EXPECT_EQ(0, m[41]);
+
+    mffootprint f = headers.memory_footprint();
+    EXPECT_EQ(5, f.elements);
+    EXPECT_EQ(5 * (sizeof(const char*) + sizeof(header_id)), f.payload);
+    EXPECT_EQ(3 * sizeof(std::uint32_t), f.links);
+    EXPECT_EQ(0, f.allocations);
+}
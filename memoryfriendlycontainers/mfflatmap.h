@@ -0,0 +1,413 @@
+//
+// Copyright (c) 2014 Jakub Jabłoński
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef memoryfriendlycontainers_mfflatmap_h
+#define memoryfriendlycontainers_mfflatmap_h
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <utility>
+
+#include <ostream>
+
+#include "mffootprint.h"
+#include "mfvector.h"
+
+/** Order of the keys in an mfflatmap. */
+enum mfflatmap_layout
+{
+	mfflatmap_sorted,    /**< ascending; binary search */
+	mfflatmap_eytzinger  /**< breadth-first order of the search tree; cache-friendly search */
+};
+
+template<typename K, typename V, mfflatmap_layout L, typename C> class mfflatmap;
+template<typename K, typename V, mfflatmap_layout L, typename C>
+std::ostream& operator<<(std::ostream&, const mfflatmap<K, V, L, C>& m);
+
+/**
+ * Read-only map built once from a sorted range, with keys and values in two
+ * separate mfvectors, so searching touches only keys.
+ *
+ * With mfflatmap_sorted the keys are in ascending order and searched by a
+ * branchless binary search. With mfflatmap_eytzinger slot 0 is unused and
+ * the key of search tree node k is in slot k, its children in slots 2k and
+ * 2k + 1:
+ *
+ *     sorted:     1 2 3 4 5 6 7         tree:        4
+ *                                                  /   \
+ *     eytzinger:  - 4 2 6 1 3 5 7                 2     6
+ *                                                / \   / \
+ *                                               1   3 5   7
+ *
+ * The top levels of the tree share a few cache lines, the search goes down
+ * without branches (k = 2k + (key[k] < x)) and prefetches the line holding
+ * the node four levels below, so lookups in large maps overlap their cache
+ * misses. Iteration is in key order in both layouts.
+ */
+template<typename K, typename V, mfflatmap_layout L = mfflatmap_sorted, typename C = std::less<K> >
+class mfflatmap
+{
+	friend std::ostream& operator<<<K, V, L, C> (std::ostream& o, const mfflatmap<K, V, L, C>& m);
+
+public:
+	typedef K key_type;
+	typedef V mapped_type;
+	typedef std::size_t size_type;
+
+	template<bool is_const_iterator>
+	struct iter : public std::iterator<std::forward_iterator_tag, std::pair<const K, V> >
+	{
+		typedef typename std::conditional<is_const_iterator, const mfflatmap, mfflatmap>::type map_type;
+		typedef typename std::conditional<is_const_iterator, const V&, V&>::type value_reference;
+
+		iter(map_type* map, std::size_t slot) : map(map), slot(slot)
+		{}
+
+		iter(const iter<false>& other) : map(other.map), slot(other.slot)
+		{}
+
+		const K& key() const
+		{
+			return map->keys_[slot];
+		}
+
+		value_reference value() const
+		{
+			return map->values_[slot];
+		}
+
+		std::pair<const K&, value_reference> operator*() const
+		{
+			return std::pair<const K&, value_reference>(key(), value());
+		}
+
+		iter& operator++()
+		{
+			slot = map->next(slot);
+			return *this;
+		}
+
+		iter operator++(int)
+		{
+			iter org(*this);
+			operator++();
+			return org;
+		}
+
+		friend bool operator==(const iter& lhs, const iter& rhs)
+		{
+			return lhs.slot == rhs.slot;
+		}
+
+		friend bool operator!=(const iter& lhs, const iter& rhs)
+		{
+			return lhs.slot != rhs.slot;
+		}
+
+		map_type* map;
+		std::size_t slot;
+	};
+
+	typedef iter<false> iterator;
+	typedef iter<true> const_iterator;
+
+	explicit mfflatmap(const C& comp = C()) : size_(0), comp_(comp)
+	{}
+
+	/**
+	 * Builds the map from [first, last), pairs of key and value in strictly
+	 * ascending key order. K and V must be default constructible.
+	 */
+	template<typename I>
+	mfflatmap(I first, I last, const C& comp = C()) : size_(std::distance(first, last)), comp_(comp)
+	{
+		std::size_t slots = size_ + (L == mfflatmap_eytzinger);
+		keys_ = mfvector<K>(slots);
+		values_ = mfvector<V>(slots);
+		keys_.resize(slots);
+		values_.resize(slots);
+		for (std::size_t slot = first_slot(); first != last; ++first, slot = next(slot))
+		{
+			keys_[slot] = first->first;
+			values_[slot] = first->second;
+		}
+	}
+
+	std::size_t size() const
+	{
+		return size_;
+	}
+
+	bool empty() const
+	{
+		return size_ == 0;
+	}
+
+	/** Bytes taken by keys and values. */
+	std::size_t size_in_bytes() const
+	{
+		return keys_.capacity() * sizeof(K) + values_.capacity() * sizeof(V);
+	}
+
+	/**
+	 * Bytes taken by the key and value arrays. Keys and values are kept
+	 * apart, so there is no padding between them; the Eytzinger layout's
+	 * unused slot 0 counts as padding.
+	 */
+	mffootprint memory_footprint() const
+	{
+		mffootprint f = keys_.memory_footprint();
+		f += values_.memory_footprint();
+		f.elements = size_;
+		f.payload = size_ * (sizeof(K) + sizeof(V));
+		f.padding = (keys_.size() - size_) * (sizeof(K) + sizeof(V));
+		f.header = sizeof(*this);
+		return f;
+	}
+
+	iterator begin()
+	{
+		return iterator(this, first_slot());
+	}
+
+	const_iterator begin() const
+	{
+		return const_iterator(this, first_slot());
+	}
+
+	iterator end()
+	{
+		return iterator(this, end_slot());
+	}
+
+	const_iterator end() const
+	{
+		return const_iterator(this, end_slot());
+	}
+
+	iterator find(const K& key)
+	{
+		return iterator(this, find_slot(key));
+	}
+
+	const_iterator find(const K& key) const
+	{
+		return const_iterator(this, find_slot(key));
+	}
+
+	std::size_t count(const K& key) const
+	{
+		return find_slot(key) != end_slot();
+	}
+
+	/** First element with a key not less than key. */
+	iterator lower_bound(const K& key)
+	{
+		return iterator(this, lower_bound_slot(key));
+	}
+
+	const_iterator lower_bound(const K& key) const
+	{
+		return const_iterator(this, lower_bound_slot(key));
+	}
+
+	/** First element with a key greater than key. */
+	iterator upper_bound(const K& key)
+	{
+		return iterator(this, upper_bound_slot(key));
+	}
+
+	const_iterator upper_bound(const K& key) const
+	{
+		return const_iterator(this, upper_bound_slot(key));
+	}
+
+	void swap(mfflatmap& m)
+	{
+		keys_.swap(m.keys_);
+		values_.swap(m.values_);
+		std::swap(size_, m.size_);
+		std::swap(comp_, m.comp_);
+	}
+
+private:
+	mfvector<K> keys_;
+	mfvector<V> values_;
+	std::size_t size_;
+	C comp_;
+
+	/** Whether key in slot goes before x (lower bound) or not after it (upper bound). */
+	struct before_lower
+	{
+		const C& comp;
+		bool operator()(const K& k, const K& x) const
+		{
+			return comp(k, x);
+		}
+	};
+
+	struct before_upper
+	{
+		const C& comp;
+		bool operator()(const K& k, const K& x) const
+		{
+			return !comp(x, k);
+		}
+	};
+
+	std::size_t lower_bound_slot(const K& key) const
+	{
+		before_lower p = { comp_ };
+		return search(key, p, std::integral_constant<mfflatmap_layout, L>());
+	}
+
+	std::size_t upper_bound_slot(const K& key) const
+	{
+		before_upper p = { comp_ };
+		return search(key, p, std::integral_constant<mfflatmap_layout, L>());
+	}
+
+	std::size_t find_slot(const K& key) const
+	{
+		std::size_t slot = lower_bound_slot(key);
+		return slot != end_slot() && !comp_(key, keys_[slot]) ? slot : end_slot();
+	}
+
+	/*
+	 * Sorted layout: slots 0 to size_ - 1 in order, end is size_.
+	 */
+
+	template<typename P>
+	std::size_t search(const K& x, P before, std::integral_constant<mfflatmap_layout, mfflatmap_sorted>) const
+	{
+		if (!size_)
+		{
+			return 0;
+		}
+		const K* base = keys_.begin();
+		for (std::size_t n = size_; n > 1; n -= n / 2)
+		{
+			base = before(base[n / 2], x) ? base + n / 2 : base;
+		}
+		return (base - keys_.begin()) + before(*base, x);
+	}
+
+	std::size_t first_slot(std::integral_constant<mfflatmap_layout, mfflatmap_sorted>) const
+	{
+		return 0;
+	}
+
+	std::size_t end_slot(std::integral_constant<mfflatmap_layout, mfflatmap_sorted>) const
+	{
+		return size_;
+	}
+
+	std::size_t next(std::size_t slot, std::integral_constant<mfflatmap_layout, mfflatmap_sorted>) const
+	{
+		return slot + 1;
+	}
+
+	/*
+	 * Eytzinger layout: slots 1 to size_ are tree nodes, end is 0.
+	 */
+
+	template<typename P>
+	std::size_t search(const K& x, P before, std::integral_constant<mfflatmap_layout, mfflatmap_eytzinger>) const
+	{
+		// Nodes 4 levels below k are 16 consecutive slots starting at 16k.
+		static const std::size_t lookahead = 16;
+		const K* keys = keys_.begin();
+		std::size_t k = 1;
+		while (k <= size_)
+		{
+			__builtin_prefetch((const void*) ((std::uintptr_t) keys + lookahead * k * sizeof(K)));
+			k = 2 * k + before(keys[k], x);
+		}
+		// k went right after the answer, then left all the way down; undo that.
+		return k >> (__builtin_ctzll(~(unsigned long long) k) + 1);
+	}
+
+	std::size_t first_slot(std::integral_constant<mfflatmap_layout, mfflatmap_eytzinger>) const
+	{
+		std::size_t k = 0;
+		if (size_)
+		{
+			for (k = 1; 2 * k <= size_; k *= 2)
+			{
+			}
+		}
+		return k;
+	}
+
+	std::size_t end_slot(std::integral_constant<mfflatmap_layout, mfflatmap_eytzinger>) const
+	{
+		return 0;
+	}
+
+	/** In-order successor: leftmost node of the right subtree, else the first ancestor entered from the left. */
+	std::size_t next(std::size_t k, std::integral_constant<mfflatmap_layout, mfflatmap_eytzinger>) const
+	{
+		if (2 * k + 1 <= size_)
+		{
+			for (k = 2 * k + 1; 2 * k <= size_; k *= 2)
+			{
+			}
+			return k;
+		}
+		return k >> (__builtin_ctzll(~(unsigned long long) k) + 1);
+	}
+
+	std::size_t first_slot() const
+	{
+		return first_slot(std::integral_constant<mfflatmap_layout, L>());
+	}
+
+	std::size_t end_slot() const
+	{
+		return end_slot(std::integral_constant<mfflatmap_layout, L>());
+	}
+
+	std::size_t next(std::size_t slot) const
+	{
+		return next(slot, std::integral_constant<mfflatmap_layout, L>());
+	}
+};
+
+template<typename K, typename V, mfflatmap_layout L, typename C>
+void swap(mfflatmap<K, V, L, C>& a, mfflatmap<K, V, L, C>& b)
+{
+	a.swap(b);
+}
+
+template<typename K, typename V, mfflatmap_layout L, typename C>
+std::ostream& operator<<(std::ostream& o, const mfflatmap<K, V, L, C>& m)
+{
+	o << "mfflatmap at " << std::hex << (void *) &m << std::dec << "(size " << m.size_ << ", layout "
+	  << (L == mfflatmap_eytzinger ? "eytzinger" : "sorted") << ", keys " << std::hex << (void *) m.keys_.begin()
+	  << ", values " << (void *) m.values_.begin() << std::dec << ")";
+	return o;
+}
+
+
+#endif
@@ -0,0 +1,144 @@
+//
+// Copyright (c) 2014 Jakub Jabłoński
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "mfbench.h"
+#include "mfflatmap.h"
+#include "mfhashmapsc.h"
+
+/** Bytes currently held by std::map nodes allocated through map_allocator. */
+static std::size_t map_bytes = 0;
+
+template<typename T>
+struct map_allocator
+{
+	typedef T value_type;
+
+	map_allocator()
+	{}
+
+	template<typename U>
+	map_allocator(const map_allocator<U>&)
+	{}
+
+	T* allocate(std::size_t n)
+	{
+		map_bytes += n * sizeof(T);
+		return (T*) ::operator new(n * sizeof(T));
+	}
+
+	void deallocate(T* p, std::size_t n)
+	{
+		map_bytes -= n * sizeof(T);
+		::operator delete(p);
+	}
+
+	template<typename U>
+	bool operator==(const map_allocator<U>&) const
+	{
+		return true;
+	}
+
+	template<typename U>
+	bool operator!=(const map_allocator<U>&) const
+	{
+		return false;
+	}
+};
+
+/** Layout of one mfhashmapsc entry, to count its bytes. */
+struct hashmap_entry
+{
+	std::pair<const int, int> value;
+	void* next_entry;
+};
+
+template<typename F>
+static void lookups(mfbench& b, const std::string& name, const std::vector<int>& queries, std::size_t bytes, std::size_t n, F find)
+{
+	b.run(name, queries.size(), 0, [&] {
+		std::size_t sum = 0;
+		for (std::size_t q = 0; q < queries.size(); ++q)
+		{
+			sum += find(queries[q]);
+		}
+		mfbench_keep(sum);
+	}).counter("bytes_per_entry", double(bytes) / n);
+}
+
+/**
+ * Random lookups of present keys in the sorted and Eytzinger flat maps,
+ * mfhashmapsc and std::map, from cache resident to memory bound sizes.
+ * Each result carries the bytes per entry of its map; the std::map count
+ * includes nodes but not malloc's own headers.
+ */
+MFBENCH(flatmap)
+{
+	static const std::size_t sizes[] = { 1 << 12, 1 << 16, 1 << 20, 1 << 23 };
+	static const std::size_t queries = 1 << 16;
+	for (std::size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s)
+	{
+		std::size_t n = sizes[s];
+		std::vector<std::pair<int, int> > pairs(n);
+		std::srand(1);
+		for (std::size_t i = 0; i < n; ++i)
+		{
+			// distinct keys with random gaps
+			pairs[i] = std::make_pair(int(i * 8 + std::rand() % 8), int(i));
+		}
+		std::vector<int> keys(queries);
+		for (std::size_t q = 0; q < queries; ++q)
+		{
+			keys[q] = pairs[(std::size_t(std::rand()) << 15 ^ std::rand()) % n].first;
+		}
+		std::string suffix = "/" + std::to_string(n);
+
+		{
+			mfflatmap<int, int, mfflatmap_sorted> m(pairs.begin(), pairs.end());
+			lookups(b, "sorted" + suffix, keys, m.size_in_bytes(), n, [&](int k) { return m.find(k).value(); });
+		}
+		{
+			mfflatmap<int, int, mfflatmap_eytzinger> m(pairs.begin(), pairs.end());
+			lookups(b, "eytzinger" + suffix, keys, m.size_in_bytes(), n, [&](int k) { return m.find(k).value(); });
+		}
+		{
+			mfhashmapsc<int, int> m(n);
+			for (std::size_t i = 0; i < n; ++i)
+			{
+				m.insert(pairs[i].first, pairs[i].second);
+			}
+			std::size_t bytes = n * sizeof(hashmap_entry) + m.bucket_count() * sizeof(void*);
+			lookups(b, "mfhashmapsc" + suffix, keys, bytes, n, [&](int k) { return m[k]; });
+		}
+		{
+			std::map<int, int, std::less<int>, map_allocator<std::pair<const int, int> > > m(pairs.begin(), pairs.end());
+			lookups(b, "std_map" + suffix, keys, map_bytes, n, [&](int k) { return m.find(k)->second; });
+		}
+	}
+}
@@ -0,0 +1,147 @@
+//
+// Copyright (c) 2014 Jakub Jabłoński
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "mfflatmap.h"
+#include "object.h"
+#include "gtest/gtest.h"
+
+template<typename M>
+class FlatmapTest : public ::testing::Test
+{
+protected:
+    /** Keys 10, 20, ..., n * 10 with values key + 1. */
+    static std::vector<std::pair<int, int> > pairs(int n)
+    {
+        std::vector<std::pair<int, int> > v;
+        for (int i = 1; i <= n; ++i)
+        {
+            v.push_back(std::make_pair(i * 10, i * 10 + 1));
+        }
+        return v;
+    }
+};
+
+typedef ::testing::Types<mfflatmap<int, int, mfflatmap_sorted>, mfflatmap<int, int, mfflatmap_eytzinger> > FlatmapTypes;
+TYPED_TEST_CASE(FlatmapTest, FlatmapTypes);
+
+TYPED_TEST(FlatmapTest, Empty)
+{
+    TypeParam m;
+    EXPECT_EQ(0, m.size());
+    EXPECT_TRUE(m.empty());
+    EXPECT_TRUE(m.begin() == m.end());
+    EXPECT_TRUE(m.find(1) == m.end());
+    EXPECT_TRUE(m.lower_bound(1) == m.end());
+    EXPECT_EQ(0, m.count(1));
+}
+
+TYPED_TEST(FlatmapTest, Find)
+{
+    std::vector<std::pair<int, int> > v = this->pairs(100);
+    TypeParam m(v.begin(), v.end());
+    EXPECT_EQ(100, m.size());
+    
+    for (int k = 0; k <= 1010; ++k)
+    {
+        typename TypeParam::iterator i = m.find(k);
+        if (k % 10 == 0 && k >= 10 && k <= 1000)
+        {
+            ASSERT_TRUE(i != m.end()) << k;
+            EXPECT_EQ(k, i.key());
+            EXPECT_EQ(k + 1, i.value());
+            EXPECT_EQ(1, m.count(k));
+        }
+        else
+        {
+            EXPECT_TRUE(i == m.end()) << k;
+            EXPECT_EQ(0, m.count(k));
+        }
+    }
+    
+    m.find(500).value() = 7;
+    EXPECT_EQ(7, (*m.find(500)).second);
+}
+
+TYPED_TEST(FlatmapTest, Bounds)
+{
+    std::vector<std::pair<int, int> > v = this->pairs(50);
+    const TypeParam m(v.begin(), v.end());
+    
+    EXPECT_EQ(10, m.lower_bound(0).key());
+    EXPECT_EQ(10, m.lower_bound(10).key());
+    EXPECT_EQ(20, m.lower_bound(11).key());
+    EXPECT_EQ(20, m.upper_bound(10).key());
+    EXPECT_EQ(500, m.lower_bound(500).key());
+    EXPECT_TRUE(m.upper_bound(500) == m.end());
+    EXPECT_TRUE(m.lower_bound(501) == m.end());
+}
+
+TYPED_TEST(FlatmapTest, Iterator)
+{
+    // every tree shape from empty to a few full levels
+    for (int n = 0; n < 70; ++n)
+    {
+        std::vector<std::pair<int, int> > v = this->pairs(n);
+        TypeParam m(v.begin(), v.end());
+        int count = 0;
+        for (typename TypeParam::const_iterator i = m.begin(); i != m.end(); ++i)
+        {
+            ASSERT_LT(count, n);
+            EXPECT_EQ(v[count].first, i.key());
+            EXPECT_EQ(v[count].second, i.value());
+            EXPECT_TRUE(i == m.lower_bound(i.key()));
+            ++count;
+        }
+        EXPECT_EQ(n, count);
+    }
+}
+
+TYPED_TEST(FlatmapTest, Swap)
+{
+    std::vector<std::pair<int, int> > v = this->pairs(10);
+    TypeParam a(v.begin(), v.end());
+    TypeParam b;
+    swap(a, b);
+    EXPECT_EQ(0, a.size());
+    EXPECT_EQ(10, b.size());
+    EXPECT_EQ(31, b.find(30).value());
+}
+
+TEST(FlatmapObjectTest, Comparator)
+{
+    std::vector<std::pair<int, object> > v;
+    for (int i = 5; i > 0; --i)
+    {
+        v.push_back(std::make_pair(i, object()));
+    }
+    mfflatmap<int, object, mfflatmap_eytzinger, std::greater<int> > m(v.begin(), v.end());
+    EXPECT_EQ(5, m.begin().key());
+    EXPECT_EQ(3, m.lower_bound(3).key());
+    EXPECT_EQ(2, m.upper_bound(3).key());
+    EXPECT_TRUE(m.find(0) == m.end());
+}
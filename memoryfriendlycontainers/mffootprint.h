@@ -0,0 +1,141 @@
+//
+// Copyright (c) 2014 Jakub Jabłoński
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#ifndef memoryfriendlycontainers_mffootprint_h
+#define memoryfriendlycontainers_mffootprint_h
+
+#include <cstddef>
+
+#include <ostream>
+
+/**
+ * Where the bytes of a container go. payload is what the elements need by
+ * themselves (sizeof(K) + sizeof(V) for a map entry, the packed bits for
+ * bit and packed vectors); everything else is overhead. The footprint is
+ * shallow: memory owned by the elements, like a string's characters, is
+ * not counted.
+ */
+struct mffootprint
+{
+	std::size_t elements;      /**< number of elements stored */
+	std::size_t payload;       /**< bytes of the elements themselves */
+	std::size_t padding;       /**< alignment padding in and between elements */
+	std::size_t links;         /**< next pointers, used buckets, indexes */
+	std::size_t empty_buckets; /**< bytes of buckets that hold no entry */
+	std::size_t unused;        /**< allocated capacity that holds no element */
+	std::size_t header;        /**< the container object, none_ included */
+	std::size_t allocator;     /**< estimated allocator headers and rounding */
+	std::size_t allocations;   /**< number of blocks obtained from the system */
+
+	mffootprint() : elements(0), payload(0), padding(0), links(0), empty_buckets(0), unused(0), header(0), allocator(0), allocations(0)
+	{}
+
+	std::size_t total() const
+	{
+		return payload + padding + links + empty_buckets + unused + header + allocator;
+	}
+
+	std::size_t overhead() const
+	{
+		return total() - payload;
+	}
+
+	double bytes_per_element() const
+	{
+		return elements ? double(total()) / elements : 0.0;
+	}
+
+	/** Adds the footprint of a nested container; its header is not counted twice. */
+	mffootprint& operator+=(const mffootprint& f)
+	{
+		elements += f.elements;
+		payload += f.payload;
+		padding += f.padding;
+		links += f.links;
+		empty_buckets += f.empty_buckets;
+		unused += f.unused;
+		allocator += f.allocator;
+		allocations += f.allocations;
+		return *this;
+	}
+
+	/** Counts a block of n bytes from malloc or new. */
+	void add_heap_block(std::size_t n);
+
+	/** Counts a block of n bytes mapped directly with mmap. */
+	void add_mapped_block(std::size_t n);
+};
+
+/** Size of a page; mapped blocks are rounded up to it. */
+static const std::size_t mffootprint_page_size = 4096;
+
+/** Requests of this many bytes or more are served by malloc with mmap (glibc's default). */
+static const std::size_t mffootprint_mmap_threshold = 128 * 1024;
+
+/**
+ * Bytes the allocator takes for a malloc(n) beyond n. Modelled on glibc:
+ * a size word per chunk, chunks a multiple of two pointers and at least
+ * four pointers long; big requests are mapped with a two word header.
+ */
+inline std::size_t mffootprint_heap_overhead(std::size_t n)
+{
+	if (n == 0)
+	{
+		return 0;
+	}
+	if (n >= mffootprint_mmap_threshold)
+	{
+		std::size_t chunk = (n + 2 * sizeof(std::size_t) + mffootprint_page_size - 1) & ~(mffootprint_page_size - 1);
+		return chunk - n;
+	}
+	std::size_t align = 2 * sizeof(void*);
+	std::size_t chunk = (n + sizeof(std::size_t) + align - 1) & ~(align - 1);
+	return (chunk < 4 * sizeof(void*) ? 4 * sizeof(void*) : chunk) - n;
+}
+
+inline void mffootprint::add_heap_block(std::size_t n)
+{
+	if (n)
+	{
+		allocator += mffootprint_heap_overhead(n);
+		++allocations;
+	}
+}
+
+inline void mffootprint::add_mapped_block(std::size_t n)
+{
+	if (n)
+	{
+		allocator += ((n + mffootprint_page_size - 1) & ~(mffootprint_page_size - 1)) - n;
+		++allocations;
+	}
+}
+
+inline std::ostream& operator<<(std::ostream& o, const mffootprint& f)
+{
+	o << f.total() << " bytes for " << f.elements << " elements (payload " << f.payload << ", padding " << f.padding
+	  << ", links " << f.links << ", empty buckets " << f.empty_buckets << ", unused " << f.unused << ", header "
+	  << f.header << ", allocator " << f.allocator << " in " << f.allocations << " blocks)";
+	return o;
+}
+
+#endif
@@ -0,0 +1,193 @@
+//
+// Copyright (c) 2014 Jakub Jabłoński
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "mfbitvector.h"
+#include "mfflatmap.h"
+#include "mffootprint.h"
+#include "mfhashmapsc.h"
+#include "mfpackedvector.h"
+#include "mfringbuffer.h"
+#include "mfsegvector.h"
+#include "mfsoavector.h"
+#include "mfvector.h"
+#include "gtest/gtest.h"
+
+TEST(FootprintTest, HeapOverhead)
+{
+    EXPECT_EQ(0u, mffootprint_heap_overhead(0));
+    EXPECT_EQ(4 * sizeof(void*) - 1, mffootprint_heap_overhead(1));
+    for (std::size_t n = 1; n < 4096; n += 7)
+    {
+        std::size_t chunk = n + mffootprint_heap_overhead(n);
+        EXPECT_GE(chunk, n + sizeof(std::size_t));
+        EXPECT_EQ(0u, chunk % (2 * sizeof(void*)));
+    }
+    EXPECT_EQ(0u, (mffootprint_mmap_threshold + mffootprint_heap_overhead(mffootprint_mmap_threshold)) % mffootprint_page_size);
+}
+
+TEST(FootprintTest, Sum)
+{
+    mffootprint a;
+    a.elements = 2;
+    a.payload = 8;
+    a.links = 16;
+    a.header = 40;
+    a.add_heap_block(24);
+    mffootprint b = a;
+    b += a;
+    EXPECT_EQ(4u, b.elements);
+    EXPECT_EQ(16u, b.payload);
+    EXPECT_EQ(32u, b.links);
+    EXPECT_EQ(40u, b.header);
+    EXPECT_EQ(2u, b.allocations);
+    EXPECT_EQ(b.total() - b.payload, b.overhead());
+}
+
+TEST(FootprintTest, Vector)
+{
+    mfvector<int> v(100);
+    for (int i = 0; i < 60; ++i)
+    {
+        v.push_back(i);
+    }
+    mffootprint f = v.memory_footprint();
+    EXPECT_EQ(60u, f.elements);
+    EXPECT_EQ(60 * sizeof(int), f.payload);
+    EXPECT_EQ(40 * sizeof(int), f.unused);
+    EXPECT_EQ(sizeof(v), f.header);
+    EXPECT_EQ(1u, f.allocations);
+    EXPECT_EQ(mffootprint_heap_overhead(100 * sizeof(int)), f.allocator);
+    EXPECT_EQ(0u, mfvector<int>().memory_footprint().allocations);
+}
+
+TEST(FootprintTest, Hashmap)
+{
+    typedef mfhashmapsc<int, double> map_type;
+    map_type m(64);
+    for (int i = 0; i < 40; ++i)
+    {
+        m.insert(i, i);
+    }
+    mffootprint f = m.memory_footprint();
+    std::size_t entry = sizeof(std::pair<const int, double>) + sizeof(void*);
+    std::size_t buckets = m.bucket_count() * sizeof(void*);
+    EXPECT_EQ(40u, f.elements);
+    EXPECT_EQ(40 * (sizeof(int) + sizeof(double)), f.payload);
+    EXPECT_EQ(40 * (entry - sizeof(int) - sizeof(double) - sizeof(void*)), f.padding);
+    EXPECT_EQ(24 * entry, f.unused);
+    EXPECT_EQ(40 * sizeof(void*) + buckets, f.links + f.empty_buckets);
+    EXPECT_GT(f.empty_buckets, 0u);
+    EXPECT_EQ(sizeof(m), f.header);
+    EXPECT_EQ(2u, f.allocations);
+    EXPECT_EQ(64 * entry + buckets + sizeof(m), f.total() - f.allocator);
+}
+
+TEST(FootprintTest, Flatmap)
+{
+    std::vector<std::pair<int, char> > pairs;
+    for (int i = 0; i < 10; ++i)
+    {
+        pairs.push_back(std::make_pair(i, char('a' + i)));
+    }
+    mfflatmap<int, char> sorted(pairs.begin(), pairs.end());
+    mfflatmap<int, char, mfflatmap_eytzinger> eytzinger(pairs.begin(), pairs.end());
+    mffootprint s = sorted.memory_footprint();
+    mffootprint e = eytzinger.memory_footprint();
+    EXPECT_EQ(10u, s.elements);
+    EXPECT_EQ(10 * (sizeof(int) + sizeof(char)), s.payload);
+    EXPECT_EQ(0u, s.padding);
+    EXPECT_EQ(s.payload, e.payload);
+    EXPECT_EQ(sizeof(int) + sizeof(char), e.padding);
+    EXPECT_EQ(2u, s.allocations);
+}
+
+TEST(FootprintTest, Segvector)
+{
+    mfsegvector<int, 4> v;
+    for (int i = 0; i < 20; ++i)
+    {
+        v.push_back(i);
+    }
+    mffootprint f = v.memory_footprint();
+    EXPECT_EQ(20u, f.elements);
+    EXPECT_EQ(20 * sizeof(int), f.payload);
+    EXPECT_EQ((v.capacity() - 20) * sizeof(int), f.unused);
+    EXPECT_GE(f.links, v.segment_count() * sizeof(int*));
+    EXPECT_EQ(v.segment_count() + 1, f.allocations);
+}
+
+TEST(FootprintTest, Soavector)
+{
+    mfsoavector<char, double> v(10);
+    v.push_back('a', 1.0);
+    mffootprint f = v.memory_footprint();
+    EXPECT_EQ(1u, f.elements);
+    EXPECT_EQ(sizeof(char) + sizeof(double), f.payload);
+    EXPECT_EQ(9 * (sizeof(char) + sizeof(double)), f.unused);
+    // Columns are rounded up to whole cache lines: 10 chars to one, 10 doubles to two.
+    EXPECT_EQ(3 * mfsoavector_alignment + mfsoavector_alignment - 1, f.payload + f.unused + f.padding);
+}
+
+TEST(FootprintTest, Bits)
+{
+    mfbitvector b(1000);
+    for (int i = 0; i < 100; ++i)
+    {
+        b.push_back(true);
+    }
+    mffootprint f = b.memory_footprint();
+    EXPECT_EQ(100u, f.elements);
+    EXPECT_EQ(13u, f.payload);
+    EXPECT_EQ(16u * 8, f.payload + f.unused);
+    EXPECT_EQ(0u, f.links);
+    b.build_rank_index();
+    EXPECT_GT(b.memory_footprint().links, 0u);
+
+    mfpackedvector<12> p(100);
+    for (int i = 0; i < 10; ++i)
+    {
+        p.push_back(i);
+    }
+    f = p.memory_footprint();
+    EXPECT_EQ(10u, f.elements);
+    EXPECT_EQ(15u, f.payload);
+    EXPECT_EQ(150u - 15u, f.unused);
+    EXPECT_EQ(mfpacked_padding, f.padding);
+}
+
+TEST(FootprintTest, Ringbuffer)
+{
+    mfringbuffer<int> r(10);
+    r.try_push(1);
+    r.try_push(2);
+    mffootprint f = r.memory_footprint();
+    EXPECT_EQ(2u, f.elements);
+    EXPECT_EQ(2 * sizeof(int), f.payload);
+    EXPECT_EQ(14 * sizeof(int), f.unused);
+    EXPECT_EQ(sizeof(r), f.header);
+}
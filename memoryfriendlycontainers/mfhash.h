@@ -0,0 +1,146 @@
+//
+// Copyright (c) 2014 Jakub Jabłoński
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#ifndef memoryfriendlycontainers_mfhash_h
+#define memoryfriendlycontainers_mfhash_h
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string>
+
+/**
+ * Finalizer of splitmix64: a bijection of 64-bit integers in which every
+ * input bit affects every output bit.
+ */
+constexpr std::uint64_t mfhash_mix(std::uint64_t x)
+{
+	x ^= x >> 30;
+	x *= 0xbf58476d1ce4e5b9ULL;
+	x ^= x >> 27;
+	x *= 0x94d049bb133111ebULL;
+	x ^= x >> 31;
+	return x;
+}
+
+/**
+ * A new seed on every call: a counter started from the clock and its own
+ * address and stepped by the golden ratio, mixed. Not cryptographic, but
+ * keys found to collide in one table or one run don't collide in the next.
+ */
+inline std::size_t mfhash_random_seed()
+{
+	static std::atomic<std::uint64_t> state(std::uint64_t(std::chrono::high_resolution_clock::now().time_since_epoch().count())
+	                                        ^ std::uint64_t(std::uintptr_t(&state)));
+	return std::size_t(mfhash_mix(state.fetch_add(0x9e3779b97f4a7c15ULL, std::memory_order_relaxed)));
+}
+
+/**
+ * Multiplicative hash of the n bytes at p, 8 at a time, starting from seed
+ * and mixed so that the low bits pick buckets well. The seed goes in before
+ * the first byte, so keys that collide under one seed don't under another.
+ */
+inline std::uint64_t mfhash_bytes(const void* p, std::size_t n, std::uint64_t seed)
+{
+	const char* s = static_cast<const char*>(p);
+	std::uint64_t h = 0xcbf29ce484222325ULL ^ seed ^ n;
+	std::size_t i = 0;
+	for (; i + 8 <= n; i += 8)
+	{
+		std::uint64_t w;
+		std::memcpy(&w, s + i, 8);
+		h = (h ^ w) * 0x9e3779b97f4a7c15ULL;
+		h ^= h >> 32;
+	}
+	if (i < n)
+	{
+		std::uint64_t w = 0;
+		std::memcpy(&w, s + i, n - i);
+		h = (h ^ w) * 0x9e3779b97f4a7c15ULL;
+	}
+	return mfhash_mix(h);
+}
+
+/**
+ * Bucket of a key in mfhashmapsc: std::hash of the key plus the seed,
+ * mixed and cut to mask. Specializations need the same members; the map
+ * sets mask from its size and seed to a random value.
+ *
+ * Keys with equal std::hash share a bucket under every seed, so keys whose
+ * std::hash can be made to collide, like strings under an unseeded
+ * std::hash, need a specialization that hashes their contents with the
+ * seed, as std::string's does with mfhash_bytes.
+ */
+template<typename V>
+struct mfhash
+{
+	std::size_t mask;
+	std::size_t seed;
+
+	std::size_t operator()(const V& key) const
+	{
+		return std::size_t(mfhash_mix(std::uint64_t(std::hash<V>()(key)) + seed)) & mask;
+	}
+};
+
+template<>
+struct mfhash<int>
+{
+	std::size_t mask;
+	std::size_t seed;
+
+	std::size_t operator()(int key) const
+	{
+		return std::size_t(mfhash_mix(std::uint64_t(unsigned(key)) + seed)) & mask;
+	}
+};
+
+template<>
+struct mfhash<std::string>
+{
+	std::size_t mask;
+	std::size_t seed;
+
+	std::size_t operator()(const std::string& key) const
+	{
+		return std::size_t(mfhash_bytes(key.data(), key.size(), seed)) & mask;
+	}
+};
+
+/**
+ * Hash of key through mfhash<K> with all bits and a fixed seed, for hashes
+ * that must not change when a map picks a new seed, like those of traces
+ * and filters. Keys only need mfhash, not std::hash.
+ */
+template<typename K>
+std::uint64_t mfhash_stable(const K& key)
+{
+	mfhash<K> h;
+	h.mask = ~std::size_t(0);
+	h.seed = 0;
+	return h(key);
+}
+
+#endif
@@ -26,46 +26,30 @@
 #include <algorithm>
 #include <cstddef>
 #include <functional>
+#include "mfbloom.h"
+#include "mffootprint.h"
+#include "mfhash.h"
+#include "mftrace.h"
 #include "purify.h"
 #include <type_traits>
 #include <iterator>
+#include <limits>
 #include <ostream>
 
 template<typename K, typename V> class mfhashmapsc;
 template<typename K, typename V> std::ostream& operator<<(std::ostream&, const mfhashmapsc<K, V>& v);
 
-template<typename V>
-struct mfhash
-{
-	std::size_t mask;
-    
-	std::size_t operator()(V key)
-	{
-		return std::hash<V>(key) & mask;
-	}
-};
-
-template<>
-struct mfhash<int>
-{
-	std::size_t mask;
-    
-	std::size_t operator()(int key)
-	{
-//		return key & mask;
-        
-		std::size_t h = 0;
-        
-		h += key, h += (h << 10), h ^= (h >> 6);
-        
-		h += (h << 3);
-		h ^= (h >> 11);
-		h += (h << 15);
-        
-		return h & mask;
-	}
-};
+/**
+ * Longest chain mfhashmapsc accepts by default before it picks a new seed.
+ * Random keys at the highest load of 4 per bucket stay far below it.
+ */
+static const std::size_t mfhashmapsc_max_chain = 64;
 
+/**
+ * Insert measures its chain once in 2^mfhashmapsc_chain_check_bits times,
+ * picked by the seed so that keys can't be lined up to dodge the check.
+ */
+static const unsigned mfhashmapsc_chain_check_bits = 3;
 
 /**
  * Hash table using separate chaining with linked lists.
@@ -92,6 +76,13 @@ struct mfhash<int>
  *                           |     \          /               \ /
  *                          /       ---------
  * free_entries_ -----------
+ *
+ * The hash is seeded per map. Keys picked to pile into one bucket would
+ * turn lookups into scans, so insert now and then checks the length of
+ * the chain it extends and, past max_chain(), relinks all entries with a
+ * new random seed. Chains a new seed can't break up, like a key inserted many times,
+ * raise the limit instead. The seed only helps if it goes into the hash of
+ * the key's contents; see mfhash for keys other than integers and strings.
  */
 template<typename K, typename V>
 class mfhashmapsc
@@ -150,7 +141,8 @@ private:
 			}
 			else
 			{
-				while (bucketIx < map->hashsize_ && !(entry = map->buckets_[++bucketIx].first_entry))
+				entry = nullptr;
+				while (++bucketIx < map->hashsize_ && !(entry = map->buckets_[bucketIx].first_entry))
 				{
 				}
                 if (bucketIx == map->hashsize_)
@@ -199,13 +191,13 @@ private:
 	typedef typename std::aligned_storage<sizeof(bucket_t), std::alignment_of<bucket_t>::value>::type uninitialized_bucket;
     
 public:
-    explicit mfhashmapsc(size_t capacity = 0)
+    explicit mfhashmapsc(size_t capacity = 0) : trace_(0), none_()
 	{
 		init(capacity);
 //		std::cout << this << ": constructor" << std::endl;
 	}
     
-	mfhashmapsc(const mfhashmapsc& org)
+	mfhashmapsc(const mfhashmapsc& org) : trace_(0), none_()
 	{
 		if (&org != this)
 		{
@@ -215,7 +207,7 @@ public:
 //		std::cout << this << ": copy constructor from " << (&org) << std::endl;
 	}
     
-	mfhashmapsc(mfhashmapsc&& org)
+	mfhashmapsc(mfhashmapsc&& org) : trace_(0), none_()
 	{
 		init();
 		swap(org);
@@ -255,27 +247,41 @@ public:
     
 	V& operator[](const K& key)
 	{
+		if (bloom_.enabled() && !bloom_.may_contain(bloom_hash(key)))
+		{
+			trace(mftrace_find, key, false);
+			return none_;
+		}
 		std::size_t keyhash = hash_fn(key);
 		for (entry_t* e = buckets_[keyhash].first_entry; e; e = e->next_entry)
 		{
 			if (e->value.first == key)
 			{
+				trace(mftrace_find, key, true);
 				return e->value.second;
 			}
 		}
+		trace(mftrace_find, key, false);
 		return none_;
 	}
     
 	V const& operator[](const K& key) const
 	{
+		if (bloom_.enabled() && !bloom_.may_contain(bloom_hash(key)))
+		{
+			trace(mftrace_find, key, false);
+			return none_;
+		}
 		std::size_t keyhash = hash_fn(key);
 		for (entry_t* e = buckets_[keyhash].first_entry; e; e = e->next_entry)
 		{
 			if (e->value.first == key)
 			{
+				trace(mftrace_find, key, true);
 				return e->value.second;
 			}
 		}
+		trace(mftrace_find, key, false);
 		return none_;
 	}
     
@@ -283,6 +289,7 @@ public:
 	{
 		std::size_t keyhash = hash_fn(key);
 //		std::cout << this << ": insert of key " << key << ", keyhash " <<keyhash << std::endl;
+		trace(mftrace_insert, key, free_entries_ != 0);
         
 		if (free_entries_)
 		{
@@ -292,9 +299,75 @@ public:
 			new (new_entry) entry_t(key, value, buckets_[keyhash].first_entry);
 			buckets_[keyhash].first_entry = new_entry;
 			size_++;
+			if (bloom_.enabled())
+			{
+				bloom_.add(bloom_hash(key));
+			}
+			if (check_chain() && chain_length(new_entry, max_chain_ + 1) > max_chain_)
+			{
+				rehash(mfhash_random_seed());
+			}
 		}
 	}
     
+	/*
+	 * Concurrent mode: any number of threads may call concurrent_insert and
+	 * concurrent_find at once, but nothing else may use the map meanwhile.
+	 *
+	 * Entries are only ever taken from free_entries_, never given back, so
+	 * an entry popped by one thread can't reappear at the head of the list
+	 * and the compare-and-swap pop is free of ABA. A new entry is complete
+	 * before a release CAS makes it the head of its bucket, and lookups
+	 * follow the chain with acquire loads, so they never wait and never see
+	 * a half-built entry. Chains are not checked and nothing is traced;
+	 * a Bloom filter is kept up to date but not consulted.
+	 */
+    
+	/** Inserts like insert(); false if no free entry is left. */
+	bool concurrent_insert(const K& key, const V& value)
+	{
+		entry_t* new_entry = __atomic_load_n(&free_entries_, __ATOMIC_ACQUIRE);
+		while (new_entry && !__atomic_compare_exchange_n(&free_entries_, &new_entry, __atomic_load_n(&new_entry->next_entry, __ATOMIC_RELAXED),
+		                                                 true, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE))
+		{
+		}
+		if (!new_entry)
+		{
+			return false;
+		}
+		// next_entry is written atomically: a thread that lost the race for
+		// this entry may still be reading it.
+		new (&new_entry->value) value_type(key, value);
+		if (bloom_.enabled())
+		{
+			bloom_.concurrent_add(bloom_hash(key));
+		}
+		bucket_t& bucket = buckets_[hash_fn(key)];
+		entry_t* head = __atomic_load_n(&bucket.first_entry, __ATOMIC_RELAXED);
+		do
+		{
+			__atomic_store_n(&new_entry->next_entry, head, __ATOMIC_RELAXED);
+		}
+		while (!__atomic_compare_exchange_n(&bucket.first_entry, &head, new_entry, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+		__atomic_fetch_add(&size_, 1, __ATOMIC_RELAXED);
+		return true;
+	}
+    
+	/** Value of key, or none() if it is not (yet) in the map. */
+	V const& concurrent_find(const K& key) const
+	{
+		std::size_t keyhash = hash_fn(key);
+		for (const entry_t* e = __atomic_load_n(&buckets_[keyhash].first_entry, __ATOMIC_ACQUIRE); e;
+		     e = __atomic_load_n(&e->next_entry, __ATOMIC_ACQUIRE))
+		{
+			if (e->value.first == key)
+			{
+				return e->value.second;
+			}
+		}
+		return none_;
+	}
+    
 	iterator begin()
 	{
         if (buckets_)
@@ -341,6 +414,10 @@ public:
         std::swap(hashmask_, v.hashmask_);
         std::swap(size_, v.size_);
         std::swap(hash_fn, v.hash_fn);
+        std::swap(trace_, v.trace_);
+        std::swap(max_chain_, v.max_chain_);
+        std::swap(rehashes_, v.rehashes_);
+        bloom_.swap(v.bloom_);
         std::swap(none_, v.none_);
 	}
     
@@ -349,6 +426,188 @@ public:
         return none_;
     }
     
+    std::size_t seed() const
+    {
+        return hash_fn.seed;
+    }
+    
+    /**
+     * Relinks all entries into the buckets given by seed. Entries stay
+     * where they are, so references to them remain valid. If a chain is
+     * still longer than max_chain(), the limit is raised to twice its length.
+     */
+    void rehash(std::size_t seed)
+    {
+        entry_t* all = nullptr;
+        for (std::size_t i = 0; i < bucket_count(); ++i)
+        {
+            for (entry_t* e = buckets_[i].first_entry, *next; e; e = next)
+            {
+                next = e->next_entry;
+                e->next_entry = all;
+                all = e;
+            }
+            buckets_[i].first_entry = nullptr;
+        }
+        hash_fn.seed = seed;
+        // all holds every chain reversed, so prepending restores each chain's order.
+        while (all)
+        {
+            entry_t* e = all;
+            all = all->next_entry;
+            std::size_t keyhash = hash_fn(e->value.first);
+            e->next_entry = buckets_[keyhash].first_entry;
+            buckets_[keyhash].first_entry = e;
+        }
+        ++rehashes_;
+        std::size_t longest = longest_chain();
+        if (max_chain_ && longest > max_chain_)
+        {
+            max_chain_ = 2 * longest;
+        }
+    }
+    
+    /** Number of rehashes so far, most of them caused by long chains. */
+    std::size_t rehashes() const
+    {
+        return rehashes_;
+    }
+    
+    /** Longest chain insert accepts before rehashing; 0 turns the check off. */
+    std::size_t max_chain() const
+    {
+        return max_chain_;
+    }
+    
+    void set_max_chain(std::size_t n)
+    {
+        max_chain_ = n;
+    }
+    
+    /** Entries in the longest chain, the most a lookup has to compare. */
+    std::size_t longest_chain() const
+    {
+        std::size_t longest = 0;
+        for (std::size_t i = 0; i < bucket_count(); ++i)
+        {
+            longest = std::max(longest, chain_length(buckets_[i].first_entry, size_));
+        }
+        return longest;
+    }
+    
+    /**
+     * Records every insert and lookup to writer from now on, or stops
+     * recording if writer is 0. The writer must outlive the recording.
+     */
+    void set_trace(mftrace_writer* writer)
+    {
+        trace_ = writer;
+    }
+    
+    /**
+     * Puts a blocked Bloom filter with bits_per_key bits per entry of
+     * capacity in front of lookups, or removes it if bits_per_key is 0.
+     * Most lookups of missing keys are then answered by one cache line of
+     * the filter instead of the bucket and its chain; insert keeps it up
+     * to date.
+     */
+    void set_bloom(unsigned bits_per_key = mfbloom_bits_per_key)
+    {
+        bloom_.reset(bits_per_key ? capacity_ : 0, bits_per_key);
+        rebuild_bloom();
+    }
+    
+    bool has_bloom() const
+    {
+        return bloom_.enabled();
+    }
+    
+    /**
+     * Compacts the Bloom filter: clears it and adds the keys of all entries
+     * again. Keys can't be taken out of a Bloom filter, so this is the step
+     * that forgets keys once entries can be removed.
+     */
+    void rebuild_bloom()
+    {
+        bloom_.clear();
+        if (bloom_.enabled())
+        {
+            for (std::size_t i = 0; i < bucket_count(); ++i)
+            {
+                for (const entry_t* e = buckets_[i].first_entry; e; e = e->next_entry)
+                {
+                    bloom_.add(bloom_hash(e->value.first));
+                }
+            }
+        }
+    }
+    
+    /** Number of buckets; entries are spread over [0, bucket_count()). */
+    std::size_t bucket_count() const
+    {
+        return buckets_ ? hashsize_ : 0;
+    }
+    
+    /**
+     * Calls f(value_type&) for every entry in buckets [bucketIx_begin, bucketIx_end).
+     * Disjoint bucket ranges hold disjoint entries, so several threads may
+     * walk different ranges at once as long as nobody inserts meanwhile.
+     */
+    template<typename F>
+    void for_each_in_buckets(std::size_t bucketIx_begin, std::size_t bucketIx_end, F f)
+    {
+        for (std::size_t i = bucketIx_begin; i < bucketIx_end; ++i)
+        {
+            for (entry_t* e = buckets_[i].first_entry; e; e = e->next_entry)
+            {
+                f(e->value);
+            }
+        }
+    }
+    
+    template<typename F>
+    void for_each_in_buckets(std::size_t bucketIx_begin, std::size_t bucketIx_end, F f) const
+    {
+        for (std::size_t i = bucketIx_begin; i < bucketIx_end; ++i)
+        {
+            for (const entry_t* e = buckets_[i].first_entry; e; e = e->next_entry)
+            {
+                f(static_cast<const value_type&>(e->value));
+            }
+        }
+    }
+    
+    /**
+     * Bytes taken by entries and buckets. Each entry pays for its next
+     * pointer and the padding of entry_t; a used bucket counts as a link,
+     * an empty one as overhead, and so do free entries. A Bloom filter
+     * counts as links.
+     */
+    mffootprint memory_footprint() const
+    {
+        mffootprint f;
+        std::size_t used = 0;
+        for (std::size_t i = 0; i < bucket_count(); ++i)
+        {
+            used += buckets_[i].first_entry != nullptr;
+        }
+        f.elements = size_;
+        f.payload = size_ * (sizeof(K) + sizeof(V));
+        f.padding = size_ * (sizeof(entry_t) - sizeof(K) - sizeof(V) - sizeof(entry_t*));
+        f.links = size_ * sizeof(entry_t*) + used * sizeof(bucket_t);
+        f.empty_buckets = (bucket_count() - used) * sizeof(bucket_t);
+        f.unused = (capacity_ - size_) * sizeof(entry_t);
+        f.header = sizeof(*this);
+        f.add_heap_block(capacity_ * sizeof(entry_t));
+        f.add_heap_block(bucket_count() * sizeof(bucket_t));
+        if (bloom_.enabled())
+        {
+            f.links += bloom_.size_in_bytes();
+            f.add_heap_block(bloom_.allocated_bytes());
+        }
+        return f;
+    }
+    
 private:
 	entry_t* entries_;
 	entry_t* free_entries_;
@@ -358,10 +617,45 @@ private:
 	std::size_t hashmask_;
 	std::size_t size_;
 	mfhash<K> hash_fn;
+	mftrace_writer* trace_;
+	std::size_t max_chain_;
+	std::size_t rehashes_;
+	mfblockedbloom bloom_;
 
     /** Value returned from different functions in case of error. */
 	V none_;
     
+	/** Whether this insert measures its chain; size_ times an odd multiple of the seed is a Weyl sequence. */
+	bool check_chain() const
+	{
+		return max_chain_ && (size_ * (hash_fn.seed | 1)) >> (std::numeric_limits<std::size_t>::digits - mfhashmapsc_chain_check_bits) == 0;
+	}
+    
+	/** Length of the chain starting at e, counting at most limit entries. */
+	static std::size_t chain_length(const entry_t* e, std::size_t limit)
+	{
+		std::size_t n = 0;
+		for (; e && n < limit; e = e->next_entry)
+		{
+			++n;
+		}
+		return n;
+	}
+    
+	/** Hash of key in the Bloom filter; unlike the bucket it doesn't depend on the seed, so rehash keeps the filter. */
+	static std::uint64_t bloom_hash(const K& key)
+	{
+		return mfhash_stable(key);
+	}
+    
+	void trace(mftrace_op op, const K& key, bool hit) const
+	{
+		if (trace_)
+		{
+			trace_->record(op, mftrace_key(key), hit);
+		}
+	}
+    
 	void init(size_t capacity = 0)
 	{
 		capacity_ = capacity;
@@ -373,7 +667,11 @@ private:
 			hashsize_ <<= 1;
 		}
 		hashsize_ >>= 1; // Half size is enough.
-		hash_fn.mask = hashsize_ - 1;
+		hashmask_ = hashsize_ - 1;
+		hash_fn.mask = hashmask_;
+		hash_fn.seed = mfhash_random_seed();
+		max_chain_ = mfhashmapsc_max_chain;
+		rehashes_ = 0;
         
 		if (capacity)
 		{
@@ -390,6 +688,7 @@ private:
 		{
 			entries_ = 0;
 			buckets_ = 0;
+			free_entries_ = 0;
 		}
 	}
     
@@ -421,7 +720,7 @@ std::ostream& operator<<(std::ostream& o, const mfhashmapsc<K, V>& v)
 {
 	o << "mfhashmapsc at " << std::hex << (void *) &v << std::dec << "(size "
     << v.size_ << ", capacity " << v.capacity_ << ", hashsize "
-    << v.hashsize_ << ", mask " << v.hash_fn.mask << ")\n";
+    << v.hashsize_ << ", mask " << v.hash_fn.mask << ", seed " << v.hash_fn.seed << ")\n";
     
 	for (std::size_t i = 0; i < v.hashsize_; ++i)
 	{
@@ -0,0 +1,353 @@
+//
+// Copyright (c) 2014 Jakub Jabłoński
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "mfbench.h"
+#include "mfhashmapsc.h"
+#include "mfparallel.h"
+#include "object.h"
+
+namespace std
+{
+	template<>
+	struct hash<object>
+	{
+		std::size_t operator()(const object& x) const
+		{
+			return std::hash<std::string>()(x.name);
+		}
+	};
+}
+
+/** Buckets from the seeded hash of the name, like mfhash<std::string>. */
+template<>
+struct mfhash<object>
+{
+	std::size_t mask;
+	std::size_t seed;
+
+	std::size_t operator()(const object& key) const
+	{
+		return std::size_t(mfhash_bytes(key.name.data(), key.name.size(), seed)) & mask;
+	}
+};
+
+/** Distinct keys: multiplying by an odd constant is a bijection of 32-bit integers. */
+template<typename K>
+K make_key(std::size_t i);
+
+template<>
+int make_key<int>(std::size_t i)
+{
+	return int(unsigned(i) * 2654435761u);
+}
+
+template<>
+object make_key<object>(std::size_t i)
+{
+	return object(("k" + std::to_string(i)).c_str());
+}
+
+static std::string format(const char* f, double x)
+{
+	char s[32];
+	std::snprintf(s, sizeof(s), f, x);
+	return s;
+}
+
+/**
+ * mfhashmapsc against std::unordered_map: building a map of n entries and
+ * lookups with 0, 50 and 100% of the keys present, for n from L1 sized to
+ * far beyond the last level cache. mfhashmapsc sizes its bucket array from
+ * its capacity, so its load factor is varied through the capacity, and
+ * std::unordered_map gets the same max_load_factor. Results carry the
+ * actual load_factor and hit_ratio as counters.
+ */
+template<typename K>
+static void hashmap_suite(mfbench& b, const std::size_t* sizes, std::size_t count)
+{
+	static const std::size_t queries = 1 << 16;
+	static const int hit_percents[] = { 0, 50, 100 };
+	for (std::size_t s = 0; s < count; ++s)
+	{
+		std::size_t n = sizes[s];
+		std::vector<K> keys;
+		for (std::size_t i = 0; i < n; ++i)
+		{
+			keys.push_back(make_key<K>(i));
+		}
+		for (std::size_t m = 1; m <= 4; m *= 2)
+		{
+			std::size_t capacity = n * m;
+			mfhashmapsc<K, int> map(capacity);
+			for (std::size_t i = 0; i < n; ++i)
+			{
+				map.insert(keys[i], int(i));
+			}
+			double lf = double(n) / map.bucket_count();
+			std::unordered_map<K, int> ref;
+			ref.max_load_factor(float(lf));
+			ref.reserve(n);
+			for (std::size_t i = 0; i < n; ++i)
+			{
+				ref.emplace(keys[i], int(i));
+			}
+			std::string suffix = "/" + std::to_string(n) + "/lf" + format("%.2f", lf);
+
+			b.run("mfhashmapsc/insert" + suffix, n, 0, [&] {
+				mfhashmapsc<K, int> t(capacity);
+				for (std::size_t i = 0; i < n; ++i)
+				{
+					t.insert(keys[i], int(i));
+				}
+				mfbench_keep(t.size());
+			}).counter("load_factor", lf);
+			b.run("std_unordered_map/insert" + suffix, n, 0, [&] {
+				std::unordered_map<K, int> t;
+				t.max_load_factor(float(lf));
+				t.reserve(n);
+				for (std::size_t i = 0; i < n; ++i)
+				{
+					t.emplace(keys[i], int(i));
+				}
+				mfbench_keep(t.size());
+			}).counter("load_factor", ref.load_factor());
+
+			for (std::size_t h = 0; h < sizeof(hit_percents) / sizeof(hit_percents[0]); ++h)
+			{
+				std::vector<K> lookups;
+				std::srand(1);
+				for (std::size_t q = 0; q < queries; ++q)
+				{
+					std::size_t i = (std::size_t(std::rand()) << 15 ^ std::rand()) % n;
+					lookups.push_back(std::rand() % 100 < hit_percents[h] ? keys[i] : make_key<K>(n + i));
+				}
+				std::string label = suffix + "/hit" + std::to_string(hit_percents[h]);
+				double hit_ratio = hit_percents[h] / 100.0;
+
+				b.run("mfhashmapsc/find" + label, queries, 0, [&] {
+					std::size_t sum = 0;
+					for (std::size_t q = 0; q < queries; ++q)
+					{
+						sum += map[lookups[q]];
+					}
+					mfbench_keep(sum);
+				}).counter("load_factor", lf).counter("hit_ratio", hit_ratio);
+				b.run("std_unordered_map/find" + label, queries, 0, [&] {
+					std::size_t sum = 0;
+					for (std::size_t q = 0; q < queries; ++q)
+					{
+						typename std::unordered_map<K, int>::const_iterator i = ref.find(lookups[q]);
+						sum += i != ref.end() ? i->second : 0;
+					}
+					mfbench_keep(sum);
+				}).counter("load_factor", ref.load_factor()).counter("hit_ratio", hit_ratio);
+			}
+		}
+	}
+}
+
+MFBENCH(hashmap_int)
+{
+	static const std::size_t sizes[] = { 1 << 9, 1 << 13, 1 << 17, 1 << 21 };
+	hashmap_suite<int>(b, sizes, sizeof(sizes) / sizeof(sizes[0]));
+}
+
+MFBENCH(hashmap_object)
+{
+	static const std::size_t sizes[] = { 1 << 9, 1 << 13, 1 << 17, 1 << 20 };
+	hashmap_suite<object>(b, sizes, sizeof(sizes) / sizeof(sizes[0]));
+}
+
+/**
+ * Cost of recording: lookups in an L1 sized map with no trace attached and
+ * with one writing to /dev/null, so the file system is not measured.
+ */
+MFBENCH(hashmap_trace)
+{
+	static const std::size_t n = 1 << 12;
+	mfhashmapsc<int, int> map(n);
+	for (std::size_t i = 0; i < n; ++i)
+	{
+		map.insert(make_key<int>(i), int(i));
+	}
+	mftrace_writer writer("/dev/null");
+	for (int recording = 0; recording < 2; ++recording)
+	{
+		map.set_trace(recording ? &writer : 0);
+		b.run(recording ? "find/recording" : "find/off", n, 0, [&] {
+			std::size_t sum = 0;
+			for (std::size_t i = 0; i < n; ++i)
+			{
+				sum += map[make_key<int>(i)];
+			}
+			mfbench_keep(sum);
+		}).counter("trace_bytes_per_op", recording ? double(mftrace_record_bytes) : 0.0);
+	}
+	map.set_trace(0);
+}
+
+/**
+ * Lookups of keys built to pile into one bucket under a known seed, with
+ * the chain limit, which reseeds the map, and without it, which leaves
+ * every lookup scanning the pile.
+ */
+MFBENCH(hashmap_adversarial)
+{
+	static const std::size_t n = 2000;
+	for (int limit = 0; limit < 2; ++limit)
+	{
+		mfhashmapsc<int, int> map(n);
+		map.set_max_chain(limit ? mfhashmapsc_max_chain : 0);
+		map.rehash(1);
+		mfhash<int> h = { map.bucket_count() - 1, 1 };
+		std::vector<int> keys;
+		for (int k = 0; keys.size() < n; ++k)
+		{
+			if (h(k) == 0)
+			{
+				keys.push_back(k);
+			}
+		}
+		for (std::size_t i = 0; i < n; ++i)
+		{
+			map.insert(keys[i], 1);
+		}
+		b.run(limit ? "find/limit" : "find/unchecked", n, 0, [&] {
+			std::size_t sum = 0;
+			for (std::size_t i = 0; i < n; ++i)
+			{
+				sum += map[keys[i]];
+			}
+			mfbench_keep(sum);
+		}).counter("longest_chain", double(map.longest_chain()));
+	}
+}
+
+/**
+ * Filling a map from 1, 2 and 4 threads and looking every key up again:
+ * concurrent_insert and concurrent_find against insert and operator[]
+ * behind one std::mutex. Each thread works on its own chunk of the keys.
+ */
+MFBENCH(hashmap_concurrent)
+{
+	static const std::size_t n = 1 << 18;
+	static const std::size_t chunks = 64;
+	static const unsigned counts[] = { 1, 2, 4 };
+	for (std::size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); ++c)
+	{
+		mfthreadpool pool(counts[c]);
+		std::string suffix = "/threads:" + std::to_string(counts[c]);
+		mfhashmapsc<int, int> filled(n);
+
+		b.run("insert/lock_free" + suffix, n, 0, [&] {
+			mfhashmapsc<int, int> map(n);
+			pool.run(chunks, [&](std::size_t i) {
+				for (std::size_t k = i * (n / chunks); k < (i + 1) * (n / chunks); ++k)
+				{
+					map.concurrent_insert(make_key<int>(k), int(k));
+				}
+			});
+			mfbench_keep(map.size());
+			filled.swap(map);
+		});
+		b.run("insert/mutex" + suffix, n, 0, [&] {
+			mfhashmapsc<int, int> map(n);
+			std::mutex mutex;
+			pool.run(chunks, [&](std::size_t i) {
+				for (std::size_t k = i * (n / chunks); k < (i + 1) * (n / chunks); ++k)
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					map.insert(make_key<int>(k), int(k));
+				}
+			});
+			mfbench_keep(map.size());
+		});
+		b.run("find/lock_free" + suffix, n, 0, [&] {
+			pool.run(chunks, [&](std::size_t i) {
+				std::size_t sum = 0;
+				for (std::size_t k = i * (n / chunks); k < (i + 1) * (n / chunks); ++k)
+				{
+					sum += filled.concurrent_find(make_key<int>(k));
+				}
+				mfbench_keep(sum);
+			});
+		});
+		b.run("find/mutex" + suffix, n, 0, [&] {
+			std::mutex mutex;
+			pool.run(chunks, [&](std::size_t i) {
+				std::size_t sum = 0;
+				for (std::size_t k = i * (n / chunks); k < (i + 1) * (n / chunks); ++k)
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					sum += filled[make_key<int>(k)];
+				}
+				mfbench_keep(sum);
+			});
+		});
+	}
+}
+
+/**
+ * Lookups of which 80% miss, in maps from L1 to well beyond cache size,
+ * without and with the Bloom filter in front.
+ */
+MFBENCH(hashmap_bloom)
+{
+	static const std::size_t sizes[] = { 1 << 12, 1 << 17, 1 << 22 };
+	for (std::size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s)
+	{
+		std::size_t n = sizes[s];
+		mfhashmapsc<int, int> map(n);
+		for (std::size_t i = 0; i < n; ++i)
+		{
+			map.insert(make_key<int>(i), int(i));
+		}
+		// every fifth key is in the map
+		std::vector<int> queries(n);
+		for (std::size_t i = 0; i < n; ++i)
+		{
+			queries[i] = make_key<int>(i % 5 ? n + i : i);
+		}
+		std::string suffix = "/" + std::to_string(n);
+		for (int bloom = 0; bloom < 2; ++bloom)
+		{
+			map.set_bloom(bloom ? mfbloom_bits_per_key : 0);
+			b.run(std::string(bloom ? "find/bloom" : "find/plain") + suffix, n, 0, [&] {
+				std::size_t sum = 0;
+				for (std::size_t i = 0; i < n; ++i)
+				{
+					sum += map[queries[i]];
+				}
+				mfbench_keep(sum);
+			}).counter("bytes_per_entry", map.memory_footprint().bytes_per_element());
+		}
+	}
+}
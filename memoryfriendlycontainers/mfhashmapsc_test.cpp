@@ -20,10 +20,14 @@
 // THE SOFTWARE.
 
 
+#include <algorithm>
 #include <cassert>
+#include <cstdint>
 #include <iostream>
 #include <iterator>
 #include <ostream>
+#include <string>
+#include <thread>
 #include <vector>
 #include <type_traits>
 
@@ -167,3 +171,312 @@ TEST_F(HashmapTest, Swap)
     EXPECT_EQ(2, m1.size());
     EXPECT_EQ(10, m1.capacity());
 }
+
+/** Keys that all land in bucket 0 of a map with the given seed and bucket count. */
+static std::vector<int> colliding_keys(std::size_t seed, std::size_t buckets, std::size_t n)
+{
+    mfhash<int> h;
+    h.mask = buckets - 1;
+    h.seed = seed;
+    std::vector<int> keys;
+    for (int k = 0; keys.size() < n; ++k)
+    {
+        if (h(k) == 0)
+        {
+            keys.push_back(k);
+        }
+    }
+    return keys;
+}
+
+TEST(HashmapSeedTest, PerInstance)
+{
+    mfhashmapsc<int, int> a(16);
+    mfhashmapsc<int, int> b(16);
+    EXPECT_NE(a.seed(), b.seed());
+    EXPECT_EQ(mfhashmapsc_max_chain, a.max_chain());
+    EXPECT_EQ(0, a.rehashes());
+}
+
+TEST(HashmapSeedTest, RehashKeepsEntries)
+{
+    mfhashmapsc<int, int> m(1000);
+    for (int i = 0; i < 1000; ++i)
+    {
+        m.insert(i, i * 2);
+    }
+    int* p = &m[500];
+    m.rehash(12345);
+    EXPECT_EQ(12345, m.seed());
+    EXPECT_EQ(1, m.rehashes());
+    EXPECT_EQ(1000, m.size());
+    EXPECT_EQ(p, &m[500]);
+    for (int i = 0; i < 1000; ++i)
+    {
+        EXPECT_EQ(i * 2, m[i]);
+    }
+    EXPECT_EQ(m.none(), m[1000]);
+}
+
+TEST(HashmapSeedTest, FloodReseeds)
+{
+    mfhashmapsc<int, int> m(4096);
+    m.rehash(1);
+    std::vector<int> keys = colliding_keys(1, m.bucket_count(), 1000);
+    for (std::size_t i = 0; i < keys.size(); ++i)
+    {
+        m.insert(keys[i], int(i));
+    }
+    EXPECT_NE(1, m.seed());
+    EXPECT_LT(1, m.rehashes());
+    EXPECT_EQ(mfhashmapsc_max_chain, m.max_chain());
+    EXPECT_LE(m.longest_chain(), mfhashmapsc_max_chain);
+    for (std::size_t i = 0; i < keys.size(); ++i)
+    {
+        EXPECT_EQ(int(i), m[keys[i]]);
+    }
+
+    mfhashmapsc<int, int> unchecked(4096);
+    unchecked.set_max_chain(0);
+    unchecked.rehash(1);
+    for (std::size_t i = 0; i < keys.size(); ++i)
+    {
+        unchecked.insert(keys[i], int(i));
+    }
+    EXPECT_EQ(1000, unchecked.longest_chain());
+}
+
+TEST(HashmapSeedTest, RepeatedKeyRaisesLimit)
+{
+    mfhashmapsc<int, int> m(1000);
+    for (int i = 0; i < 1000; ++i)
+    {
+        m.insert(7, i);
+    }
+    EXPECT_EQ(1000, m.longest_chain());
+    EXPECT_LE(1000, m.max_chain());
+    EXPECT_GE(5, m.rehashes());
+    EXPECT_EQ(999, m[7]);
+}
+
+/**
+ * Strings built to collide under a known seed: std::string is hashed by
+ * content with the seed, so a new seed breaks the pile up and lookups
+ * scan at most max_chain() entries. Without the limit they scan the whole
+ * pile; the cost in time is the hashmap_adversarial benchmark.
+ */
+TEST(HashmapSeedTest, StringFloodReseeds)
+{
+    static const std::size_t n = 1000;
+    for (int limit = 0; limit < 2; ++limit)
+    {
+        mfhashmapsc<std::string, int> m(4096);
+        m.set_max_chain(limit ? mfhashmapsc_max_chain : 0);
+        m.rehash(1);
+        mfhash<std::string> h = { m.bucket_count() - 1, 1 };
+        std::vector<std::string> keys;
+        for (int k = 0; keys.size() < n; ++k)
+        {
+            std::string key = "key" + std::to_string(k);
+            if (h(key) == 0)
+            {
+                keys.push_back(key);
+            }
+        }
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            m.insert(keys[i], int(i));
+        }
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            EXPECT_EQ(int(i), m[keys[i]]);
+        }
+        if (limit)
+        {
+            EXPECT_NE(1, m.seed());
+            EXPECT_LT(0, m.rehashes());
+            EXPECT_EQ(mfhashmapsc_max_chain, m.max_chain());
+            EXPECT_LE(m.longest_chain(), mfhashmapsc_max_chain);
+        }
+        else
+        {
+            EXPECT_EQ(n, m.longest_chain());
+        }
+    }
+}
+
+TEST(HashmapConcurrentTest, InsertAndFind)
+{
+    static const int threads = 4;
+    static const int per_thread = 20000;
+    mfhashmapsc<int, int> m(threads * per_thread);
+    std::vector<std::thread> workers;
+    std::vector<int> wrong(threads, 0);
+    for (int t = 0; t < threads; ++t)
+    {
+        workers.push_back(std::thread([&m, t] {
+            for (int i = t; i < threads * per_thread; i += threads)
+            {
+                m.concurrent_insert(i, i + 1);
+            }
+        }));
+        // Readers see a key either not yet or with its value.
+        workers.push_back(std::thread([&m, &wrong, t] {
+            for (int i = 0; i < threads * per_thread; ++i)
+            {
+                int v = m.concurrent_find(i);
+                wrong[t] += v != 0 && v != i + 1;
+            }
+        }));
+    }
+    for (std::size_t i = 0; i < workers.size(); ++i)
+    {
+        workers[i].join();
+    }
+    EXPECT_EQ(std::vector<int>(threads, 0), wrong);
+    EXPECT_EQ(threads * per_thread, m.size());
+    EXPECT_FALSE(m.concurrent_insert(-1, 0));
+    for (int i = 0; i < threads * per_thread; ++i)
+    {
+        EXPECT_EQ(i + 1, m.concurrent_find(i));
+        EXPECT_EQ(i + 1, m[i]);
+    }
+    EXPECT_EQ(m.none(), m.concurrent_find(-1));
+}
+
+TEST(HashmapConcurrentTest, RaceForLastEntries)
+{
+    static const int threads = 8;
+    mfhashmapsc<int, int> m(1000);
+    std::vector<int> inserted(threads, 0);
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t)
+    {
+        workers.push_back(std::thread([&m, &inserted, t] {
+            for (int i = 0; i < 1000; ++i)
+            {
+                inserted[t] += m.concurrent_insert(t * 1000 + i, t);
+            }
+        }));
+    }
+    for (std::size_t i = 0; i < workers.size(); ++i)
+    {
+        workers[i].join();
+    }
+    int total = 0;
+    for (int t = 0; t < threads; ++t)
+    {
+        total += inserted[t];
+    }
+    EXPECT_EQ(1000, total);
+    EXPECT_EQ(1000, m.size());
+    std::size_t n = 0;
+    for (mfhashmapsc<int, int>::iterator i = m.begin(), e = m.end(); i != e; ++i)
+    {
+        EXPECT_EQ(i->first / 1000, i->second);
+        ++n;
+    }
+    EXPECT_EQ(1000, n);
+}
+
+TEST(HashmapBloomTest, Lookups)
+{
+    mfhashmapsc<int, int> m(1000);
+    EXPECT_FALSE(m.has_bloom());
+    for (int i = 0; i < 500; ++i)
+    {
+        m.insert(i * 2, i);
+    }
+    // keys inserted before and after the filter is set up
+    m.set_bloom();
+    EXPECT_TRUE(m.has_bloom());
+    for (int i = 500; i < 1000; ++i)
+    {
+        m.insert(i * 2, i);
+    }
+    m.rehash(m.seed() + 1);
+    for (int i = 0; i < 2000; ++i)
+    {
+        EXPECT_EQ(i % 2 ? m.none() : i / 2, m[i]) << i;
+    }
+    const mfhashmapsc<int, int>& c = m;
+    EXPECT_EQ(250, c[500]);
+    EXPECT_EQ(c.none(), c[501]);
+
+    m.rebuild_bloom();
+    EXPECT_EQ(499, m[998]);
+    mffootprint with = m.memory_footprint();
+    m.set_bloom(0);
+    EXPECT_FALSE(m.has_bloom());
+    EXPECT_EQ(499, m[998]);
+    // 10 bits for each of 1000 entries, in 64-byte blocks
+    EXPECT_EQ(20 * 64, with.links - m.memory_footprint().links);
+}
+
+/** Key with an mfhash but no std::hash. */
+struct grid_key
+{
+    int x;
+    int y;
+
+    bool operator==(const grid_key& rhs) const
+    {
+        return x == rhs.x && y == rhs.y;
+    }
+};
+
+template<>
+struct mfhash<grid_key>
+{
+    std::size_t mask;
+    std::size_t seed;
+
+    std::size_t operator()(const grid_key& k) const
+    {
+        return std::size_t(mfhash_mix((std::uint64_t(unsigned(k.x)) << 32 | unsigned(k.y)) + seed)) & mask;
+    }
+};
+
+TEST(HashmapBloomTest, KeyWithoutStdHash)
+{
+    mfhashmapsc<grid_key, int> m(100);
+    for (int i = 0; i < 100; ++i)
+    {
+        grid_key k = { i, -i };
+        m.insert(k, i + 1);
+    }
+    m.set_bloom();
+    m.rehash(m.seed() + 1);
+    for (int i = 0; i < 100; ++i)
+    {
+        grid_key k = { i, -i };
+        grid_key missing = { -i, i + 1 };
+        EXPECT_EQ(i + 1, m[k]);
+        EXPECT_EQ(m.none(), m[missing]);
+    }
+}
+
+TEST(HashmapBloomTest, ConcurrentInsertAndSwap)
+{
+    mfhashmapsc<int, int> m(100), other;
+    m.set_bloom(16);
+    std::thread t([&m] {
+        for (int i = 0; i < 50; ++i)
+        {
+            m.concurrent_insert(i, i + 1);
+        }
+    });
+    for (int i = 50; i < 100; ++i)
+    {
+        m.concurrent_insert(i, i + 1);
+    }
+    t.join();
+    for (int i = 0; i < 100; ++i)
+    {
+        EXPECT_EQ(i + 1, m[i]);
+    }
+    swap(m, other);
+    EXPECT_FALSE(m.has_bloom());
+    EXPECT_TRUE(other.has_bloom());
+    EXPECT_EQ(7, other[6]);
+}
@@ -0,0 +1,352 @@
+//
+// Copyright (c) 2014 Jakub Jabłoński
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#ifndef memoryfriendlycontainers_mfintrusivemap_h
+#define memoryfriendlycontainers_mfintrusivemap_h
+
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+
+#include "mffootprint.h"
+#include "mfhash.h"
+
+/**
+ * Link a type embeds to be put into an mfintrusivemap: the next object in
+ * its bucket, and where the pointer to itself is stored (the bucket or the
+ * previous object's next), so that it can unlink itself without a search.
+ */
+template<typename T>
+struct mfintrusive_hook
+{
+	T* next;
+	T** pprev;
+
+	mfintrusive_hook() : next(nullptr), pprev(nullptr)
+	{}
+
+	/** Whether the owner is in a map. */
+	bool linked() const
+	{
+		return pprev != nullptr;
+	}
+};
+
+/** Default key of an object in an mfintrusivemap: its key() member. */
+template<typename T>
+struct mfintrusive_key
+{
+	typedef typename std::decay<decltype(std::declval<const T&>().key())>::type type;
+
+	type operator()(const T& x) const
+	{
+		return x.key();
+	}
+};
+
+/**
+ * Hash map of objects owned elsewhere, e.g. in a pool, with separate
+ * chaining through a mfintrusive_hook member of the objects:
+ *
+ *   struct order
+ *   {
+ *       mfintrusive_hook<order> hook;
+ *       int id;
+ *       int key() const { return id; }
+ *   };
+ *   mfintrusivemap<order, &order::hook> orders(1000);
+ *
+ * The map owns only its bucket array, sized at construction from the
+ * expected number of objects the way mfhashmapsc sizes it from capacity,
+ * and never allocates afterwards. Insert and erase relink an object in
+ * O(1). An object is in at most one map per hook and must be erased
+ * before it is destroyed; the map doesn't touch objects when it goes away.
+ */
+template<typename T, mfintrusive_hook<T> T::*Hook, typename KeyOf = mfintrusive_key<T> >
+class mfintrusivemap
+{
+public:
+	typedef typename KeyOf::type key_type;
+	typedef T value_type;
+	typedef std::size_t size_type;
+
+private:
+	template<bool is_const_iterator>
+	struct iter : public std::iterator<std::forward_iterator_tag, T>
+	{
+		typedef typename std::conditional<is_const_iterator, T const*, T*>::type pointer;
+		typedef typename std::conditional<is_const_iterator, T const&, T&>::type reference;
+
+		iter(const mfintrusivemap* map, std::size_t bucketIx, T* entry) : map(map), bucketIx(bucketIx), entry(entry)
+		{}
+
+		iter(const iter<false>& other) : map(other.map), bucketIx(other.bucketIx), entry(other.entry)
+		{}
+
+		pointer operator->() const
+		{
+			return entry;
+		}
+
+		reference operator*() const
+		{
+			return *entry;
+		}
+
+		iter& operator++()
+		{
+			if ((entry->*Hook).next)
+			{
+				entry = (entry->*Hook).next;
+			}
+			else
+			{
+				entry = nullptr;
+				while (++bucketIx < map->hashsize_ && !(entry = map->buckets_[bucketIx]))
+				{
+				}
+				if (bucketIx == map->hashsize_)
+				{
+					bucketIx = 0;
+					entry = nullptr;
+				}
+			}
+			return *this;
+		}
+
+		iter operator++(int)
+		{
+			iter org(*this);
+			operator++();
+			return org;
+		}
+
+		const mfintrusivemap* map;
+		std::size_t bucketIx;
+		T* entry;
+
+		friend bool operator==(const iter& lhs, const iter& rhs)
+		{
+			return lhs.map == rhs.map && lhs.bucketIx == rhs.bucketIx && lhs.entry == rhs.entry;
+		}
+
+		friend bool operator!=(const iter& lhs, const iter& rhs)
+		{
+			return !(lhs == rhs);
+		}
+	};
+
+public:
+	typedef iter<false> iterator;
+	typedef iter<true> const_iterator;
+
+	explicit mfintrusivemap(std::size_t capacity = 0, const KeyOf& key_of = KeyOf()) : size_(0), key_of_(key_of)
+	{
+		hashsize_ = 16;
+		while (hashsize_ <= capacity)
+		{
+			hashsize_ <<= 1;
+		}
+		hashsize_ >>= 1;
+		hash_fn.mask = hashsize_ - 1;
+		hash_fn.seed = mfhash_random_seed();
+		buckets_ = new T*[hashsize_]();
+	}
+
+	~mfintrusivemap()
+	{
+		delete [] buckets_;
+	}
+
+	std::size_t size() const
+	{
+		return size_;
+	}
+
+	bool empty() const
+	{
+		return size_ == 0;
+	}
+
+	std::size_t bucket_count() const
+	{
+		return hashsize_;
+	}
+
+	/** Links x at the head of its bucket; x must not be in a map through this hook. */
+	void insert(T& x)
+	{
+		link(x, &buckets_[hash_fn(key_of_(x))]);
+		++size_;
+	}
+
+	/** First object inserted with key, newest first, or nullptr. */
+	T* find(const key_type& key)
+	{
+		for (T* e = buckets_[hash_fn(key)]; e; e = (e->*Hook).next)
+		{
+			if (key_of_(*e) == key)
+			{
+				return e;
+			}
+		}
+		return nullptr;
+	}
+
+	T const* find(const key_type& key) const
+	{
+		return const_cast<mfintrusivemap*>(this)->find(key);
+	}
+
+	/** Unlinks x, which must be in this map. */
+	void erase(T& x)
+	{
+		mfintrusive_hook<T>& h = x.*Hook;
+		*h.pprev = h.next;
+		if (h.next)
+		{
+			(h.next->*Hook).pprev = h.pprev;
+		}
+		h.next = nullptr;
+		h.pprev = nullptr;
+		--size_;
+	}
+
+	/** Unlinks and returns the object find(key) returns, or nullptr. */
+	T* erase(const key_type& key)
+	{
+		T* x = find(key);
+		if (x)
+		{
+			erase(*x);
+		}
+		return x;
+	}
+
+	/** Unlinks all objects. */
+	void clear()
+	{
+		for (std::size_t i = 0; i < hashsize_; ++i)
+		{
+			for (T* e = buckets_[i], *next; e; e = next)
+			{
+				next = (e->*Hook).next;
+				(e->*Hook).next = nullptr;
+				(e->*Hook).pprev = nullptr;
+			}
+			buckets_[i] = nullptr;
+		}
+		size_ = 0;
+	}
+
+	iterator begin()
+	{
+		for (std::size_t i = 0; i < hashsize_; ++i)
+		{
+			if (buckets_[i])
+			{
+				return iterator(this, i, buckets_[i]);
+			}
+		}
+		return end();
+	}
+
+	const_iterator begin() const
+	{
+		return const_cast<mfintrusivemap*>(this)->begin();
+	}
+
+	iterator end()
+	{
+		return iterator(this, 0, nullptr);
+	}
+
+	const_iterator end() const
+	{
+		return const_iterator(this, 0, nullptr);
+	}
+
+	/**
+	 * Exchanges the contents of two maps. The heads of the buckets point
+	 * back into the bucket arrays, which move along with them.
+	 */
+	void swap(mfintrusivemap& m)
+	{
+		std::swap(buckets_, m.buckets_);
+		std::swap(hashsize_, m.hashsize_);
+		std::swap(size_, m.size_);
+		std::swap(hash_fn, m.hash_fn);
+		std::swap(key_of_, m.key_of_);
+	}
+
+	/**
+	 * Bytes the map owns: the bucket array. The objects and their hooks
+	 * belong to the caller and are not counted.
+	 */
+	mffootprint memory_footprint() const
+	{
+		mffootprint f;
+		std::size_t used = 0;
+		for (std::size_t i = 0; i < hashsize_; ++i)
+		{
+			used += buckets_[i] != nullptr;
+		}
+		f.elements = size_;
+		f.links = used * sizeof(T*);
+		f.empty_buckets = (hashsize_ - used) * sizeof(T*);
+		f.header = sizeof(*this);
+		f.add_heap_block(hashsize_ * sizeof(T*));
+		return f;
+	}
+
+private:
+	mfintrusivemap(const mfintrusivemap&);
+	mfintrusivemap& operator=(const mfintrusivemap&);
+
+	T** buckets_;
+	std::size_t hashsize_;
+	std::size_t size_;
+	mfhash<key_type> hash_fn;
+	KeyOf key_of_;
+
+	/** Puts x in front of the object *slot points to. */
+	static void link(T& x, T** slot)
+	{
+		mfintrusive_hook<T>& h = x.*Hook;
+		h.next = *slot;
+		h.pprev = slot;
+		if (h.next)
+		{
+			(h.next->*Hook).pprev = &h.next;
+		}
+		*slot = &x;
+	}
+};
+
+template<typename T, mfintrusive_hook<T> T::*Hook, typename KeyOf>
+void swap(mfintrusivemap<T, Hook, KeyOf>& a, mfintrusivemap<T, Hook, KeyOf>& b)
+{
+	a.swap(b);
+}
+
+#endif
@@ -0,0 +1,187 @@
+//
+// Copyright (c) 2014 Jakub Jabłoński
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "mfintrusivemap.h"
+#include "gtest/gtest.h"
+
+namespace
+{
+    struct order
+    {
+        mfintrusive_hook<order> hook;
+        mfintrusive_hook<order> by_name_hook;
+        int id;
+        std::string name;
+
+        int key() const
+        {
+            return id;
+        }
+    };
+
+    struct order_name
+    {
+        typedef std::string type;
+
+        const std::string& operator()(const order& x) const
+        {
+            return x.name;
+        }
+    };
+
+    typedef mfintrusivemap<order, &order::hook> order_map;
+
+    std::vector<order> make_orders(int n)
+    {
+        std::vector<order> v(n);
+        for (int i = 0; i < n; ++i)
+        {
+            v[i].id = i * 3;
+            v[i].name = "order" + std::to_string(i);
+        }
+        return v;
+    }
+}
+
+TEST(IntrusiveMapTest, InsertFind)
+{
+    std::vector<order> orders = make_orders(1000);
+    order_map m(orders.size());
+    EXPECT_TRUE(m.empty());
+    EXPECT_EQ(nullptr, m.find(3));
+    for (std::size_t i = 0; i < orders.size(); ++i)
+    {
+        m.insert(orders[i]);
+        EXPECT_TRUE(orders[i].hook.linked());
+    }
+    EXPECT_EQ(1000, m.size());
+    for (int i = 0; i < 1000; ++i)
+    {
+        EXPECT_EQ(&orders[i], m.find(i * 3));
+        EXPECT_EQ(nullptr, m.find(i * 3 + 1));
+    }
+    const order_map& c = m;
+    EXPECT_EQ(&orders[5], c.find(15));
+}
+
+TEST(IntrusiveMapTest, Erase)
+{
+    std::vector<order> orders = make_orders(200);
+    order_map m(16);
+    for (std::size_t i = 0; i < orders.size(); ++i)
+    {
+        m.insert(orders[i]);
+    }
+    // chains are long with 16 buckets, so this unlinks heads, middles and tails
+    for (int i = 0; i < 200; i += 2)
+    {
+        m.erase(orders[i]);
+        EXPECT_FALSE(orders[i].hook.linked());
+    }
+    EXPECT_EQ(100, m.size());
+    EXPECT_EQ(&orders[1], m.erase(3));
+    EXPECT_EQ(nullptr, m.erase(3));
+    EXPECT_EQ(99, m.size());
+    for (int i = 0; i < 200; ++i)
+    {
+        EXPECT_EQ(i % 2 && i != 1 ? &orders[i] : nullptr, m.find(i * 3)) << i;
+    }
+    m.insert(orders[0]);
+    EXPECT_EQ(&orders[0], m.find(0));
+    m.clear();
+    EXPECT_EQ(0, m.size());
+    EXPECT_EQ(nullptr, m.find(0));
+    EXPECT_FALSE(orders[0].hook.linked());
+    EXPECT_FALSE(orders[5].hook.linked());
+}
+
+TEST(IntrusiveMapTest, Iterator)
+{
+    std::vector<order> orders = make_orders(300);
+    order_map m(300);
+    EXPECT_TRUE(m.begin() == m.end());
+    for (std::size_t i = 0; i < orders.size(); ++i)
+    {
+        m.insert(orders[i]);
+    }
+    std::vector<int> ids;
+    for (order_map::iterator i = m.begin(); i != m.end(); ++i)
+    {
+        ids.push_back(i->id);
+        EXPECT_EQ(&*i, m.find(i->id));
+    }
+    std::sort(ids.begin(), ids.end());
+    ASSERT_EQ(300, ids.size());
+    for (int i = 0; i < 300; ++i)
+    {
+        EXPECT_EQ(i * 3, ids[i]);
+    }
+    const order_map& c = m;
+    std::size_t n = 0;
+    for (order_map::const_iterator i = c.begin(); i != c.end(); i++)
+    {
+        ++n;
+    }
+    EXPECT_EQ(300, n);
+}
+
+TEST(IntrusiveMapTest, TwoHooks)
+{
+    std::vector<order> orders = make_orders(50);
+    order_map by_id(50);
+    mfintrusivemap<order, &order::by_name_hook, order_name> by_name(50);
+    for (std::size_t i = 0; i < orders.size(); ++i)
+    {
+        by_id.insert(orders[i]);
+        by_name.insert(orders[i]);
+    }
+    EXPECT_EQ(&orders[7], by_name.find("order7"));
+    by_name.erase(orders[7]);
+    EXPECT_EQ(nullptr, by_name.find("order7"));
+    EXPECT_EQ(&orders[7], by_id.find(21));
+}
+
+TEST(IntrusiveMapTest, SwapAndFootprint)
+{
+    std::vector<order> orders = make_orders(10);
+    order_map a(100), b;
+    for (std::size_t i = 0; i < orders.size(); ++i)
+    {
+        a.insert(orders[i]);
+    }
+    swap(a, b);
+    EXPECT_EQ(0, a.size());
+    EXPECT_EQ(10, b.size());
+    b.erase(orders[0]);
+    EXPECT_EQ(&orders[1], b.find(3));
+
+    mffootprint f = b.memory_footprint();
+    EXPECT_EQ(9, f.elements);
+    EXPECT_EQ(0, f.payload);
+    EXPECT_EQ(b.bucket_count() * sizeof(order*), f.links + f.empty_buckets);
+}
@@ -0,0 +1,476 @@
+//
+// Copyright (c) 2014 Jakub Jabłoński
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef memoryfriendlycontainers_mfpackedvector_h
+#define memoryfriendlycontainers_mfpackedvector_h
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+
+#include <ostream>
+
+#include "mffootprint.h"
+#include "mfsimd.h"
+#include "mfvector.h"
+
+/**
+ * Encoding used by mfpackedvector: value i occupies bits [i * b, (i + 1) * b)
+ * of a little-endian bit stream. Eight values take exactly b bytes, so every
+ * group of eight starts at a byte boundary and is decoded at once:
+ *
+ *  - scalar: each value is an unaligned 64-bit load, a shift and a mask;
+ *  - AVX2 (b <= 25): the group's bytes are loaded into both 128-bit halves,
+ *    vpshufb moves the 4 bytes holding each value into its lane, vpsrlvd
+ *    shifts it down and a mask clears the neighbours.
+ *
+ * Buffers keep mfpacked_padding zero bytes after the last group, so loads
+ * never leave the buffer.
+ */
+
+static const std::size_t mfpacked_padding = 32;
+
+inline std::uint64_t mfpacked_load(const unsigned char* p)
+{
+	std::uint64_t x;
+	std::memcpy(&x, p, sizeof(x));
+	return x;
+}
+
+inline void mfpacked_store(unsigned char* p, std::uint64_t x)
+{
+	std::memcpy(p, &x, sizeof(x));
+}
+
+struct mfpacked_scalar
+{
+	static std::uint32_t get(const unsigned char* data, std::size_t i, unsigned bits)
+	{
+		std::size_t pos = i * bits;
+		std::uint64_t mask = (std::uint64_t(1) << bits) - 1;
+		return std::uint32_t((mfpacked_load(data + pos / 8) >> (pos % 8)) & mask);
+	}
+
+	/** Decodes groups of eight values starting at value first (a multiple of 8). */
+	static void decode(const unsigned char* data, std::size_t first, std::size_t groups, unsigned bits, std::uint32_t* out)
+	{
+		for (std::size_t i = first, e = first + 8 * groups; i != e; ++i)
+		{
+			*out++ = get(data, i, bits);
+		}
+	}
+};
+
+#if MFSIMD_X86
+
+/** Shuffle controls and shifts for the AVX2 group decoder, per width. */
+struct mfpacked_decode_table
+{
+	static const unsigned max_bits = 25;
+
+	unsigned char shuffle[max_bits + 1][32];
+	std::uint32_t shift[max_bits + 1][8];
+
+	mfpacked_decode_table()
+	{
+		for (unsigned b = 1; b <= max_bits; ++b)
+		{
+			unsigned half = 4 * b / 8;
+			for (unsigned k = 0; k < 8; ++k)
+			{
+				unsigned pos = k * b;
+				unsigned byte = pos / 8 - (k < 4 ? 0 : half);
+				for (unsigned j = 0; j < 4; ++j)
+				{
+					shuffle[b][4 * k + j] = (unsigned char) (byte + j);
+				}
+				shift[b][k] = pos % 8;
+			}
+		}
+	}
+
+	static const mfpacked_decode_table& get()
+	{
+		static const mfpacked_decode_table table;
+		return table;
+	}
+};
+
+struct mfpacked_avx2
+{
+	static MFSIMD_AVX2 void decode(const unsigned char* data, std::size_t first, std::size_t groups, unsigned bits,
+	                               std::uint32_t* out)
+	{
+		const mfpacked_decode_table& t = mfpacked_decode_table::get();
+		const __m256i shuffle = _mm256_loadu_si256((const __m256i*) t.shuffle[bits]);
+		const __m256i shift = _mm256_loadu_si256((const __m256i*) t.shift[bits]);
+		const __m256i mask = _mm256_set1_epi32((1u << bits) - 1);
+		const unsigned half = 4 * bits / 8;
+		const unsigned char* p = data + first / 8 * bits;
+		for (std::size_t g = 0; g < groups; ++g, p += bits, out += 8)
+		{
+			__m256i x = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*) p)),
+			                                    _mm_loadu_si128((const __m128i*) (p + half)), 1);
+			x = _mm256_and_si256(_mm256_srlv_epi32(_mm256_shuffle_epi8(x, shuffle), shift), mask);
+			_mm256_storeu_si256((__m256i*) out, x);
+		}
+	}
+};
+
+#endif
+
+inline void mfpacked_decode(const unsigned char* data, std::size_t first, std::size_t groups, unsigned bits,
+                            std::uint32_t* out)
+{
+#if MFSIMD_X86
+	if (bits <= mfpacked_decode_table::max_bits && mfsimd_level() == mfsimd_avx2)
+	{
+		mfpacked_avx2::decode(data, first, groups, bits, out);
+		return;
+	}
+#endif
+	mfpacked_scalar::decode(data, first, groups, bits, out);
+}
+
+/** Smallest width that holds max_value. */
+inline unsigned mfpacked_bits_for(std::uint32_t max_value)
+{
+	unsigned b = 1;
+	while (b < 32 && (max_value >> b))
+	{
+		++b;
+	}
+	return b;
+}
+
+template<unsigned Bits> class mfpackedvector;
+template<unsigned Bits> std::ostream& operator<<(std::ostream&, const mfpackedvector<Bits>& v);
+
+/**
+ * Vector of unsigned integers of Bits bits each (1 to 32), packed without
+ * gaps. mfpackedvector<> takes the width at construction instead, 32 if
+ * none is given; a width outside 1 to 32 leaves it with no capacity and
+ * bits() 0. The capacity is fixed at construction as for mfvector:
+ * push_back on a full vector is a no-op and append stores what fits.
+ *
+ * Elements are read by value with operator[] and written with set();
+ * neighbouring elements share bytes, so threads must not write elements
+ * of the same vector concurrently. Iteration decodes 16 values at a time.
+ */
+template<unsigned Bits = 0>
+class mfpackedvector
+{
+	friend std::ostream& operator<<<Bits> (std::ostream& o, const mfpackedvector<Bits>& v);
+
+	static_assert(Bits <= 32, "mfpackedvector holds at most 32 bits per value");
+
+public:
+	typedef std::uint32_t value_type;
+
+	static const std::size_t block = 16;
+
+	/** Input iterator decoding block values at a time into its own buffer. */
+	class const_iterator : public std::iterator<std::input_iterator_tag, std::uint32_t, std::ptrdiff_t,
+	                                            const std::uint32_t*, std::uint32_t>
+	{
+	public:
+		const_iterator(const mfpackedvector* v, std::size_t ix) : v(v), ix(ix), k(0), n(0)
+		{
+			fill();
+		}
+
+		std::uint32_t operator*() const
+		{
+			return buf[k];
+		}
+
+		const_iterator& operator++()
+		{
+			++ix;
+			if (++k == n)
+			{
+				fill();
+			}
+			return *this;
+		}
+
+		const_iterator operator++(int)
+		{
+			const_iterator org(*this);
+			operator++();
+			return org;
+		}
+
+		std::size_t index() const
+		{
+			return ix;
+		}
+
+		friend bool operator==(const const_iterator& lhs, const const_iterator& rhs)
+		{
+			return lhs.ix == rhs.ix;
+		}
+
+		friend bool operator!=(const const_iterator& lhs, const const_iterator& rhs)
+		{
+			return lhs.ix != rhs.ix;
+		}
+
+	private:
+		void fill()
+		{
+			if (ix < v->size_)
+			{
+				k = 0;
+				n = unsigned(std::min(std::size_t(block), v->size_ - ix));
+				v->decode(ix, n, buf);
+			}
+		}
+
+		const mfpackedvector* v;
+		std::size_t ix;
+		unsigned k;
+		unsigned n;
+		std::uint32_t buf[block];
+	};
+
+	explicit mfpackedvector(std::size_t capacity = 0, unsigned bits = Bits ? Bits : 32)
+		: bits_(Bits ? Bits : bits >= 1 && bits <= 32 ? bits : 0), capacity_(Bits || bits_ ? capacity : 0), size_(0)
+	{
+		bytes_.resize_uninitialized(bytes_for(capacity) + mfpacked_padding);
+		std::fill(bytes_.begin(), bytes_.end(), 0);
+	}
+
+	std::size_t capacity() const
+	{
+		return capacity_;
+	}
+
+	std::size_t size() const
+	{
+		return size_;
+	}
+
+	bool empty() const
+	{
+		return size_ == 0;
+	}
+
+	unsigned bits() const
+	{
+		return Bits ? Bits : bits_;
+	}
+
+	std::uint32_t max_value() const
+	{
+		return std::uint32_t((std::uint64_t(1) << bits()) - 1);
+	}
+
+	/** Bytes used by the packed values. */
+	std::size_t size_in_bytes() const
+	{
+		return bytes_for(size_);
+	}
+
+	/** Bytes taken by the packed values; the tail kept for wide loads is padding. */
+	mffootprint memory_footprint() const
+	{
+		mffootprint f;
+		mffootprint bytes = bytes_.memory_footprint();
+		f.elements = size_;
+		f.payload = bytes_for(size_);
+		f.padding = mfpacked_padding;
+		f.unused = bytes.payload + bytes.unused - f.payload - f.padding;
+		f.header = sizeof(*this);
+		f.allocator = bytes.allocator;
+		f.allocations = bytes.allocations;
+		return f;
+	}
+
+	std::uint32_t operator[](std::size_t n) const
+	{
+		return mfpacked_scalar::get(bytes_.begin(), n, bits());
+	}
+
+	/** Stores the low bits() bits of x as element n. */
+	void set(std::size_t n, std::uint32_t x)
+	{
+		unsigned b = bits();
+		std::size_t pos = n * b;
+		std::uint64_t mask = std::uint64_t(max_value()) << (pos % 8);
+		unsigned char* p = bytes_.begin() + pos / 8;
+		mfpacked_store(p, (mfpacked_load(p) & ~mask) | ((std::uint64_t(x) << (pos % 8)) & mask));
+	}
+
+	void push_back(std::uint32_t x)
+	{
+		if (size_ < capacity_)
+		{
+			set(size_++, x);
+		}
+	}
+
+	/**
+	 * Appends [first, last), as many values as fit, and returns their number.
+	 * Values from a group boundary on are encoded eight at a time.
+	 */
+	template<typename I>
+	std::size_t append(I first, I last)
+	{
+		std::size_t n = 0;
+		for (; first != last && size_ < capacity_ && size_ % 8; ++first, ++n)
+		{
+			set(size_++, std::uint32_t(*first));
+		}
+		unsigned b = bits();
+		std::uint64_t mask = max_value();
+		std::uint32_t group[8];
+		while (capacity_ - size_ >= 8)
+		{
+			unsigned k = 0;
+			for (; k < 8 && first != last; ++k, ++first)
+			{
+				group[k] = std::uint32_t(*first);
+			}
+			if (k < 8)
+			{
+				for (unsigned j = 0; j < k; ++j)
+				{
+					set(size_++, group[j]);
+				}
+				return n + k;
+			}
+			unsigned char* p = bytes_.begin() + size_ / 8 * b;
+			std::uint64_t acc = 0;
+			unsigned acc_bits = 0;
+			for (k = 0; k < 8; ++k)
+			{
+				acc |= (group[k] & mask) << acc_bits;
+				acc_bits += b;
+				if (acc_bits >= 32)
+				{
+					std::uint32_t low = std::uint32_t(acc);
+					std::memcpy(p, &low, 4);
+					p += 4;
+					acc >>= 32;
+					acc_bits -= 32;
+				}
+			}
+			for (; acc_bits; acc >>= 8, acc_bits -= 8)
+			{
+				*p++ = (unsigned char) acc;
+			}
+			size_ += 8;
+			n += 8;
+		}
+		for (; first != last && size_ < capacity_; ++first, ++n)
+		{
+			set(size_++, std::uint32_t(*first));
+		}
+		return n;
+	}
+
+	/** Decodes elements [first, first + n) to out. */
+	void decode(std::size_t first, std::size_t n, std::uint32_t* out) const
+	{
+		unsigned b = bits();
+		const unsigned char* data = bytes_.begin();
+		std::size_t i = first;
+		std::size_t e = first + n;
+		for (; i != e && i % 8; ++i)
+		{
+			*out++ = mfpacked_scalar::get(data, i, b);
+		}
+		std::size_t groups = (e - i) / 8;
+		mfpacked_decode(data, i, groups, b, out);
+		out += 8 * groups;
+		for (i += 8 * groups; i != e; ++i)
+		{
+			*out++ = mfpacked_scalar::get(data, i, b);
+		}
+	}
+
+	const_iterator begin() const
+	{
+		return const_iterator(this, 0);
+	}
+
+	const_iterator end() const
+	{
+		return const_iterator(this, size_);
+	}
+
+	/** Sets the size to n (at most the capacity); new elements are 0. */
+	void resize(std::size_t n)
+	{
+		n = std::min(n, capacity_);
+		for (; size_ > n; --size_)
+		{
+			set(size_ - 1, 0);
+		}
+		size_ = n;
+	}
+
+	void clear()
+	{
+		std::fill(bytes_.begin(), bytes_.begin() + bytes_for(size_), 0);
+		size_ = 0;
+	}
+
+	void swap(mfpackedvector& v)
+	{
+		bytes_.swap(v.bytes_);
+		std::swap(bits_, v.bits_);
+		std::swap(capacity_, v.capacity_);
+		std::swap(size_, v.size_);
+	}
+
+private:
+	mfvector<unsigned char> bytes_;
+	unsigned bits_;
+	std::size_t capacity_;
+	std::size_t size_;
+
+	std::size_t bytes_for(std::size_t n) const
+	{
+		return (n * bits() + 7) / 8;
+	}
+};
+
+template<unsigned Bits>
+void swap(mfpackedvector<Bits>& a, mfpackedvector<Bits>& b)
+{
+	a.swap(b);
+}
+
+template<unsigned Bits>
+std::ostream& operator<<(std::ostream& o, const mfpackedvector<Bits>& v)
+{
+	o << "mfpackedvector at " << std::hex << (void *) &v << std::dec << "(size " << v.size_
+	  << ", capacity " << v.capacity_ << ", bits " << v.bits() << ", data " << std::hex
+	  << (void *) v.bytes_.begin() << std::dec << ")";
+	return o;
+}
+
+
+#endif
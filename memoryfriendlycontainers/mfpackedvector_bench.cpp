@@ -0,0 +1,108 @@
+//
+// Copyright (c) 2014 Jakub Jabłoński
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+
+#include "mfbench.h"
+#include "mfpackedvector.h"
+
+static const char* level_names[] = { "scalar", "sse2", "avx2" };
+
+/**
+ * Scanning, random access and appending 1 << 24 values of 11, 17 and 20
+ * bits packed, against the same values in an mfvector<uint32_t>. Bytes are
+ * those of the representation read or written.
+ */
+MFBENCH(packedvector)
+{
+	static const std::size_t n = 1 << 24;
+	static const std::size_t lookups = 1 << 16;
+	static const unsigned widths[] = { 11, 17, 20 };
+	for (std::size_t w = 0; w < sizeof(widths) / sizeof(widths[0]); ++w)
+	{
+		unsigned bits = widths[w];
+		mfvector<std::uint32_t> plain(n);
+		std::srand(bits);
+		for (std::size_t i = 0; i < n; ++i)
+		{
+			plain.push_back(std::uint32_t(std::rand()) & ((1u << bits) - 1));
+		}
+		mfvector<std::uint32_t> positions(lookups);
+		for (std::size_t i = 0; i < lookups; ++i)
+		{
+			positions.push_back(std::uint32_t((std::size_t(std::rand()) << 15 ^ std::rand()) % n));
+		}
+		mfpackedvector<> packed(n, bits);
+		packed.append(plain.begin(), plain.end());
+		std::string suffix = "/" + std::to_string(bits);
+
+		b.run("vector_sum" + suffix, n, n * sizeof(std::uint32_t), [&] {
+			std::uint64_t sum = 0;
+			for (const std::uint32_t* p = plain.begin(); p != plain.end(); ++p)
+			{
+				sum += *p;
+			}
+			mfbench_keep(sum);
+		});
+		b.run("vector_random" + suffix, lookups, 0, [&] {
+			std::uint64_t sum = 0;
+			for (const std::uint32_t* p = positions.begin(); p != positions.end(); ++p)
+			{
+				sum += plain[*p];
+			}
+			mfbench_keep(sum);
+		});
+
+		for (int l = mfsimd_scalar; l <= mfsimd_avx2; l += mfsimd_avx2 - mfsimd_scalar)
+		{
+			if (mfsimd_set_level(mfsimd_level_t(l)) != l)
+			{
+				continue;
+			}
+			b.run(std::string("packed_sum/") + level_names[l] + suffix, n, packed.size_in_bytes(), [&] {
+				std::uint64_t sum = 0;
+				for (mfpackedvector<>::const_iterator i = packed.begin(), e = packed.end(); i != e; ++i)
+				{
+					sum += *i;
+				}
+				mfbench_keep(sum);
+			});
+		}
+		mfsimd_set_level(mfsimd_avx2);
+
+		b.run("packed_random" + suffix, lookups, 0, [&] {
+			std::uint64_t sum = 0;
+			for (const std::uint32_t* p = positions.begin(); p != positions.end(); ++p)
+			{
+				sum += packed[*p];
+			}
+			mfbench_keep(sum);
+		});
+		b.run("packed_append" + suffix, n, packed.size_in_bytes(), [&] {
+			packed.clear();
+			mfbench_keep(packed.append(plain.begin(), plain.end()));
+		});
+	}
+}
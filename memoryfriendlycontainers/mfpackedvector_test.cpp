@@ -0,0 +1,157 @@
+//
+// Copyright (c) 2014 Jakub Jabłoński
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+#include "mfpackedvector.h"
+#include "gtest/gtest.h"
+
+class PackedVectorTest : public ::testing::TestWithParam<mfsimd_level_t>
+{
+protected:
+    PackedVectorTest()
+    {
+        mfsimd_set_level(GetParam());
+    }
+    
+    ~PackedVectorTest()
+    {
+        mfsimd_set_level(mfsimd_avx2);
+    }
+    
+    static std::vector<std::uint32_t> values(std::size_t n, unsigned bits)
+    {
+        std::vector<std::uint32_t> v(n);
+        std::srand(bits);
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            v[i] = std::uint32_t((std::uint64_t(std::rand()) << 16 ^ std::rand()) & ((std::uint64_t(1) << bits) - 1));
+        }
+        return v;
+    }
+};
+
+TEST_P(PackedVectorTest, Fixed)
+{
+    mfpackedvector<11> v(100);
+    EXPECT_EQ(0, v.size());
+    EXPECT_EQ(100, v.capacity());
+    EXPECT_EQ(11, v.bits());
+    EXPECT_EQ(2047, v.max_value());
+    
+    for (std::uint32_t i = 0; i < 101; ++i)
+    {
+        v.push_back(i * 20);
+    }
+    ASSERT_EQ(100, v.size());
+    EXPECT_EQ(138, v.size_in_bytes());
+    EXPECT_EQ(1980, v[99]);
+    
+    v.set(50, 4095);
+    EXPECT_EQ(2047, v[50]);
+    EXPECT_EQ(980, v[49]);
+    EXPECT_EQ(1020, v[51]);
+    
+    v.resize(10);
+    EXPECT_EQ(10, v.size());
+    v.resize(20);
+    EXPECT_EQ(0, v[15]);
+    EXPECT_EQ(180, v[9]);
+}
+
+TEST_P(PackedVectorTest, AllWidths)
+{
+    for (unsigned bits = 1; bits <= 32; ++bits)
+    {
+        std::vector<std::uint32_t> ref = values(1000, bits);
+        mfpackedvector<> v(1000, bits);
+        
+        // Unaligned start, then whole groups, then a tail.
+        v.push_back(ref[0]);
+        v.push_back(ref[1]);
+        v.push_back(ref[2]);
+        EXPECT_EQ(997, v.append(ref.begin() + 3, ref.end()));
+        ASSERT_EQ(1000, v.size());
+        
+        std::size_t i = 0;
+        for (mfpackedvector<>::const_iterator it = v.begin(); it != v.end(); ++it, ++i)
+        {
+            ASSERT_EQ(ref[i], *it) << "bits " << bits << ", index " << i;
+            ASSERT_EQ(ref[i], v[i]);
+        }
+        EXPECT_EQ(1000, i);
+        
+        std::uint32_t out[37];
+        v.decode(5, 37, out);
+        for (std::size_t j = 0; j < 37; ++j)
+        {
+            ASSERT_EQ(ref[5 + j], out[j]);
+        }
+    }
+}
+
+TEST_P(PackedVectorTest, RuntimeWidth)
+{
+    mfpackedvector<> v(10);
+    EXPECT_EQ(32, v.bits());
+    EXPECT_EQ(0xffffffffu, v.max_value());
+    v.push_back(0xffffffffu);
+    v.push_back(0x80000001u);
+    v.push_back(0);
+    EXPECT_EQ(0xffffffffu, v[0]);
+    EXPECT_EQ(0x80000001u, v[1]);
+    EXPECT_EQ(0, v[2]);
+    EXPECT_EQ(12, v.size_in_bytes());
+
+    unsigned rejected[] = { 0, 33, 64 };
+    for (unsigned i = 0; i < 3; ++i)
+    {
+        mfpackedvector<> r(10, rejected[i]);
+        EXPECT_EQ(0, r.bits());
+        EXPECT_EQ(0, r.capacity());
+        EXPECT_EQ(0, r.max_value());
+        r.push_back(1);
+        EXPECT_EQ(0, r.size());
+        std::uint32_t one = 1;
+        EXPECT_EQ(0, r.append(&one, &one + 1));
+        EXPECT_TRUE(r.begin() == r.end());
+    }
+}
+
+TEST_P(PackedVectorTest, AppendFull)
+{
+    std::vector<std::uint32_t> ref = values(50, 17);
+    mfpackedvector<17> v(20);
+    EXPECT_EQ(20, v.append(ref.begin(), ref.end()));
+    EXPECT_EQ(0, v.append(ref.begin(), ref.end()));
+    EXPECT_EQ(ref[19], v[19]);
+    
+    v.clear();
+    EXPECT_EQ(0, v.size());
+    EXPECT_EQ(5, v.append(ref.begin(), ref.begin() + 5));
+    EXPECT_EQ(ref[4], v[4]);
+    EXPECT_EQ(0, v[5]);
+}
+
+INSTANTIATE_TEST_CASE_P(Levels, PackedVectorTest, ::testing::Values(mfsimd_scalar, mfsimd_avx2));
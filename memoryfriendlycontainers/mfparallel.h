@@ -0,0 +1,355 @@
+//
+// Copyright (c) 2014 Jakub Jabłoński
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef memoryfriendlycontainers_mfparallel_h
+#define memoryfriendlycontainers_mfparallel_h
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "mfhashmapsc.h"
+#include "mfvector.h"
+
+/**
+ * Small work-stealing thread pool for fork-join loops.
+ *
+ * A pool of n threads has n - 1 workers; the thread calling run() is the
+ * n-th and works too, so mfthreadpool(1) runs everything on the caller.
+ * Every participant has its own task queue: it takes tasks from the back of
+ * its own queue and, when that is empty, steals from the front of the
+ * others'. Idle workers sleep until tasks are submitted.
+ */
+class mfthreadpool
+{
+public:
+	explicit mfthreadpool(unsigned threads = 0) : stop_(false), pending_(0), next_(0)
+	{
+		if (threads == 0)
+		{
+			threads = std::max(1u, std::thread::hardware_concurrency());
+		}
+		size_ = threads;
+		queues_.reset(new queue[threads]);
+		for (unsigned i = 0; i + 1 < threads; ++i)
+		{
+			workers_.push_back(std::thread(&mfthreadpool::work, this, i));
+		}
+	}
+
+	~mfthreadpool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(sleep_mutex_);
+			stop_ = true;
+		}
+		wake_.notify_all();
+		for (std::size_t i = 0; i < workers_.size(); ++i)
+		{
+			workers_[i].join();
+		}
+	}
+
+	/** Number of threads working on a run(), the caller included. */
+	unsigned size() const
+	{
+		return size_;
+	}
+
+	/**
+	 * Calls f(i) for every i in [0, n), spread over the pool, and returns
+	 * when all calls have finished. May be called from inside a task.
+	 */
+	template<typename F>
+	void run(std::size_t n, F f)
+	{
+		if (size_ == 1 || n == 1)
+		{
+			for (std::size_t i = 0; i < n; ++i)
+			{
+				f(i);
+			}
+			return;
+		}
+
+		std::atomic<std::size_t> remaining(n);
+		unsigned first = next_.fetch_add(1, std::memory_order_relaxed);
+		for (std::size_t i = 0; i < n; ++i)
+		{
+			queue& q = queues_[(first + i) % size_];
+			std::lock_guard<std::mutex> lock(q.mutex);
+			q.tasks.push_back([&f, &remaining, i] {
+				f(i);
+				remaining.fetch_sub(1, std::memory_order_release);
+			});
+		}
+		pending_.fetch_add(n, std::memory_order_release);
+		{
+			std::lock_guard<std::mutex> lock(sleep_mutex_);
+		}
+		wake_.notify_all();
+
+		std::function<void()> task;
+		while (remaining.load(std::memory_order_acquire))
+		{
+			if (take(size_ - 1, task))
+			{
+				task();
+			}
+			else
+			{
+				std::this_thread::yield();
+			}
+		}
+	}
+
+private:
+	struct queue
+	{
+		std::mutex mutex;
+		std::deque<std::function<void()> > tasks;
+	};
+
+	mfthreadpool(const mfthreadpool&);
+	mfthreadpool& operator=(const mfthreadpool&);
+
+	/** Takes a task from the back of queue self, or steals one from another queue. */
+	bool take(unsigned self, std::function<void()>& task)
+	{
+		if (pending_.load(std::memory_order_acquire) == 0)
+		{
+			return false;
+		}
+		for (unsigned k = 0; k < size_; ++k)
+		{
+			queue& q = queues_[(self + k) % size_];
+			std::lock_guard<std::mutex> lock(q.mutex);
+			if (!q.tasks.empty())
+			{
+				if (k == 0)
+				{
+					task = std::move(q.tasks.back());
+					q.tasks.pop_back();
+				}
+				else
+				{
+					task = std::move(q.tasks.front());
+					q.tasks.pop_front();
+				}
+				pending_.fetch_sub(1, std::memory_order_relaxed);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void work(unsigned self)
+	{
+		std::function<void()> task;
+		for (;;)
+		{
+			if (take(self, task))
+			{
+				task();
+				continue;
+			}
+			std::unique_lock<std::mutex> lock(sleep_mutex_);
+			wake_.wait(lock, [this] { return stop_ || pending_.load(std::memory_order_acquire) > 0; });
+			if (stop_)
+			{
+				return;
+			}
+		}
+	}
+
+	unsigned size_;
+	std::unique_ptr<queue[]> queues_;
+	std::vector<std::thread> workers_;
+	std::mutex sleep_mutex_;
+	std::condition_variable wake_;
+	bool stop_;
+	std::atomic<std::size_t> pending_;
+	std::atomic<unsigned> next_;
+};
+
+/** Pool used by the parallel algorithms when none is given, one thread per core. */
+inline mfthreadpool& mfthreadpool_default()
+{
+	static mfthreadpool pool;
+	return pool;
+}
+
+/** Smallest number of elements or buckets worth handing to a task. */
+static const std::size_t mfparallel_grain = 4096;
+
+/** Number of tasks a range of n is split into: a few per thread, none below grain. */
+inline std::size_t mfparallel_chunks(const mfthreadpool& pool, std::size_t n, std::size_t grain)
+{
+	std::size_t chunks = (n + grain - 1) / std::max<std::size_t>(grain, 1);
+	return std::max<std::size_t>(1, std::min<std::size_t>(chunks, 4 * pool.size()));
+}
+
+/**
+ * Calls f(i, begin, end) for consecutive, disjoint ranges covering [0, n).
+ */
+template<typename F>
+void mfparallel_ranges(mfthreadpool& pool, std::size_t n, std::size_t grain, F f)
+{
+	std::size_t chunks = mfparallel_chunks(pool, n, grain);
+	pool.run(chunks, [&](std::size_t i) {
+		f(i, n * i / chunks, n * (i + 1) / chunks);
+	});
+}
+
+/** Folds the values of one chunk, starting from the first one. */
+template<typename R, typename Reduce>
+struct mfparallel_fold
+{
+	Reduce* reduce;
+	R acc;
+	bool any;
+
+	mfparallel_fold(Reduce& reduce, const R& init) : reduce(&reduce), acc(init), any(false)
+	{}
+
+	void operator()(R&& x)
+	{
+		acc = any ? (*reduce)(std::move(acc), std::move(x)) : std::move(x);
+		any = true;
+	}
+};
+
+/**
+ * Calls walk(begin, end, fold) for disjoint ranges covering [0, n) and folds
+ * the chunk results into init in order, so reduce needs to be associative
+ * but not commutative.
+ */
+template<typename R, typename Reduce, typename Walk>
+R mfparallel_reduce(mfthreadpool& pool, std::size_t n, std::size_t grain, R init, Reduce reduce, Walk walk)
+{
+	std::size_t chunks = mfparallel_chunks(pool, n, grain);
+	std::vector<mfparallel_fold<R, Reduce> > partial(chunks, mfparallel_fold<R, Reduce>(reduce, init));
+	pool.run(chunks, [&](std::size_t i) {
+		mfparallel_fold<R, Reduce> fold(reduce, init);
+		walk(n * i / chunks, n * (i + 1) / chunks, fold);
+		partial[i] = std::move(fold);
+	});
+	for (std::size_t i = 0; i < chunks; ++i)
+	{
+		if (partial[i].any)
+		{
+			init = reduce(std::move(init), std::move(partial[i].acc));
+		}
+	}
+	return init;
+}
+
+/*
+ * mfvector: the elements are split into chunks of consecutive elements.
+ */
+
+template<typename T, typename G, typename F>
+void parallel_for_each(mfthreadpool& pool, mfvector<T, G>& v, F f, std::size_t grain = mfparallel_grain)
+{
+	T* data = v.begin();
+	mfparallel_ranges(pool, v.size(), grain, [&](std::size_t, std::size_t b, std::size_t e) {
+		std::for_each(data + b, data + e, f);
+	});
+}
+
+template<typename T, typename G, typename F>
+void parallel_for_each(mfvector<T, G>& v, F f, std::size_t grain = mfparallel_grain)
+{
+	parallel_for_each(mfthreadpool_default(), v, f, grain);
+}
+
+template<typename T, typename G, typename R, typename Reduce, typename Transform>
+R parallel_transform_reduce(mfthreadpool& pool, const mfvector<T, G>& v, R init, Reduce reduce, Transform transform,
+                            std::size_t grain = mfparallel_grain)
+{
+	const T* data = v.begin();
+	return mfparallel_reduce(pool, v.size(), grain, init, reduce, [&](std::size_t b, std::size_t e, mfparallel_fold<R, Reduce>& add) {
+		if (b != e)
+		{
+			R acc = R(transform(data[b]));
+			for (const T* p = data + b + 1; p != data + e; ++p)
+			{
+				acc = reduce(std::move(acc), R(transform(*p)));
+			}
+			add(std::move(acc));
+		}
+	});
+}
+
+template<typename T, typename G, typename R, typename Reduce, typename Transform>
+R parallel_transform_reduce(const mfvector<T, G>& v, R init, Reduce reduce, Transform transform,
+                            std::size_t grain = mfparallel_grain)
+{
+	return parallel_transform_reduce(mfthreadpool_default(), v, init, reduce, transform, grain);
+}
+
+/*
+ * mfhashmapsc: the buckets are split into disjoint [bucketIx_begin, bucketIx_end)
+ * ranges. f may modify values but nothing may insert while this runs.
+ */
+
+template<typename K, typename V, typename F>
+void parallel_for_each(mfthreadpool& pool, mfhashmapsc<K, V>& m, F f, std::size_t grain = mfparallel_grain)
+{
+	mfparallel_ranges(pool, m.bucket_count(), grain, [&](std::size_t, std::size_t b, std::size_t e) {
+		m.for_each_in_buckets(b, e, f);
+	});
+}
+
+template<typename K, typename V, typename F>
+void parallel_for_each(mfhashmapsc<K, V>& m, F f, std::size_t grain = mfparallel_grain)
+{
+	parallel_for_each(mfthreadpool_default(), m, f, grain);
+}
+
+template<typename K, typename V, typename R, typename Reduce, typename Transform>
+R parallel_transform_reduce(mfthreadpool& pool, const mfhashmapsc<K, V>& m, R init, Reduce reduce, Transform transform,
+                            std::size_t grain = mfparallel_grain)
+{
+	typedef typename mfhashmapsc<K, V>::value_type value_type;
+	return mfparallel_reduce(pool, m.bucket_count(), grain, init, reduce, [&](std::size_t b, std::size_t e, mfparallel_fold<R, Reduce>& add) {
+		m.for_each_in_buckets(b, e, [&](const value_type& x) {
+			add(R(transform(x)));
+		});
+	});
+}
+
+template<typename K, typename V, typename R, typename Reduce, typename Transform>
+R parallel_transform_reduce(const mfhashmapsc<K, V>& m, R init, Reduce reduce, Transform transform,
+                            std::size_t grain = mfparallel_grain)
+{
+	return parallel_transform_reduce(mfthreadpool_default(), m, init, reduce, transform, grain);
+}
+
+#endif
@@ -0,0 +1,103 @@
+//
+// Copyright (c) 2014 Jakub Jabłoński
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "mfbench.h"
+#include "mfparallel.h"
+
+/** 1, 2, 4, ... threads up to the number of cores, which is always included. */
+static std::vector<unsigned> thread_counts()
+{
+	unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+	std::vector<unsigned> counts;
+	for (unsigned n = 1; n < cores; n *= 2)
+	{
+		counts.push_back(n);
+	}
+	counts.push_back(cores);
+	return counts;
+}
+
+/**
+ * Scaling of a memory-bound sum and a compute-bound transform over an
+ * mfvector of 1 << 24 ints with 1 to N threads.
+ */
+MFBENCH(parallel_vector)
+{
+	static const std::size_t n = 1 << 24;
+	mfvector<int> v(n);
+	for (std::size_t i = 0; i < n; ++i)
+	{
+		v.push_back(int(i % 1000));
+	}
+	std::vector<unsigned> counts = thread_counts();
+	for (std::size_t c = 0; c < counts.size(); ++c)
+	{
+		mfthreadpool pool(counts[c]);
+		std::string suffix = "/threads:" + std::to_string(counts[c]);
+
+		b.run("sum" + suffix, n, n * sizeof(int), [&] {
+			mfbench_keep(parallel_transform_reduce(pool, v, 0LL, std::plus<long long>(), [](int x) { return (long long) x; }));
+		});
+		b.run("sqrt_sum" + suffix, n, n * sizeof(int), [&] {
+			mfbench_keep(parallel_transform_reduce(pool, v, 0.0, std::plus<double>(), [](int x) { return std::sqrt(double(x)); }));
+		});
+		b.run("for_each" + suffix, n, 2 * n * sizeof(int), [&] {
+			parallel_for_each(pool, v, [](int& x) { x = (x + 1) & 1023; });
+		});
+	}
+}
+
+/**
+ * Scaling of a full scan (aggregation) and an update sweep over an
+ * mfhashmapsc with 1 << 20 entries, split into bucket ranges.
+ */
+MFBENCH(parallel_hashmap)
+{
+	static const std::size_t n = 1 << 20;
+	mfhashmapsc<int, int> m(n);
+	for (std::size_t i = 0; i < n; ++i)
+	{
+		m.insert(int(i), int(i % 1000));
+	}
+	std::vector<unsigned> counts = thread_counts();
+	for (std::size_t c = 0; c < counts.size(); ++c)
+	{
+		mfthreadpool pool(counts[c]);
+		std::string suffix = "/threads:" + std::to_string(counts[c]);
+
+		b.run("sum" + suffix, n, 0, [&] {
+			mfbench_keep(parallel_transform_reduce(pool, m, 0LL, std::plus<long long>(),
+			                                       [](const std::pair<const int, int>& x) { return (long long) x.second; }));
+		});
+		b.run("sweep" + suffix, n, 0, [&] {
+			parallel_for_each(pool, m, [](std::pair<const int, int>& x) { x.second = x.second ? x.second - 1 : 999; });
+		});
+	}
+}
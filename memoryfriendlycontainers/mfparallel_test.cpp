@@ -0,0 +1,123 @@
+//
+// Copyright (c) 2014 Jakub Jabłoński
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#include <atomic>
+#include <cstddef>
+#include <string>
+
+#include "mfparallel.h"
+#include "object.h"
+#include "gtest/gtest.h"
+
+class ParallelTest : public ::testing::Test
+{
+protected:
+    ParallelTest() : pool(4), v(10000), m(10000)
+    {
+		for (int i = 0; i < 10000; ++i)
+		{
+			v.push_back(i);
+			m.insert(i, i);
+		}
+	}
+    
+    mfthreadpool pool;
+    mfvector<int> v;
+    mfhashmapsc<int, int> m;
+};
+
+TEST_F(ParallelTest, Run)
+{
+    EXPECT_EQ(4, pool.size());
+    
+    std::atomic<int> calls(0);
+    std::atomic<int> nested(0);
+    pool.run(10, [&](std::size_t i) {
+		calls += int(i);
+		pool.run(3, [&](std::size_t) { ++nested; });
+	});
+    EXPECT_EQ(45, calls);
+    EXPECT_EQ(30, nested);
+}
+
+TEST_F(ParallelTest, VectorForEach)
+{
+	parallel_for_each(pool, v, [](int& x) { x *= 2; }, 100);
+	for (int i = 0; i < 10000; ++i)
+	{
+		ASSERT_EQ(2 * i, v[i]);
+	}
+    
+    mfvector<int> empty;
+	parallel_for_each(pool, empty, [](int& x) { x = 1; });
+}
+
+TEST_F(ParallelTest, VectorTransformReduce)
+{
+    long long sum = parallel_transform_reduce(pool, v, 7LL, std::plus<long long>(), [](int x) { return x * 3LL; }, 100);
+    EXPECT_EQ(7 + 3LL * 9999 * 10000 / 2, sum);
+    
+    // Chunks are combined in order, so a non-commutative reduce works too.
+    mfvector<object> words(26);
+	for (char c = 'a'; c <= 'z'; ++c)
+	{
+		words.push_back(object(std::string(1, c).c_str()));
+	}
+    std::string joined = parallel_transform_reduce(pool, words, std::string(">"),
+        [](std::string a, std::string b) { return a + b; },
+        [](const object& x) { return x.name; }, 2);
+    EXPECT_EQ(">abcdefghijklmnopqrstuvwxyz", joined);
+    
+    mfvector<int> empty;
+    EXPECT_EQ(5, parallel_transform_reduce(pool, empty, 5, std::plus<int>(), [](int x) { return x; }));
+}
+
+TEST_F(ParallelTest, HashmapForEach)
+{
+	parallel_for_each(pool, m, [](std::pair<const int, int>& x) { x.second = -x.first; }, 16);
+	for (int i = 0; i < 10000; ++i)
+	{
+		ASSERT_EQ(-i, m[i]);
+	}
+    
+    mfhashmapsc<int, int> empty;
+	parallel_for_each(pool, empty, [](std::pair<const int, int>& x) { x.second = 1; });
+}
+
+TEST_F(ParallelTest, HashmapTransformReduce)
+{
+    long long sum = parallel_transform_reduce(pool, m, 0LL, std::plus<long long>(),
+        [](const std::pair<const int, int>& x) { return (long long) x.second; }, 16);
+    EXPECT_EQ(9999LL * 10000 / 2, sum);
+    
+    std::size_t count = parallel_transform_reduce(pool, m, std::size_t(0), std::plus<std::size_t>(),
+        [](const std::pair<const int, int>&) { return std::size_t(1); }, 1);
+    EXPECT_EQ(m.size(), count);
+}
+
+TEST(ParallelDefaultPoolTest, ForEach)
+{
+    mfvector<int> v(100000);
+    v.resize(100000, 1);
+	parallel_for_each(v, [](int& x) { ++x; });
+    EXPECT_EQ(200000, parallel_transform_reduce(v, 0, std::plus<int>(), [](int x) { return x; }));
+}
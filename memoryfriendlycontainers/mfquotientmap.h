@@ -0,0 +1,415 @@
+//
+// Copyright (c) 2014 Jakub Jabłoński
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#ifndef memoryfriendlycontainers_mfquotientmap_h
+#define memoryfriendlycontainers_mfquotientmap_h
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "mffootprint.h"
+#include "mfhash.h"
+
+static const std::uint64_t mfquotient_m1 = 0xbf58476d1ce4e5b9ULL;
+static const std::uint64_t mfquotient_m2 = 0x94d049bb133111ebULL;
+
+/**
+ * Seeded bijection of b-bit integers: multiplications by odd constants and
+ * xorshifts by at least half the width, all modulo 2^b, so every step can
+ * be undone and every key bit reaches the low bits that pick the bucket.
+ */
+struct mfquotient_hash
+{
+	std::uint64_t mask;
+	std::uint64_t seed;
+	unsigned shift;
+
+	mfquotient_hash(unsigned bits, std::uint64_t seed)
+	: mask(bits < 64 ? (std::uint64_t(1) << bits) - 1 : ~std::uint64_t(0)), seed(seed & mask), shift((bits + 1) / 2)
+	{}
+
+	std::uint64_t operator()(std::uint64_t key) const
+	{
+		std::uint64_t x = ((key ^ seed) * mfquotient_m1) & mask;
+		x = ((x ^ (x >> shift)) * mfquotient_m2) & mask;
+		return x ^ (x >> shift);
+	}
+
+	std::uint64_t inverse(std::uint64_t x) const
+	{
+		x = ((x ^ (x >> shift)) * inverse_of(mfquotient_m2)) & mask;
+		x = ((x ^ (x >> shift)) * inverse_of(mfquotient_m1)) & mask;
+		return x ^ seed;
+	}
+
+	/** Multiplicative inverse of odd m modulo 2^64, by Newton's iteration. */
+	static std::uint64_t inverse_of(std::uint64_t m)
+	{
+		std::uint64_t x = m;
+		for (int i = 0; i < 5; ++i)
+		{
+			x *= 2 - m * x;
+		}
+		return x;
+	}
+};
+
+/**
+ * Hash map from integer keys of up to KeyBits bits that stores only part of
+ * each key, with separate chaining like mfhashmapsc.
+ *
+ * Keys go through mfquotient_hash, a bijection of KeyBits-bit integers. The
+ * low log2(bucket_count()) bits of the hash are the bucket, so an entry
+ * only keeps the rest, the quotient, in a Q:
+ *
+ *   hash(key) = | quotient (in entry) | bucket (position) |
+ *
+ * and iteration puts both back together and inverts the hash to get the
+ * key. A map of 100M entries has 2^26 buckets, so keys of up to 58 bits
+ * fit entries with a 32-bit quotient; with uint32_t values an entry takes
+ * 16 bytes instead of the 24 of mfhashmapsc<uint64_t, uint32_t>.
+ *
+ * The map has as many buckets as mfhashmapsc, so the quotient only fits in
+ * Q from min_capacity() entries on: 2^(KeyBits - digits of Q). A map built
+ * for fewer gets no capacity and every insert fails; pick a wider Q for
+ * small maps. The saving is the log2 of the bucket count in bits per key,
+ * so full 64-bit keys only gain over mfhashmapsc<uint64_t, V> in maps of
+ * at least 2^32 entries with a 32-bit Q, or with a 64-bit Q never.
+ *
+ * The hash is seeded per map, but unlike mfhashmapsc the map does not
+ * check chain lengths.
+ */
+template<typename V, unsigned KeyBits, typename Q = std::uint32_t>
+class mfquotientmap
+{
+	static_assert(KeyBits > 0 && KeyBits <= 64, "keys have 1 to 64 bits");
+	static_assert(std::is_unsigned<Q>::value && std::numeric_limits<Q>::digits <= 64, "quotients are unsigned integers of up to 64 bits");
+	static_assert(KeyBits < std::numeric_limits<Q>::digits + std::numeric_limits<std::size_t>::digits,
+	              "min_capacity() must be a std::size_t");
+
+public:
+	typedef std::uint64_t key_type;
+	typedef V mapped_type;
+	typedef std::size_t size_type;
+
+private:
+	struct entry_t
+	{
+		entry_t* next_entry;
+		Q quotient;
+		V value;
+
+		entry_t(Q quotient, const V& value, entry_t* next_entry) : next_entry(next_entry), quotient(quotient), value(value)
+		{}
+	};
+
+	typedef typename std::aligned_storage<sizeof(entry_t), std::alignment_of<entry_t>::value>::type uninitialized_entry;
+
+public:
+	template<bool is_const_iterator>
+	struct iter : public std::iterator<std::forward_iterator_tag, std::pair<const key_type, V> >
+	{
+		typedef typename std::conditional<is_const_iterator, const mfquotientmap, mfquotientmap>::type map_type;
+		typedef typename std::conditional<is_const_iterator, const V&, V&>::type value_reference;
+
+		iter(map_type* map, std::size_t bucketIx, entry_t* entry) : map(map), bucketIx(bucketIx), entry(entry)
+		{}
+
+		iter(const iter<false>& other) : map(other.map), bucketIx(other.bucketIx), entry(other.entry)
+		{}
+
+		/** The key, rebuilt from the bucket and the stored quotient. */
+		key_type key() const
+		{
+			return map->hash_fn.inverse(std::uint64_t(entry->quotient) << map->hashbits_ | bucketIx);
+		}
+
+		value_reference value() const
+		{
+			return entry->value;
+		}
+
+		std::pair<const key_type, value_reference> operator*() const
+		{
+			return std::pair<const key_type, value_reference>(key(), value());
+		}
+
+		iter& operator++()
+		{
+			entry = entry->next_entry;
+			if (!entry)
+			{
+				while (++bucketIx < map->bucket_count() && !(entry = map->buckets_[bucketIx]))
+				{
+				}
+				if (!entry)
+				{
+					bucketIx = 0;
+				}
+			}
+			return *this;
+		}
+
+		iter operator++(int)
+		{
+			iter org(*this);
+			operator++();
+			return org;
+		}
+
+		friend bool operator==(const iter& lhs, const iter& rhs)
+		{
+			return lhs.map == rhs.map && lhs.bucketIx == rhs.bucketIx && lhs.entry == rhs.entry;
+		}
+
+		friend bool operator!=(const iter& lhs, const iter& rhs)
+		{
+			return !(lhs == rhs);
+		}
+
+		map_type* map;
+		std::size_t bucketIx;
+		entry_t* entry;
+	};
+
+	typedef iter<false> iterator;
+	typedef iter<true> const_iterator;
+
+	explicit mfquotientmap(std::size_t capacity = 0) : hash_fn(KeyBits, mfhash_random_seed()), none_()
+	{
+		capacity_ = capacity < min_capacity() ? 0 : capacity;
+		size_ = 0;
+		// As many buckets as mfhashmapsc, the largest power of two up to the capacity.
+		hashbits_ = 4;
+		while ((std::size_t(2) << hashbits_) <= capacity_)
+		{
+			++hashbits_;
+		}
+		hashbits_ = std::min(hashbits_, KeyBits);
+		entries_ = 0;
+		buckets_ = 0;
+		free_entries_ = 0;
+		if (capacity_)
+		{
+			entries_ = (entry_t*) new uninitialized_entry[capacity_];
+			buckets_ = new entry_t*[std::size_t(1) << hashbits_]();
+			for (std::size_t i = 0; i < capacity_; ++i)
+			{
+				entries_[i].next_entry = i + 1 < capacity_ ? &entries_[i + 1] : 0;
+			}
+			free_entries_ = entries_;
+		}
+	}
+
+	~mfquotientmap()
+	{
+		for (iterator i = begin(); i != end(); ++i)
+		{
+			i.entry->~entry_t();
+		}
+		delete [] buckets_;
+		delete [] (uninitialized_entry*) entries_;
+	}
+
+	std::size_t capacity() const
+	{
+		return capacity_;
+	}
+
+	std::size_t size() const
+	{
+		return size_;
+	}
+
+	std::size_t bucket_count() const
+	{
+		return buckets_ ? std::size_t(1) << hashbits_ : 0;
+	}
+
+	/** Fewest entries a map needs for its quotients to fit in Q; maps built for fewer get no capacity. */
+	static std::size_t min_capacity()
+	{
+		return KeyBits <= std::numeric_limits<Q>::digits + 4 ? 0 : std::size_t(1) << (KeyBits - std::numeric_limits<Q>::digits);
+	}
+
+	/** Largest key the map can hold. */
+	static key_type max_key()
+	{
+		return KeyBits < 64 ? (key_type(1) << (KeyBits % 64)) - 1 : ~key_type(0);
+	}
+
+	std::uint64_t seed() const
+	{
+		return hash_fn.seed;
+	}
+
+	V const& none() const
+	{
+		return none_;
+	}
+
+	/** Adds key; false if the map is full or key is above max_key(). */
+	bool insert(key_type key, const V& value)
+	{
+		if (!free_entries_ || key > max_key())
+		{
+			return false;
+		}
+		std::uint64_t h = hash_fn(key);
+		entry_t*& bucket = buckets_[bucket_of(h)];
+		entry_t* new_entry = free_entries_;
+		free_entries_ = free_entries_->next_entry;
+		new (new_entry) entry_t(quotient_of(h), value, bucket);
+		bucket = new_entry;
+		++size_;
+		return true;
+	}
+
+	V& operator[](key_type key)
+	{
+		return const_cast<V&>(static_cast<const mfquotientmap&>(*this)[key]);
+	}
+
+	V const& operator[](key_type key) const
+	{
+		if (buckets_ && key <= max_key())
+		{
+			std::uint64_t h = hash_fn(key);
+			Q quotient = quotient_of(h);
+			for (const entry_t* e = buckets_[bucket_of(h)]; e; e = e->next_entry)
+			{
+				if (e->quotient == quotient)
+				{
+					return e->value;
+				}
+			}
+		}
+		return none_;
+	}
+
+	iterator begin()
+	{
+		std::size_t i = first();
+		return iterator(this, i, i < bucket_count() ? buckets_[i] : 0);
+	}
+
+	const_iterator begin() const
+	{
+		std::size_t i = first();
+		return const_iterator(this, i, i < bucket_count() ? buckets_[i] : 0);
+	}
+
+	iterator end()
+	{
+		return iterator(this, 0, 0);
+	}
+
+	const_iterator end() const
+	{
+		return const_iterator(this, 0, 0);
+	}
+
+	void swap(mfquotientmap& m)
+	{
+		std::swap(entries_, m.entries_);
+		std::swap(free_entries_, m.free_entries_);
+		std::swap(buckets_, m.buckets_);
+		std::swap(capacity_, m.capacity_);
+		std::swap(hashbits_, m.hashbits_);
+		std::swap(size_, m.size_);
+		std::swap(hash_fn, m.hash_fn);
+		std::swap(none_, m.none_);
+	}
+
+	/** Bytes taken by entries and buckets; the stored quotient is the key's share of the payload. */
+	mffootprint memory_footprint() const
+	{
+		mffootprint f;
+		std::size_t used = 0;
+		for (std::size_t i = 0; i < bucket_count(); ++i)
+		{
+			used += buckets_[i] != 0;
+		}
+		f.elements = size_;
+		f.payload = size_ * (sizeof(Q) + sizeof(V));
+		f.padding = size_ * (sizeof(entry_t) - sizeof(Q) - sizeof(V) - sizeof(entry_t*));
+		f.links = size_ * sizeof(entry_t*) + used * sizeof(entry_t*);
+		f.empty_buckets = (bucket_count() - used) * sizeof(entry_t*);
+		f.unused = (capacity_ - size_) * sizeof(entry_t);
+		f.header = sizeof(*this);
+		f.add_heap_block(capacity_ * sizeof(entry_t));
+		f.add_heap_block(bucket_count() * sizeof(entry_t*));
+		return f;
+	}
+
+private:
+	mfquotientmap(const mfquotientmap&);
+	mfquotientmap& operator=(const mfquotientmap&);
+
+	entry_t* entries_;
+	entry_t* free_entries_;
+	entry_t** buckets_;
+	std::size_t capacity_;
+	unsigned hashbits_;
+	std::size_t size_;
+	mfquotient_hash hash_fn;
+
+	/** Value returned from different functions in case of error. */
+	V none_;
+
+	std::size_t bucket_of(std::uint64_t h) const
+	{
+		return std::size_t(h & ((std::uint64_t(1) << hashbits_) - 1));
+	}
+
+	Q quotient_of(std::uint64_t h) const
+	{
+		return Q(h >> hashbits_);
+	}
+
+	/** Index of the first bucket with entries, or 0 if there are none. */
+	std::size_t first() const
+	{
+		for (std::size_t i = 0; i < bucket_count(); ++i)
+		{
+			if (buckets_[i])
+			{
+				return i;
+			}
+		}
+		return 0;
+	}
+};
+
+template<typename V, unsigned KeyBits, typename Q>
+void swap(mfquotientmap<V, KeyBits, Q>& a, mfquotientmap<V, KeyBits, Q>& b)
+{
+	a.swap(b);
+}
+
+#endif
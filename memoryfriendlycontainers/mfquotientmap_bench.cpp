@@ -0,0 +1,86 @@
+//
+// Copyright (c) 2014 Jakub Jabłoński
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "mfbench.h"
+#include "mfhashmapsc.h"
+#include "mfquotientmap.h"
+
+/**
+ * Lookups of 48-bit keys, half of them present, in an mfquotientmap with
+ * 32-bit quotients and in an mfhashmapsc<uint64_t, uint32_t>, with the
+ * bytes each spends per entry. Sizes start at the smallest map whose
+ * quotients fit in 32 bits.
+ */
+MFBENCH(quotientmap)
+{
+	static const std::size_t sizes[] = { 1 << 16, 1 << 19, 1 << 22 };
+	for (std::size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s)
+	{
+		std::size_t n = sizes[s];
+		mfquotientmap<std::uint32_t, 48> q(n);
+		mfhashmapsc<std::uint64_t, std::uint32_t> m(n);
+		for (std::size_t i = 0; i < n; ++i)
+		{
+			q.insert(mfhash_mix(i) >> 16, std::uint32_t(i));
+			m.insert(mfhash_mix(i) >> 16, std::uint32_t(i));
+		}
+		std::string suffix = "/" + std::to_string(n);
+
+		b.run("find/quotient" + suffix, n, 0, [&] {
+			std::size_t sum = 0;
+			for (std::size_t i = 0; i < n; ++i)
+			{
+				sum += q[mfhash_mix(i + (i & 1) * n) >> 16];
+			}
+			mfbench_keep(sum);
+		}).counter("bytes_per_entry", q.memory_footprint().bytes_per_element());
+		b.run("find/hashmapsc" + suffix, n, 0, [&] {
+			std::size_t sum = 0;
+			for (std::size_t i = 0; i < n; ++i)
+			{
+				sum += m[mfhash_mix(i + (i & 1) * n) >> 16];
+			}
+			mfbench_keep(sum);
+		}).counter("bytes_per_entry", m.memory_footprint().bytes_per_element());
+		b.run("iterate/quotient" + suffix, n, 0, [&] {
+			std::uint64_t sum = 0;
+			for (mfquotientmap<std::uint32_t, 48>::const_iterator i = q.begin(); i != q.end(); ++i)
+			{
+				sum += i.key();
+			}
+			mfbench_keep(sum);
+		});
+		b.run("iterate/hashmapsc" + suffix, n, 0, [&] {
+			std::uint64_t sum = 0;
+			for (mfhashmapsc<std::uint64_t, std::uint32_t>::iterator i = m.begin(); i != m.end(); ++i)
+			{
+				sum += i->first;
+			}
+			mfbench_keep(sum);
+		});
+	}
+}
@@ -0,0 +1,163 @@
+//
+// Copyright (c) 2014 Jakub Jabłoński
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "mfhashmapsc.h"
+#include "mfquotientmap.h"
+#include "gtest/gtest.h"
+
+TEST(QuotientHashTest, Bijection)
+{
+    static const unsigned widths[] = { 1, 2, 7, 32, 33, 58, 64 };
+    for (std::size_t w = 0; w < sizeof(widths) / sizeof(widths[0]); ++w)
+    {
+        mfquotient_hash h(widths[w], mfhash_random_seed());
+        for (std::uint64_t i = 0; i < 1000; ++i)
+        {
+            std::uint64_t key = mfhash_mix(i) & h.mask;
+            ASSERT_LE(h(key), h.mask);
+            ASSERT_EQ(key, h.inverse(h(key))) << widths[w] << " bits";
+        }
+    }
+    // every 7-bit key has its own hash
+    mfquotient_hash h(7, 123);
+    std::vector<bool> seen(128, false);
+    for (std::uint64_t key = 0; key < 128; ++key)
+    {
+        EXPECT_FALSE(seen[h(key)]);
+        seen[h(key)] = true;
+    }
+}
+
+TEST(QuotientMapTest, InsertFind)
+{
+    mfquotientmap<int, 40> m(1000);
+    EXPECT_EQ(0, m.size());
+    EXPECT_EQ(m.none(), m[5]);
+    for (int i = 0; i < 1000; ++i)
+    {
+        EXPECT_TRUE(m.insert(mfhash_mix(i) >> 24, i + 1));
+    }
+    EXPECT_FALSE(m.insert(1, 1));
+    EXPECT_EQ(1000, m.size());
+    for (int i = 0; i < 1000; ++i)
+    {
+        EXPECT_EQ(i + 1, m[mfhash_mix(i) >> 24]);
+    }
+    EXPECT_EQ(m.none(), m[12345]);
+    m[mfhash_mix(7) >> 24] = 100;
+    EXPECT_EQ(100, m[mfhash_mix(7) >> 24]);
+}
+
+TEST(QuotientMapTest, KeyRange)
+{
+    mfquotientmap<int, 40> m(300);
+    EXPECT_EQ((1ULL << 40) - 1, m.max_key());
+    EXPECT_TRUE(m.insert(m.max_key(), 1));
+    EXPECT_TRUE(m.insert(0, 2));
+    EXPECT_FALSE(m.insert(m.max_key() + 1, 3));
+    EXPECT_EQ(1, m[m.max_key()]);
+    EXPECT_EQ(2, m[0]);
+    EXPECT_EQ(m.none(), m[m.max_key() + 1]);
+    EXPECT_EQ(256, m.bucket_count());
+}
+
+TEST(QuotientMapTest, MinCapacity)
+{
+    // 40-bit keys in 32-bit quotients need at least 256 buckets
+    EXPECT_EQ(256, (mfquotientmap<int, 40>::min_capacity()));
+    EXPECT_EQ(0, (mfquotientmap<int, 36>::min_capacity()));
+    EXPECT_EQ(1ULL << 32, (mfquotientmap<int, 64>::min_capacity()));
+    EXPECT_EQ(0, (mfquotientmap<int, 64, std::uint64_t>::min_capacity()));
+
+    mfquotientmap<int, 40> m(255);
+    EXPECT_EQ(0, m.capacity());
+    EXPECT_EQ(0, m.bucket_count());
+    EXPECT_FALSE(m.insert(1, 1));
+    EXPECT_EQ(m.none(), m[1]);
+    EXPECT_TRUE(m.begin() == m.end());
+    EXPECT_EQ(0, m.memory_footprint().total() - sizeof(m));
+
+    mfquotientmap<int, 36> small(1);
+    EXPECT_EQ(16, small.bucket_count());
+    EXPECT_TRUE(small.insert(small.max_key(), 1));
+    EXPECT_EQ(small.max_key(), small.begin().key());
+}
+
+TEST(QuotientMapTest, IterationRebuildsKeys)
+{
+    mfquotientmap<std::uint32_t, 64, std::uint64_t> m(500);
+    std::vector<std::uint64_t> keys;
+    for (std::uint32_t i = 0; i < 500; ++i)
+    {
+        keys.push_back(mfhash_mix(i));
+        m.insert(keys.back(), i);
+    }
+    std::vector<std::uint64_t> seen;
+    for (mfquotientmap<std::uint32_t, 64, std::uint64_t>::iterator i = m.begin(); i != m.end(); ++i)
+    {
+        EXPECT_EQ(keys[i.value()], i.key());
+        EXPECT_EQ(i.key(), (*i).first);
+        seen.push_back(i.key());
+    }
+    std::sort(keys.begin(), keys.end());
+    std::sort(seen.begin(), seen.end());
+    EXPECT_TRUE(keys == seen);
+
+    mfquotientmap<std::uint32_t, 64, std::uint64_t> empty;
+    EXPECT_TRUE(empty.begin() == empty.end());
+}
+
+TEST(QuotientMapTest, SmallerEntries)
+{
+    // as many buckets as mfhashmapsc, 48 - 16 bits per quotient
+    static const std::size_t n = 1 << 17;
+    mfquotientmap<std::uint32_t, 48> q(n);
+    mfhashmapsc<std::uint64_t, std::uint32_t> m(n);
+    for (std::uint32_t i = 0; i < n; ++i)
+    {
+        q.insert(mfhash_mix(i) >> 16, i);
+        m.insert(mfhash_mix(i) >> 16, i);
+    }
+    mffootprint fq = q.memory_footprint();
+    mffootprint fm = m.memory_footprint();
+    EXPECT_EQ(n, fq.elements);
+    EXPECT_EQ(n * (4 + 4), fq.payload);
+    EXPECT_EQ(0, fq.padding);
+    EXPECT_EQ(m.bucket_count(), q.bucket_count());
+    EXPECT_LT(fq.total(), fm.total() * 4 / 5);
+}
+
+TEST(QuotientMapTest, Swap)
+{
+    mfquotientmap<int, 32> a(10), b;
+    a.insert(3, 4);
+    swap(a, b);
+    EXPECT_EQ(0, a.size());
+    EXPECT_EQ(a.none(), a[3]);
+    EXPECT_EQ(4, b[3]);
+}
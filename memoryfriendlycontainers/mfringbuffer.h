@@ -0,0 +1,264 @@
+//
+// Copyright (c) 2014 Jakub Jabłoński
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef memoryfriendlycontainers_mfringbuffer_h
+#define memoryfriendlycontainers_mfringbuffer_h
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+#include <ostream>
+
+#include "mffootprint.h"
+
+template<typename T> class mfringbuffer;
+template<typename T> std::ostream& operator<<(std::ostream&, const mfringbuffer<T>& v);
+
+/** Size of a cache line; fields written by different threads are kept this far apart. */
+static const std::size_t mfringbuffer_cache_line = 64;
+
+/**
+ * Lock-free single producer, single consumer queue with a capacity fixed at
+ * construction (rounded up to a power of two). One thread may call the
+ * try_push functions and another the try_pop functions; nothing blocks,
+ * a full or empty buffer makes them return false or 0.
+ *
+ * head_ and tail_ only ever grow; slots are indexed with index & mask_.
+ * Each side keeps a private copy of the other side's index and reloads
+ * it (with acquire) only when the copy says the buffer is full or empty,
+ * so in steady state a push or pop touches no cache line written by the
+ * other thread except the slot itself.
+ *
+ *      consumer line               producer line               shared, read-only
+ *     --------------------------  --------------------------  -------------------
+ *    | head_ | cached_tail_     || tail_ | cached_head_     || data_ | mask_     |
+ *     --------------------------  --------------------------  -------------------
+ *
+ * Unlike mfvector the unused slots are not watched: they are written by one
+ * thread while the other reads the rest of the buffer.
+ */
+template<typename T>
+class mfringbuffer
+{
+	friend std::ostream& operator<<<T> (std::ostream& o, const mfringbuffer<T>& v);
+
+	typedef typename std::aligned_storage<sizeof(T), std::alignment_of<T>::value>::type uninitialized_T;
+
+public:
+	explicit mfringbuffer(std::size_t capacity) : head_(0), cached_tail_(0), tail_(0), cached_head_(0)
+	{
+		std::size_t n = 1;
+		while (n < capacity)
+		{
+			n <<= 1;
+		}
+		mask_ = n - 1;
+		data_ = (T*) (new uninitialized_T[n]);
+	}
+
+	~mfringbuffer()
+	{
+		for (std::size_t h = head_.load(std::memory_order_relaxed), t = tail_.load(std::memory_order_relaxed); h != t; ++h)
+		{
+			data_[h & mask_].~T();
+		}
+		delete[] ((uninitialized_T *) data_);
+	}
+
+	std::size_t capacity() const
+	{
+		return mask_ + 1;
+	}
+
+	/** Number of queued elements; only a snapshot when called concurrently. */
+	std::size_t size() const
+	{
+		return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+	}
+
+	/**
+	 * Bytes taken by the slots; a snapshot like size(). The cache line
+	 * padding between the indexes is part of the header.
+	 */
+	mffootprint memory_footprint() const
+	{
+		mffootprint f;
+		f.elements = size();
+		f.payload = f.elements * sizeof(T);
+		f.unused = (capacity() - f.elements) * sizeof(T);
+		f.header = sizeof(*this);
+		f.add_heap_block(capacity() * sizeof(T));
+		return f;
+	}
+
+	bool empty() const
+	{
+		return size() == 0;
+	}
+
+	/*
+	 * Producer side.
+	 */
+
+	bool try_push(const T& x)
+	{
+		return try_emplace(x);
+	}
+
+	bool try_push(T&& x)
+	{
+		return try_emplace(std::move(x));
+	}
+
+	template<typename... Args>
+	bool try_emplace(Args&&... args)
+	{
+		std::size_t t = tail_.load(std::memory_order_relaxed);
+		if (t - cached_head_ > mask_)
+		{
+			cached_head_ = head_.load(std::memory_order_acquire);
+			if (t - cached_head_ > mask_)
+			{
+				return false;
+			}
+		}
+		new (&data_[t & mask_]) T(std::forward<Args>(args)...);
+		tail_.store(t + 1, std::memory_order_release);
+		return true;
+	}
+
+	/**
+	 * Copies as many of the n elements as fit and publishes them at once.
+	 * Returns the number of elements pushed.
+	 */
+	std::size_t try_push_n(const T* src, std::size_t n)
+	{
+		std::size_t t = tail_.load(std::memory_order_relaxed);
+		std::size_t room = capacity() - (t - cached_head_);
+		if (room < n)
+		{
+			cached_head_ = head_.load(std::memory_order_acquire);
+			room = capacity() - (t - cached_head_);
+			n = std::min(n, room);
+		}
+		for (std::size_t i = 0; i < n; ++i)
+		{
+			new (&data_[(t + i) & mask_]) T(src[i]);
+		}
+		if (n)
+		{
+			tail_.store(t + n, std::memory_order_release);
+		}
+		return n;
+	}
+
+	/*
+	 * Consumer side.
+	 */
+
+	bool try_pop(T& x)
+	{
+		std::size_t h = head_.load(std::memory_order_relaxed);
+		if (h == cached_tail_)
+		{
+			cached_tail_ = tail_.load(std::memory_order_acquire);
+			if (h == cached_tail_)
+			{
+				return false;
+			}
+		}
+		T* e = &data_[h & mask_];
+		x = std::move(*e);
+		e->~T();
+		head_.store(h + 1, std::memory_order_release);
+		return true;
+	}
+
+	/**
+	 * Moves up to n queued elements to dst and releases their slots at once.
+	 * Returns the number of elements popped.
+	 */
+	std::size_t try_pop_n(T* dst, std::size_t n)
+	{
+		std::size_t h = head_.load(std::memory_order_relaxed);
+		std::size_t available = cached_tail_ - h;
+		if (available < n)
+		{
+			cached_tail_ = tail_.load(std::memory_order_acquire);
+			available = cached_tail_ - h;
+			n = std::min(n, available);
+		}
+		for (std::size_t i = 0; i < n; ++i)
+		{
+			T* e = &data_[(h + i) & mask_];
+			dst[i] = std::move(*e);
+			e->~T();
+		}
+		if (n)
+		{
+			head_.store(h + n, std::memory_order_release);
+		}
+		return n;
+	}
+
+	/** Element try_pop would return next; only for the consumer. */
+	T* front()
+	{
+		std::size_t h = head_.load(std::memory_order_relaxed);
+		if (h == cached_tail_)
+		{
+			cached_tail_ = tail_.load(std::memory_order_acquire);
+			if (h == cached_tail_)
+			{
+				return 0;
+			}
+		}
+		return &data_[h & mask_];
+	}
+
+private:
+	mfringbuffer(const mfringbuffer&);
+	mfringbuffer& operator=(const mfringbuffer&);
+
+	alignas(mfringbuffer_cache_line) std::atomic<std::size_t> head_;
+	std::size_t cached_tail_;
+
+	alignas(mfringbuffer_cache_line) std::atomic<std::size_t> tail_;
+	std::size_t cached_head_;
+
+	alignas(mfringbuffer_cache_line) T* data_;
+	std::size_t mask_;
+};
+
+template<typename T>
+std::ostream& operator<<(std::ostream& o, const mfringbuffer<T>& v)
+{
+	o << "mfringbuffer at " << std::hex << (void *) &v << std::dec << "(head "
+	  << v.head_.load() << ", tail " << v.tail_.load() << ", capacity " << v.capacity()
+	  << ", data " << std::hex << (void *) v.data_ << std::dec << ")";
+	return o;
+}
+
+
+#endif
@@ -0,0 +1,183 @@
+//
+// Copyright (c) 2014 Jakub Jabłoński
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <thread>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "mfbench.h"
+#include "mfringbuffer.h"
+
+/**
+ * Pins the calling thread to a CPU, wrapping around when the machine has
+ * fewer. Where affinity can't be set the thread is left to the scheduler.
+ */
+static void pin_thread(unsigned cpu)
+{
+#ifdef __linux__
+	unsigned cpus = std::max(1u, std::thread::hardware_concurrency());
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(cpu % cpus, &set);
+	pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+	(void) cpu;
+#endif
+}
+
+/** Busy-waits, but gives the CPU away when the other thread isn't running. */
+struct spin_wait
+{
+	unsigned spins;
+
+	spin_wait() : spins(0)
+	{}
+
+	void operator()()
+	{
+		if (++spins % 256 == 0)
+		{
+			std::this_thread::yield();
+		}
+	}
+};
+
+/**
+ * Throughput of moving items from a producer on CPU 1 to a consumer on
+ * CPU 0, one item at a time and in batches of 16.
+ */
+MFBENCH(ringbuffer_throughput)
+{
+	static const std::size_t items = 1 << 22;
+	static const std::size_t batches[] = { 1, 16 };
+	pin_thread(0);
+	for (std::size_t s = 0; s < sizeof(batches) / sizeof(batches[0]); ++s)
+	{
+		std::size_t batch = batches[s];
+		b.run((batch == 1 ? "single" : "batch" + std::to_string(batch)), items, items * sizeof(std::uint64_t), [&] {
+			mfringbuffer<std::uint64_t> r(1024);
+			std::thread producer([&] {
+				pin_thread(1);
+				std::uint64_t buf[16];
+				for (std::size_t i = 0; i < items; )
+				{
+					if (batch == 1)
+					{
+						spin_wait wait;
+						while (!r.try_push(i))
+						{
+							wait();
+						}
+						++i;
+					}
+					else
+					{
+						for (std::size_t j = 0; j < batch; ++j)
+						{
+							buf[j] = i + j;
+						}
+						spin_wait wait;
+						for (std::size_t n = r.try_push_n(buf, batch); n < batch; n += r.try_push_n(buf + n, batch - n))
+						{
+							wait();
+						}
+						i += batch;
+					}
+				}
+			});
+			std::uint64_t buf[16];
+			std::uint64_t sum = 0;
+			spin_wait wait;
+			for (std::size_t i = 0; i < items; )
+			{
+				std::size_t n = batch == 1 ? r.try_pop(buf[0]) : r.try_pop_n(buf, batch);
+				for (std::size_t j = 0; j < n; ++j)
+				{
+					sum += buf[j];
+				}
+				i += n;
+				if (n == 0)
+				{
+					wait();
+				}
+			}
+			producer.join();
+			mfbench_keep(sum);
+		});
+	}
+}
+
+/**
+ * One-way latency, measured as half the round trip of a token sent to an
+ * echo thread on CPU 1 through one buffer and back through another.
+ */
+MFBENCH(ringbuffer_latency)
+{
+	static const std::size_t round_trips = 1 << 16;
+	pin_thread(0);
+	mfringbuffer<std::uint64_t> ping(64), pong(64);
+	std::atomic<bool> stop(false);
+	std::thread echo([&] {
+		pin_thread(1);
+		std::uint64_t x;
+		spin_wait wait;
+		while (!stop.load(std::memory_order_relaxed))
+		{
+			if (ping.try_pop(x))
+			{
+				pong.try_push(x);
+			}
+			else
+			{
+				wait();
+			}
+		}
+	});
+
+	typedef std::chrono::steady_clock clock;
+	clock::time_point start = clock::now();
+	for (std::uint64_t i = 0; i < round_trips; ++i)
+	{
+		std::uint64_t x;
+		spin_wait wait;
+		ping.try_push(i);
+		while (!pong.try_pop(x))
+		{
+			wait();
+		}
+		mfbench_keep(x);
+	}
+	double ns = std::chrono::duration<double, std::nano>(clock::now() - start).count();
+	stop = true;
+	echo.join();
+
+	b.report("one_way", ns / round_trips / 2, 1);
+}
@@ -0,0 +1,155 @@
+//
+// Copyright (c) 2014 Jakub Jabłoński
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#include <algorithm>
+#include <cstddef>
+#include <string>
+#include <thread>
+
+#include "mfringbuffer.h"
+#include "object.h"
+#include "gtest/gtest.h"
+
+class RingBufferTest : public ::testing::Test
+{
+protected:
+    RingBufferTest() : r(5)
+    {}
+    
+    mfringbuffer<object> r;
+};
+
+TEST_F(RingBufferTest, Initial)
+{
+    EXPECT_EQ(8, r.capacity());
+    EXPECT_EQ(0, r.size());
+    EXPECT_TRUE(r.empty());
+    EXPECT_TRUE(r.front() == 0);
+    
+    object x;
+    EXPECT_FALSE(r.try_pop(x));
+}
+
+TEST_F(RingBufferTest, PushPop)
+{
+	for (int i = 0; i < 8; ++i)
+	{
+		EXPECT_TRUE(r.try_push(object(std::to_string(i).c_str())));
+	}
+    EXPECT_EQ(8, r.size());
+    EXPECT_FALSE(r.try_push(object("full")));
+    EXPECT_EQ("0", r.front()->name);
+    
+    object x;
+	for (int i = 0; i < 8; ++i)
+	{
+		EXPECT_TRUE(r.try_pop(x));
+		EXPECT_EQ(std::to_string(i), x.name);
+	}
+    EXPECT_TRUE(r.empty());
+    EXPECT_FALSE(r.try_pop(x));
+}
+
+TEST_F(RingBufferTest, WrapAround)
+{
+    object x;
+	for (int i = 0; i < 100; ++i)
+	{
+		EXPECT_TRUE(r.try_emplace(std::to_string(i).c_str()));
+		EXPECT_TRUE(r.try_emplace(std::to_string(i).c_str()));
+		EXPECT_TRUE(r.try_pop(x));
+		EXPECT_TRUE(r.try_pop(x));
+		EXPECT_EQ(std::to_string(i), x.name);
+	}
+    EXPECT_TRUE(r.empty());
+}
+
+TEST_F(RingBufferTest, Batch)
+{
+    object in[10] = { "a", "b", "c", "d", "e", "f", "g", "h", "i", "j" };
+    object out[10];
+    
+    EXPECT_EQ(3, r.try_push_n(in, 3));
+    EXPECT_EQ(5, r.try_push_n(in + 3, 7));
+    EXPECT_EQ(0, r.try_push_n(in + 8, 2));
+    EXPECT_EQ(8, r.size());
+    
+    EXPECT_EQ(6, r.try_pop_n(out, 6));
+    EXPECT_EQ(2, r.try_push_n(in + 8, 2));
+    EXPECT_EQ(4, r.try_pop_n(out + 6, 10));
+    EXPECT_EQ(0, r.try_pop_n(out, 10));
+	for (int i = 0; i < 10; ++i)
+	{
+		EXPECT_EQ(in[i], out[i]);
+	}
+}
+
+TEST(RingBufferThreadsTest, ProducerConsumer)
+{
+    const std::size_t n = 1 << 20;
+    mfringbuffer<std::size_t> r(64);
+    
+    std::thread producer([&] {
+		std::size_t batch[7];
+		std::size_t i = 0;
+		while (i < n)
+		{
+			if (i % 2)
+			{
+				i += r.try_push(i) ? 1 : 0;
+			}
+			else
+			{
+				std::size_t k = std::min<std::size_t>(7, n - i);
+				for (std::size_t j = 0; j < k; ++j)
+				{
+					batch[j] = i + j;
+				}
+				i += r.try_push_n(batch, k);
+			}
+			if (r.size() == r.capacity())
+			{
+				std::this_thread::yield();
+			}
+		}
+	});
+    
+    std::size_t expected = 0;
+    std::size_t bad = 0;
+    std::size_t batch[5];
+	while (expected < n)
+	{
+		std::size_t k = r.try_pop_n(batch, 5);
+		for (std::size_t j = 0; j < k; ++j)
+		{
+			bad += batch[j] != expected++;
+		}
+		if (k == 0)
+		{
+			std::this_thread::yield();
+		}
+	}
+    producer.join();
+    
+    EXPECT_EQ(0, bad);
+    EXPECT_TRUE(r.empty());
+}
@@ -0,0 +1,516 @@
+//
+// Copyright (c) 2014 Jakub Jabłoński
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef memoryfriendlycontainers_mfsegvector_h
+#define memoryfriendlycontainers_mfsegvector_h
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include <ostream>
+
+#include "mffootprint.h"
+#include "mfvector.h"
+#include "purify.h"
+
+/**
+ * Pool of equally sized memory blocks. Released blocks are kept on a free
+ * list and handed out again, so vectors that shrink and grow do not go back
+ * to the system allocator. One pool can be shared by any number of
+ * mfsegvectors whose segments fit in its blocks; it must outlive all of
+ * them. A vector given a pool with smaller blocks uses its own instead.
+ */
+class mfsegpool
+{
+public:
+	explicit mfsegpool(std::size_t block_size) : block_size_(std::max(block_size, sizeof(block_t))), free_blocks_(0), allocated_(0), free_(0)
+	{}
+
+	~mfsegpool()
+	{
+		while (free_blocks_)
+		{
+			block_t* b = free_blocks_;
+			free_blocks_ = b->next_block;
+			::operator delete(b);
+		}
+	}
+
+	std::size_t block_size() const
+	{
+		return block_size_;
+	}
+
+	/** Number of blocks obtained from the system, in use or free. */
+	std::size_t allocated() const
+	{
+		return allocated_;
+	}
+
+	/** Number of blocks on the free list. */
+	std::size_t free() const
+	{
+		return free_;
+	}
+
+	void* allocate()
+	{
+		if (free_blocks_)
+		{
+			block_t* b = free_blocks_;
+			free_blocks_ = b->next_block;
+			--free_;
+			return b;
+		}
+		++allocated_;
+		return ::operator new(block_size_);
+	}
+
+	void deallocate(void* p)
+	{
+		block_t* b = (block_t*) p;
+		b->next_block = free_blocks_;
+		free_blocks_ = b;
+		++free_;
+	}
+
+	/** Returns the free blocks to the system. */
+	void trim()
+	{
+		while (free_blocks_)
+		{
+			block_t* b = free_blocks_;
+			free_blocks_ = b->next_block;
+			::operator delete(b);
+			--allocated_;
+			--free_;
+		}
+	}
+
+private:
+	struct block_t
+	{
+		block_t* next_block;
+	};
+
+	mfsegpool(const mfsegpool&);
+	mfsegpool& operator=(const mfsegpool&);
+
+	std::size_t block_size_;
+	block_t* free_blocks_;
+	std::size_t allocated_;
+	std::size_t free_;
+};
+
+template<typename T, unsigned SegmentBits> class mfsegvector;
+template<typename T, unsigned SegmentBits> std::ostream& operator<<(std::ostream&, const mfsegvector<T, SegmentBits>& v);
+
+/**
+ * Vector made of segments of 2^SegmentBits elements.
+ *
+ *               ---- ---- ----
+ * segments_ -> | S0 | S1 | S2 |                  (mfvector of pointers)
+ *               ---- ---- ----
+ *                |    |    |
+ *                v    v    v
+ *               ---  ---  ---
+ *              | 0 || 4 || 8 |  <- size_ == 10, segments of 4 elements
+ *              | 1 || 5 || 9 |
+ *              | 2 || 6 |  .
+ *              | 3 || 7 |  .
+ *               ---  ---  ---
+ *
+ * Element n is segments_[n >> SegmentBits][n & mask]. Segments are taken
+ * from the pool only when the first element is put in them, and given back
+ * when the vector shrinks, so memory follows size(). Elements never move:
+ * growing only appends a segment pointer, so pointers and references to
+ * elements stay valid until the element is removed.
+ */
+template<typename T, unsigned SegmentBits = 10>
+class mfsegvector
+{
+	friend std::ostream& operator<<<T, SegmentBits> (std::ostream& o, const mfsegvector<T, SegmentBits>& v);
+
+	static_assert(std::alignment_of<T>::value <= std::alignment_of<std::max_align_t>::value,
+	              "segments come from ::operator new, which doesn't align beyond max_align_t");
+
+	template<bool is_const_iterator>
+	struct iter : public std::iterator<std::random_access_iterator_tag, T>
+	{
+		typedef typename std::conditional<is_const_iterator, const mfsegvector, mfsegvector>::type vector_type;
+		typedef typename std::conditional<is_const_iterator, T const*, T*>::type pointer;
+		typedef typename std::conditional<is_const_iterator, T const&, T&>::type reference;
+
+		iter(vector_type* v, std::size_t ix) : v(v), ix(ix) {}
+		iter(const iter<false>& other) : v(other.v), ix(other.ix) {}
+
+		reference operator*() const
+		{
+			return (*v)[ix];
+		}
+
+		pointer operator->() const
+		{
+			return &(*v)[ix];
+		}
+
+		reference operator[](std::ptrdiff_t n) const
+		{
+			return (*v)[ix + n];
+		}
+
+		iter& operator++()
+		{
+			++ix;
+			return *this;
+		}
+
+		iter operator++(int)
+		{
+			iter org(*this);
+			++ix;
+			return org;
+		}
+
+		iter& operator--()
+		{
+			--ix;
+			return *this;
+		}
+
+		iter operator--(int)
+		{
+			iter org(*this);
+			--ix;
+			return org;
+		}
+
+		iter& operator+=(std::ptrdiff_t n)
+		{
+			ix += n;
+			return *this;
+		}
+
+		iter& operator-=(std::ptrdiff_t n)
+		{
+			ix -= n;
+			return *this;
+		}
+
+		friend iter operator+(iter i, std::ptrdiff_t n)
+		{
+			return i += n;
+		}
+
+		friend iter operator-(iter i, std::ptrdiff_t n)
+		{
+			return i -= n;
+		}
+
+		friend std::ptrdiff_t operator-(const iter& lhs, const iter& rhs)
+		{
+			return lhs.ix - rhs.ix;
+		}
+
+		friend bool operator==(const iter& lhs, const iter& rhs)
+		{
+			return lhs.v == rhs.v && lhs.ix == rhs.ix;
+		}
+
+		friend bool operator!=(const iter& lhs, const iter& rhs)
+		{
+			return !(lhs == rhs);
+		}
+
+		friend bool operator<(const iter& lhs, const iter& rhs)
+		{
+			return lhs.ix < rhs.ix;
+		}
+
+		vector_type* v;
+		std::size_t ix;
+	};
+
+public:
+	typedef T value_type;
+	typedef iter<false> iterator;
+	typedef iter<true> const_iterator;
+
+	static const std::size_t segment_size = std::size_t(1) << SegmentBits;
+	static const std::size_t segment_mask = segment_size - 1;
+
+	/**
+	 * Creates an empty vector taking segments from pool, or from a pool of
+	 * its own if none is given or pool's blocks can't hold a segment.
+	 */
+	explicit mfsegvector(mfsegpool* pool = 0)
+		: own_pool_(segment_size * sizeof(T)), pool_(pool && pool->block_size() >= segment_size * sizeof(T) ? pool : &own_pool_),
+		  size_(0), watch(-1)
+	{
+	}
+
+	mfsegvector(const mfsegvector& org) : own_pool_(segment_size * sizeof(T)), pool_(org.pool_ == &org.own_pool_ ? &own_pool_ : org.pool_), size_(0), watch(-1)
+	{
+		for (std::size_t i = 0; i < org.size_; ++i)
+		{
+			push_back(org[i]);
+		}
+	}
+
+	mfsegvector(mfsegvector&& org) : own_pool_(segment_size * sizeof(T)), pool_(&own_pool_), size_(0), watch(-1)
+	{
+		swap(org);
+	}
+
+	mfsegvector& operator=(const mfsegvector& org)
+	{
+		if (&org != this)
+		{
+			clear();
+			for (std::size_t i = 0; i < org.size_; ++i)
+			{
+				push_back(org[i]);
+			}
+		}
+		return *this;
+	}
+
+	~mfsegvector()
+	{
+		stop_watch();
+		clear_unwatched();
+		release_segments(0);
+	}
+
+	std::size_t size() const
+	{
+		return size_;
+	}
+
+	/** Number of elements that fit in the segments currently held. */
+	std::size_t capacity() const
+	{
+		return segments_.size() << SegmentBits;
+	}
+
+	std::size_t segment_count() const
+	{
+		return segments_.size();
+	}
+
+	/**
+	 * Bytes taken by the segments held and the segment table, which counts
+	 * as links. Free blocks kept by the pool are not included.
+	 */
+	mffootprint memory_footprint() const
+	{
+		mffootprint f;
+		mffootprint table = segments_.memory_footprint();
+		f.elements = size_;
+		f.payload = size_ * sizeof(T);
+		f.unused = (capacity() - size_) * sizeof(T);
+		f.padding = segments_.size() * (pool_->block_size() - segment_size * sizeof(T));
+		f.links = table.payload + table.unused;
+		f.header = sizeof(*this);
+		f.allocator = table.allocator;
+		f.allocations = table.allocations;
+		for (std::size_t i = 0; i < segments_.size(); ++i)
+		{
+			f.add_heap_block(pool_->block_size());
+		}
+		return f;
+	}
+
+	mfsegpool& pool()
+	{
+		return *pool_;
+	}
+
+	T& operator[](std::size_t n)
+	{
+		return segments_[n >> SegmentBits][n & segment_mask];
+	}
+
+	const T& operator[](std::size_t n) const
+	{
+		return segments_[n >> SegmentBits][n & segment_mask];
+	}
+
+	T& back()
+	{
+		return (*this)[size_ - 1];
+	}
+
+	iterator begin()
+	{
+		return iterator(this, 0);
+	}
+
+	const_iterator begin() const
+	{
+		return const_iterator(this, 0);
+	}
+
+	iterator end()
+	{
+		return iterator(this, size_);
+	}
+
+	const_iterator end() const
+	{
+		return const_iterator(this, size_);
+	}
+
+	void push_back(const T& x)
+	{
+		emplace_back(x);
+	}
+
+	void push_back(T&& x)
+	{
+		emplace_back(std::move(x));
+	}
+
+	/**
+	 * Appends an element, taking a new segment from the pool if the last one
+	 * is full. Existing elements never move, so args may refer to them.
+	 */
+	template<typename... Args>
+	void emplace_back(Args&&... args)
+	{
+		stop_watch();
+		if (size_ == capacity())
+		{
+			T* segment = (T*) pool_->allocate();
+			segments_.push_back(segment);
+		}
+		new (&(*this)[size_]) T(std::forward<Args>(args)...);
+		++size_;
+		start_watch();
+	}
+
+	void pop_back()
+	{
+		stop_watch();
+		(*this)[--size_].~T();
+		release_segments(size_);
+		start_watch();
+	}
+
+	void clear()
+	{
+		stop_watch();
+		clear_unwatched();
+		release_segments(0);
+		start_watch();
+	}
+
+	void swap(mfsegvector& v)
+	{
+		stop_watch();
+		v.stop_watch();
+		segments_.swap(v.segments_);
+		std::swap(size_, v.size_);
+		// Blocks are plain ::operator new allocations of the same size, so a
+		// vector may return segments to another vector's own pool.
+		mfsegpool* p = pool_ == &own_pool_ ? 0 : pool_;
+		mfsegpool* vp = v.pool_ == &v.own_pool_ ? 0 : v.pool_;
+		pool_ = vp ? vp : &own_pool_;
+		v.pool_ = p ? p : &v.own_pool_;
+		start_watch();
+		v.start_watch();
+	}
+
+private:
+	mfsegpool own_pool_;
+	mfsegpool* pool_;
+	mfvector<T*, mfgrowth_geometric> segments_;
+	std::size_t size_;
+	int watch;
+
+	void clear_unwatched()
+	{
+		while (size_)
+		{
+			(*this)[--size_].~T();
+		}
+	}
+
+	/**
+	 * Returns the segments not needed for n elements to the pool, keeping
+	 * one spare segment so that alternating push_back/pop_back at a segment
+	 * boundary does not hit the pool every time.
+	 */
+	void release_segments(std::size_t n)
+	{
+		std::size_t needed = (n + segment_mask) >> SegmentBits;
+		std::size_t keep = n ? needed + 1 : 0;
+		while (segments_.size() > keep)
+		{
+			pool_->deallocate(segments_[segments_.size() - 1]);
+			segments_.erase(segments_.end() - 1);
+		}
+	}
+
+	void start_watch()
+	{
+		if (size_ & segment_mask)
+		{
+			T* last = segments_[size_ >> SegmentBits];
+			std::size_t used = size_ & segment_mask;
+			watch = purify_watch_n((char *) &last[used], (segment_size - used) * sizeof(T), (char *) "rw");
+		}
+		else
+		{
+			watch = -1;
+		}
+	}
+
+	void stop_watch()
+	{
+		if (watch != -1)
+		{
+			purify_watch_remove(watch);
+		}
+	}
+};
+
+template<typename T, unsigned SegmentBits>
+void swap(mfsegvector<T, SegmentBits>& a, mfsegvector<T, SegmentBits>& b)
+{
+	a.swap(b);
+}
+
+template<typename T, unsigned SegmentBits>
+std::ostream& operator<<(std::ostream& o, const mfsegvector<T, SegmentBits>& v)
+{
+	o << "mfsegvector at " << std::hex << (void *) &v << std::dec << "(size " << v.size_
+	  << ", segments " << v.segments_.size() << " of " << v.segment_size << ", pool "
+	  << std::hex << (void *) v.pool_ << std::dec << ")";
+	return o;
+}
+
+
+#endif
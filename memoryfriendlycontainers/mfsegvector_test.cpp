@@ -0,0 +1,167 @@
+//
+// Copyright (c) 2014 Jakub Jabłoński
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+#include "mfsegvector.h"
+#include "object.h"
+#include "gtest/gtest.h"
+
+class SegVectorTest : public ::testing::Test
+{
+protected:
+    SegVectorTest() : pool(4 * sizeof(object)), v(&pool)
+    {}
+    
+    mfsegpool pool;
+    mfsegvector<object, 2> v;
+    mfsegvector<object, 2> own;
+};
+
+TEST_F(SegVectorTest, Initial)
+{
+    EXPECT_EQ(0, v.size());
+    EXPECT_EQ(0, v.capacity());
+    EXPECT_EQ(0, v.segment_count());
+    EXPECT_EQ(v.begin(), v.end());
+    EXPECT_EQ(0, pool.allocated());
+}
+
+TEST_F(SegVectorTest, PushBack)
+{
+	v.push_back(object("a"));
+    EXPECT_EQ(1, v.size());
+    EXPECT_EQ(4, v.capacity());
+    EXPECT_EQ(1, pool.allocated());
+
+	for (int i = 0; i < 8; ++i)
+	{
+		v.emplace_back("b");
+	}
+    EXPECT_EQ(9, v.size());
+    EXPECT_EQ(12, v.capacity());
+    EXPECT_EQ(3, v.segment_count());
+    EXPECT_EQ(object("a"), v[0]);
+    EXPECT_EQ(object("b"), v[8]);
+}
+
+TEST_F(SegVectorTest, StableAddresses)
+{
+	v.push_back(object("a"));
+    object* a = &v[0];
+	for (int i = 0; i < 100; ++i)
+	{
+		v.push_back(v[0]);
+	}
+    EXPECT_EQ(a, &v[0]);
+    EXPECT_EQ(object("a"), v[100]);
+}
+
+TEST_F(SegVectorTest, SegmentsReturnToPool)
+{
+	for (int i = 0; i < 16; ++i)
+	{
+		v.push_back(object("a"));
+	}
+    EXPECT_EQ(4, pool.allocated());
+    EXPECT_EQ(0, pool.free());
+
+	for (int i = 0; i < 11; ++i)
+	{
+		v.pop_back();
+	}
+    EXPECT_EQ(5, v.size());
+    EXPECT_EQ(3, v.segment_count()); // two needed plus a spare one
+    EXPECT_EQ(1, pool.free());
+
+	own.push_back(object("x"));
+	v.clear();
+    EXPECT_EQ(0, v.segment_count());
+    EXPECT_EQ(4, pool.free());
+
+	for (int i = 0; i < 8; ++i)
+	{
+		v.push_back(object("c"));
+	}
+    EXPECT_EQ(4, pool.allocated());
+    EXPECT_EQ(2, pool.free());
+
+	pool.trim();
+    EXPECT_EQ(2, pool.allocated());
+}
+
+TEST_F(SegVectorTest, Iterator)
+{
+	for (int i = 0; i < 10; ++i)
+	{
+		v.push_back(object(std::string(1, char('a' + i)).c_str()));
+	}
+    EXPECT_EQ(10, v.end() - v.begin());
+    int n = 0;
+    for (mfsegvector<object, 2>::const_iterator i = v.begin(), e = v.end(); i != e; ++i)
+    {
+        EXPECT_EQ('a' + n++, i->name[0]);
+    }
+    EXPECT_EQ(10, n);
+    EXPECT_EQ(object("f"), *(v.begin() + 5));
+    EXPECT_EQ(v.begin() + 3, std::find(v.begin(), v.end(), object("d")));
+}
+
+TEST_F(SegVectorTest, CopySwap)
+{
+	for (int i = 0; i < 6; ++i)
+	{
+		v.push_back(object("a"));
+	}
+	mfsegvector<object, 2> c(v);
+    EXPECT_EQ(6, c.size());
+    EXPECT_EQ(&pool, &c.pool());
+
+	own.push_back(object("b"));
+	swap(own, v);
+    EXPECT_EQ(1, v.size());
+    EXPECT_EQ(6, own.size());
+    EXPECT_EQ(&pool, &own.pool());
+    EXPECT_NE(&pool, &v.pool());
+    EXPECT_EQ(object("b"), v[0]);
+
+	mfsegvector<object, 2> m(std::move(own));
+    EXPECT_EQ(6, m.size());
+    EXPECT_EQ(0, own.size());
+}
+
+TEST_F(SegVectorTest, SmallPoolNotShared)
+{
+	mfsegpool small(3 * sizeof(object));
+	mfsegvector<object, 2> s(&small);
+    EXPECT_NE(&small, &s.pool());
+	for (int i = 0; i < 9; ++i)
+	{
+		s.push_back(object("a"));
+	}
+    EXPECT_EQ(9, s.size());
+    EXPECT_EQ(0, small.allocated());
+    EXPECT_EQ(3, s.pool().allocated());
+    EXPECT_EQ(0, s.memory_footprint().padding);
+}
@@ -0,0 +1,90 @@
+//
+// Copyright (c) 2014 Jakub Jabłoński
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef memoryfriendlycontainers_mfsimd_h
+#define memoryfriendlycontainers_mfsimd_h
+
+#include <algorithm>
+
+/**
+ * Runtime selection of SIMD kernels. Kernels are compiled for their
+ * instruction set with MFSIMD_SSE2/MFSIMD_AVX2 function attributes, so the
+ * rest of the program needs no special compiler flags, and are only called
+ * when mfsimd_level() reports that the CPU supports them.
+ */
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define MFSIMD_X86 1
+#include <immintrin.h>
+#define MFSIMD_SSE2 __attribute__((target("sse2"))) inline
+#define MFSIMD_AVX2 __attribute__((target("avx2,popcnt,bmi,bmi2"))) inline
+#else
+#define MFSIMD_X86 0
+#endif
+
+enum mfsimd_level_t
+{
+	mfsimd_scalar,
+	mfsimd_sse2,
+	mfsimd_avx2
+};
+
+inline mfsimd_level_t mfsimd_detect()
+{
+#if MFSIMD_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt")
+	    && __builtin_cpu_supports("bmi") && __builtin_cpu_supports("bmi2"))
+	{
+		return mfsimd_avx2;
+	}
+	if (__builtin_cpu_supports("sse2"))
+	{
+		return mfsimd_sse2;
+	}
+#endif
+	return mfsimd_scalar;
+}
+
+inline mfsimd_level_t& mfsimd_current()
+{
+	static mfsimd_level_t level = mfsimd_detect();
+	return level;
+}
+
+/** Instruction set used by the kernels. */
+inline mfsimd_level_t mfsimd_level()
+{
+	return mfsimd_current();
+}
+
+/**
+ * Restricts the kernels to the given instruction set (e.g. to compare them
+ * in tests and benchmarks); levels the CPU lacks are ignored. Returns the
+ * level now in use.
+ */
+inline mfsimd_level_t mfsimd_set_level(mfsimd_level_t level)
+{
+	mfsimd_current() = std::min(level, mfsimd_detect());
+	return mfsimd_current();
+}
+
+#endif
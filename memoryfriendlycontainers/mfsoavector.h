@@ -0,0 +1,461 @@
+//
+// Copyright (c) 2014 Jakub Jabłoński
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef memoryfriendlycontainers_mfsoavector_h
+#define memoryfriendlycontainers_mfsoavector_h
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include <ostream>
+
+#include "mffootprint.h"
+#include "purify.h"
+
+/** Contiguous range of elements owned by somebody else. */
+template<typename T>
+struct mfspan
+{
+	T* data;
+	std::size_t count;
+
+	mfspan(T* data, std::size_t count) : data(data), count(count)
+	{}
+
+	std::size_t size() const
+	{
+		return count;
+	}
+
+	T* begin() const
+	{
+		return data;
+	}
+
+	T* end() const
+	{
+		return data + count;
+	}
+
+	T& operator[](std::size_t n) const
+	{
+		return data[n];
+	}
+};
+
+template<std::size_t... I>
+struct mfsoa_indices
+{};
+
+template<std::size_t N, std::size_t... I>
+struct mfsoa_make_indices : mfsoa_make_indices<N - 1, N - 1, I...>
+{};
+
+template<std::size_t... I>
+struct mfsoa_make_indices<0, I...>
+{
+	typedef mfsoa_indices<I...> type;
+};
+
+template<typename... Fields>
+struct mfsoa_trivial : std::true_type
+{};
+
+template<typename F, typename... Fields>
+struct mfsoa_trivial<F, Fields...> : std::integral_constant<bool, std::is_trivially_copyable<F>::value
+                                                                  && mfsoa_trivial<Fields...>::value>
+{};
+
+/** Alignment of every column, enough for AVX-512 loads and a cache line. */
+static const std::size_t mfsoavector_alignment = 64;
+
+template<typename... Fields> class mfsoavector;
+template<typename... Fields> std::ostream& operator<<(std::ostream&, const mfsoavector<Fields...>& v);
+
+/**
+ * Vector of records stored as structure of arrays: every field has its own
+ * contiguous column, so loops touching a few fields read only their columns
+ * and can be vectorised.
+ *
+ * Like mfvector, the capacity is fixed at construction and push_back on a
+ * full vector is a no-op. All columns live in one allocation, each starting
+ * at a mfsoavector_alignment boundary:
+ *
+ *          capacity_ * sizeof(F0)      capacity_ * sizeof(F1)
+ *         ---------------------------- ---------------------------- ---
+ * data_ -> | F0 F0 F0 ...      | pad  | F1 F1 F1 ...      | pad  | ...
+ *         ---------------------------- ---------------------------- ---
+ *
+ * Fields must be trivially copyable.
+ */
+
+template<typename... Fields>
+class mfsoavector
+{
+	friend std::ostream& operator<<<Fields...> (std::ostream& o, const mfsoavector<Fields...>& v);
+
+	typedef typename mfsoa_make_indices<sizeof...(Fields)>::type indices;
+
+public:
+	typedef std::tuple<Fields...> value_type;
+
+	template<std::size_t I>
+	struct field
+	{
+		typedef typename std::tuple_element<I, value_type>::type type;
+	};
+
+	static const std::size_t columns = sizeof...(Fields);
+
+	/** Proxy for one row; it stays valid as long as the vector is not destroyed. */
+	template<bool is_const_row>
+	struct row_ref
+	{
+		typedef typename std::conditional<is_const_row, const mfsoavector, mfsoavector>::type vector_type;
+
+		row_ref(vector_type* v, std::size_t ix) : v(v), ix(ix)
+		{}
+
+		template<std::size_t I>
+		typename std::conditional<is_const_row, const typename field<I>::type&, typename field<I>::type&>::type get() const
+		{
+			return v->template column_data<I>()[ix];
+		}
+
+		operator value_type() const
+		{
+			return v->row_value(ix, indices());
+		}
+
+		const row_ref& operator=(const value_type& x) const
+		{
+			v->assign_row(ix, x, indices());
+			return *this;
+		}
+
+		vector_type* v;
+		std::size_t ix;
+	};
+
+	typedef row_ref<false> reference;
+	typedef row_ref<true> const_reference;
+
+	explicit mfsoavector(std::size_t capacity = 0)
+	{
+		init(capacity);
+		start_watch();
+	}
+
+	mfsoavector(const mfsoavector& org)
+	{
+		init(org.capacity_);
+		size_ = org.size_;
+		for (std::size_t c = 0; c < columns; ++c)
+		{
+			std::copy(org.column_bytes(c), org.column_bytes(c) + size_ * field_size(c), column_bytes(c));
+		}
+		start_watch();
+	}
+
+	mfsoavector(mfsoavector&& org)
+	{
+		init();
+		org.stop_watch();
+		swap_unwatched(org);
+		start_watch();
+		org.start_watch();
+	}
+
+	mfsoavector& operator=(mfsoavector org)
+	{
+		swap(org);
+		return *this;
+	}
+
+	~mfsoavector()
+	{
+		stop_watch();
+		delete[] raw_;
+	}
+
+	std::size_t capacity() const
+	{
+		return capacity_;
+	}
+
+	std::size_t size() const
+	{
+		return size_;
+	}
+
+	/**
+	 * Bytes taken by the columns. Rounding each column up to
+	 * mfsoavector_alignment and aligning the block count as padding.
+	 */
+	mffootprint memory_footprint() const
+	{
+		mffootprint f;
+		std::size_t row = 0;
+		std::size_t bytes = 0;
+		for (std::size_t c = 0; c < columns; ++c)
+		{
+			row += field_size(c);
+			bytes += round_up(capacity_ * field_size(c));
+		}
+		f.elements = size_;
+		f.payload = size_ * row;
+		f.unused = (capacity_ - size_) * row;
+		f.padding = raw_ ? bytes + mfsoavector_alignment - 1 - capacity_ * row : 0;
+		f.header = sizeof(*this);
+		f.add_heap_block(raw_ ? bytes + mfsoavector_alignment - 1 : 0);
+		return f;
+	}
+
+	/** Column I as a contiguous, mfsoavector_alignment aligned range. */
+	template<std::size_t I>
+	mfspan<typename field<I>::type> column()
+	{
+		return mfspan<typename field<I>::type>(column_data<I>(), size_);
+	}
+
+	template<std::size_t I>
+	mfspan<const typename field<I>::type> column() const
+	{
+		return mfspan<const typename field<I>::type>(column_data<I>(), size_);
+	}
+
+	reference operator[](std::size_t n)
+	{
+		return reference(this, n);
+	}
+
+	const_reference operator[](std::size_t n) const
+	{
+		return const_reference(this, n);
+	}
+
+	void push_back(const Fields&... x)
+	{
+		if (size_ < capacity_)
+		{
+			stop_watch();
+			assign_row(size_++, std::forward_as_tuple(x...), indices());
+			start_watch();
+		}
+	}
+
+	void push_back(const value_type& x)
+	{
+		if (size_ < capacity_)
+		{
+			stop_watch();
+			assign_row(size_++, x, indices());
+			start_watch();
+		}
+	}
+
+	void pop_back()
+	{
+		stop_watch();
+		--size_;
+		start_watch();
+	}
+
+	/** Sets the size to n; new rows are value-initialized. */
+	void resize(std::size_t n)
+	{
+		n = std::min(n, capacity_);
+		stop_watch();
+		for (std::size_t c = 0; c < columns && n > size_; ++c)
+		{
+			std::fill(column_bytes(c) + size_ * field_size(c), column_bytes(c) + n * field_size(c), 0);
+		}
+		size_ = n;
+		start_watch();
+	}
+
+	/** Removes row n by moving the last row into its place. */
+	void unordered_erase(std::size_t n)
+	{
+		stop_watch();
+		--size_;
+		if (n != size_)
+		{
+			for (std::size_t c = 0; c < columns; ++c)
+			{
+				std::size_t s = field_size(c);
+				std::copy(column_bytes(c) + size_ * s, column_bytes(c) + (size_ + 1) * s, column_bytes(c) + n * s);
+			}
+		}
+		start_watch();
+	}
+
+	void clear()
+	{
+		stop_watch();
+		size_ = 0;
+		start_watch();
+	}
+
+	void swap(mfsoavector& v)
+	{
+		stop_watch();
+		v.stop_watch();
+		swap_unwatched(v);
+		start_watch();
+		v.start_watch();
+	}
+
+private:
+	char* raw_;
+	char* data_;
+	std::size_t offsets_[sizeof...(Fields)];
+	int watch_[sizeof...(Fields)];
+	std::size_t capacity_;
+	std::size_t size_;
+
+	static std::size_t field_size(std::size_t c)
+	{
+		static const std::size_t sizes[] = { sizeof(Fields)... };
+		return sizes[c];
+	}
+
+	static std::size_t round_up(std::size_t n)
+	{
+		return (n + mfsoavector_alignment - 1) & ~(mfsoavector_alignment - 1);
+	}
+
+	char* column_bytes(std::size_t c)
+	{
+		return data_ + offsets_[c];
+	}
+
+	const char* column_bytes(std::size_t c) const
+	{
+		return data_ + offsets_[c];
+	}
+
+	template<std::size_t I>
+	typename field<I>::type* column_data()
+	{
+		return (typename field<I>::type*) column_bytes(I);
+	}
+
+	template<std::size_t I>
+	const typename field<I>::type* column_data() const
+	{
+		return (const typename field<I>::type*) column_bytes(I);
+	}
+
+	template<typename Tuple, std::size_t... I>
+	void assign_row(std::size_t ix, const Tuple& x, mfsoa_indices<I...>)
+	{
+		int expand[] = { 0, (column_data<I>()[ix] = std::get<I>(x), 0)... };
+		(void) expand;
+	}
+
+	template<std::size_t... I>
+	value_type row_value(std::size_t ix, mfsoa_indices<I...>) const
+	{
+		return value_type(column_data<I>()[ix]...);
+	}
+
+	void swap_unwatched(mfsoavector& v)
+	{
+		std::swap(raw_, v.raw_);
+		std::swap(data_, v.data_);
+		std::swap(offsets_, v.offsets_);
+		std::swap(capacity_, v.capacity_);
+		std::swap(size_, v.size_);
+	}
+
+	void start_watch()
+	{
+		for (std::size_t c = 0; c < columns; ++c)
+		{
+			if (size_ < capacity_)
+			{
+				watch_[c] = purify_watch_n(column_bytes(c) + size_ * field_size(c), (capacity_ - size_) * field_size(c), (char *) "rw");
+			}
+			else
+			{
+				watch_[c] = -1;
+			}
+		}
+	}
+
+	void stop_watch()
+	{
+		for (std::size_t c = 0; c < columns; ++c)
+		{
+			if (watch_[c] != -1)
+			{
+				purify_watch_remove(watch_[c]);
+			}
+		}
+	}
+
+	void init(std::size_t capacity = 0)
+	{
+		static_assert(sizeof...(Fields) > 0, "mfsoavector needs at least one field");
+		static_assert(mfsoa_trivial<Fields...>::value, "mfsoavector fields must be trivially copyable");
+		capacity_ = capacity;
+		size_ = 0;
+		std::size_t bytes = 0;
+		for (std::size_t c = 0; c < columns; ++c)
+		{
+			offsets_[c] = bytes;
+			bytes += round_up(capacity * field_size(c));
+		}
+		if (bytes)
+		{
+			raw_ = new char[bytes + mfsoavector_alignment - 1];
+			data_ = (char*) round_up((std::uintptr_t) raw_);
+		}
+		else
+		{
+			raw_ = 0;
+			data_ = 0;
+		}
+	}
+};
+
+template<typename... Fields>
+void swap(mfsoavector<Fields...>& a, mfsoavector<Fields...>& b)
+{
+	a.swap(b);
+}
+
+template<typename... Fields>
+std::ostream& operator<<(std::ostream& o, const mfsoavector<Fields...>& v)
+{
+	o << "mfsoavector at " << std::hex << (void *) &v << std::dec << "(size " << v.size_
+	  << ", capacity " << v.capacity_ << ", columns " << v.columns << ", data " << std::hex
+	  << (void *) v.data_ << std::dec << ")";
+	return o;
+}
+
+
+#endif
@@ -0,0 +1,98 @@
+//
+// Copyright (c) 2014 Jakub Jabłoński
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#include <cstdlib>
+#include <string>
+
+#include "mfbench.h"
+#include "mfsoavector.h"
+#include "mfvector.h"
+
+struct particle
+{
+	float x, y, z;
+	float vx, vy, vz;
+	float mass, charge;
+};
+
+typedef mfsoavector<float, float, float, float, float, float, float, float> particles;
+
+/**
+ * Field scans over array-of-structs mfvector<particle> versus the same data
+ * in mfsoavector columns. Bytes are the useful bytes, i.e. those of the
+ * fields the loop touches.
+ */
+MFBENCH(soavector_field_scan)
+{
+	static const std::size_t sizes[] = { 4096, 1 << 21 };
+	for (std::size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s)
+	{
+		std::size_t n = sizes[s];
+		mfvector<particle> aos(n);
+		particles soa(n);
+		std::srand(1);
+		for (std::size_t i = 0; i < n; ++i)
+		{
+			particle p = { float(std::rand() % 100), 0, 0, float(std::rand() % 10), 0, 0, 1, 0 };
+			aos.push_back(p);
+			soa.push_back(p.x, p.y, p.z, p.vx, p.vy, p.vz, p.mass, p.charge);
+		}
+		std::string suffix = "/" + std::to_string(n);
+
+		b.run("aos_sum_x" + suffix, n, n * sizeof(float), [&] {
+			float sum = 0;
+			for (const particle* p = aos.begin(); p != aos.end(); ++p)
+			{
+				sum += p->x;
+			}
+			mfbench_keep(sum);
+		});
+		b.run("soa_sum_x" + suffix, n, n * sizeof(float), [&] {
+			mfspan<const float> x = static_cast<const particles&>(soa).column<0>();
+			float sum = 0;
+			for (const float* p = x.begin(); p != x.end(); ++p)
+			{
+				sum += *p;
+			}
+			mfbench_keep(sum);
+		});
+
+		b.run("aos_integrate_x" + suffix, n, 3 * n * sizeof(float), [&] {
+			for (particle* p = aos.begin(); p != aos.end(); ++p)
+			{
+				p->x += p->vx * 0.01f;
+			}
+			mfbench_keep(aos);
+		});
+		b.run("soa_integrate_x" + suffix, n, 3 * n * sizeof(float), [&] {
+			mfspan<float> x = soa.column<0>();
+			mfspan<float> vx = soa.column<3>();
+			float* __restrict px = x.begin();
+			const float* __restrict pvx = vx.begin();
+			for (std::size_t i = 0; i < n; ++i)
+			{
+				px[i] += pvx[i] * 0.01f;
+			}
+			mfbench_keep(soa);
+		});
+	}
+}
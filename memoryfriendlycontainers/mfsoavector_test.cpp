@@ -0,0 +1,137 @@
+//
+// Copyright (c) 2014 Jakub Jabłoński
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <cstdint>
+#include <iostream>
+#include <tuple>
+
+#include "mfsoavector.h"
+#include "gtest/gtest.h"
+
+class SoaVectorTest : public ::testing::Test
+{
+protected:
+    SoaVectorTest() : v1(1), v10(10)
+    {}
+    
+    mfsoavector<int, double, char> v0;
+    mfsoavector<int, double, char> v1;
+    mfsoavector<int, double, char> v10;
+};
+
+TEST_F(SoaVectorTest, Initial)
+{
+    EXPECT_EQ(0, v0.size());
+    EXPECT_EQ(0, v0.capacity());
+    EXPECT_EQ(0, v1.size());
+    EXPECT_EQ(1, v1.capacity());
+    EXPECT_EQ(0, v10.size());
+    EXPECT_EQ(10, v10.capacity());
+}
+
+TEST_F(SoaVectorTest, PushBack)
+{
+	v0.push_back(1, 1.5, 'a');
+    EXPECT_EQ(0, v0.size());
+
+	v1.push_back(1, 1.5, 'a');
+	v1.push_back(2, 2.5, 'b');
+    ASSERT_EQ(1, v1.size());
+    EXPECT_EQ(1, v1[0].get<0>());
+    EXPECT_EQ(1.5, v1[0].get<1>());
+    EXPECT_EQ('a', v1[0].get<2>());
+
+	v10.push_back(std::make_tuple(3, 3.5, 'c'));
+    ASSERT_EQ(1, v10.size());
+    std::tuple<int, double, char> row = v10[0];
+    EXPECT_TRUE(std::make_tuple(3, 3.5, 'c') == row);
+}
+
+TEST_F(SoaVectorTest, Columns)
+{
+	for (int i = 0; i < 10; ++i)
+	{
+		v10.push_back(i, i * 0.5, char('a' + i));
+	}
+    mfspan<int> ints = v10.column<0>();
+    mfspan<double> doubles = v10.column<1>();
+    ASSERT_EQ(10, ints.size());
+    EXPECT_EQ(0, std::uintptr_t(ints.begin()) % mfsoavector_alignment);
+    EXPECT_EQ(0, std::uintptr_t(doubles.begin()) % mfsoavector_alignment);
+    EXPECT_EQ(0, std::uintptr_t(v10.column<2>().begin()) % mfsoavector_alignment);
+
+	int sum = 0;
+	for (int* i = ints.begin(); i != ints.end(); ++i)
+	{
+		sum += *i;
+	}
+    EXPECT_EQ(45, sum);
+
+	doubles[3] = 7.0;
+    EXPECT_EQ(7.0, v10[3].get<1>());
+
+	v10[4] = std::make_tuple(-1, -1.0, 'z');
+    EXPECT_EQ(-1, ints[4]);
+    EXPECT_EQ('z', v10[4].get<2>());
+}
+
+TEST_F(SoaVectorTest, EraseResize)
+{
+	for (int i = 0; i < 4; ++i)
+	{
+		v10.push_back(i, i * 0.5, char('a' + i));
+	}
+	v10.unordered_erase(1);
+    ASSERT_EQ(3, v10.size());
+    EXPECT_EQ(3, v10[1].get<0>());
+    EXPECT_EQ('d', v10[1].get<2>());
+
+	v10.pop_back();
+	v10.resize(5);
+    ASSERT_EQ(5, v10.size());
+    EXPECT_EQ(0, v10[4].get<0>());
+    EXPECT_EQ(0.0, v10[2].get<1>());
+
+	v10.resize(20);
+    EXPECT_EQ(10, v10.size());
+
+	v10.clear();
+    EXPECT_EQ(0, v10.size());
+}
+
+TEST_F(SoaVectorTest, CopySwap)
+{
+	v10.push_back(1, 1.5, 'a');
+	v10.push_back(2, 2.5, 'b');
+
+	mfsoavector<int, double, char> c(v10);
+    ASSERT_EQ(2, c.size());
+    EXPECT_EQ(2.5, c[1].get<1>());
+
+	swap(c, v1);
+    EXPECT_EQ(0, c.size());
+    EXPECT_EQ(1, c.capacity());
+    EXPECT_EQ(2, v1.size());
+
+	mfsoavector<int, double, char> m(std::move(v1));
+    EXPECT_EQ(2, m.size());
+    EXPECT_EQ('b', m[1].get<2>());
+}
@@ -0,0 +1,252 @@
+//
+// Copyright (c) 2014 Jakub Jabłoński
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#ifndef memoryfriendlycontainers_mfsort_h
+#define memoryfriendlycontainers_mfsort_h
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <type_traits>
+#include <utility>
+
+#include "mfparallel.h"
+#include "mfvector.h"
+
+/**
+ * LSD radix sort of an mfvector by an unsigned integer key, one byte per
+ * pass, into a scratch mfvector supplied by the caller.
+ *
+ * mfsort_key<T> extracts the key: integers sort by value and std::pair by
+ * its first member, so pair<uint32_t, payload> records need four passes.
+ * Specialize it for other record types. The sort is stable.
+ *
+ * Passes in which every element has the same digit (e.g. the high bytes of
+ * small keys) are skipped. Large inputs are split into chunks whose
+ * histograms and scatters run on an mfthreadpool.
+ */
+
+template<typename T, typename Enable = void>
+struct mfsort_key;
+
+template<typename T>
+struct mfsort_key<T, typename std::enable_if<std::is_integral<T>::value>::type>
+{
+	typedef typename std::make_unsigned<T>::type type;
+
+	/** Flips the sign bit of signed values so that they sort below positive ones. */
+	static type get(T x)
+	{
+		return type(x) ^ (std::is_signed<T>::value ? type(type(1) << (std::numeric_limits<type>::digits - 1)) : type(0));
+	}
+};
+
+template<typename K, typename P>
+struct mfsort_key<std::pair<K, P> >
+{
+	typedef typename mfsort_key<K>::type type;
+
+	static type get(const std::pair<K, P>& x)
+	{
+		return mfsort_key<K>::get(x.first);
+	}
+};
+
+static const unsigned mfsort_digit_bits = 8;
+static const std::size_t mfsort_radix = std::size_t(1) << mfsort_digit_bits;
+
+/** Below this many elements an insertion sort is faster than any pass. */
+static const std::size_t mfsort_small = 64;
+
+/** Smallest input split over threads, and the most chunks it is split into. */
+static const std::size_t mfsort_parallel_min = std::size_t(1) << 16;
+static const std::size_t mfsort_max_chunks = 16;
+
+template<typename T>
+inline std::size_t mfsort_digit(const T& x, unsigned shift)
+{
+	return std::size_t(mfsort_key<T>::get(x) >> shift) & (mfsort_radix - 1);
+}
+
+/** Stable insertion sort by key. */
+template<typename T>
+void mfsort_insertion(T* first, T* last)
+{
+	for (T* i = first + (first != last); i < last; ++i)
+	{
+		T x = std::move(*i);
+		T* j = i;
+		for (; j != first && mfsort_key<T>::get(x) < mfsort_key<T>::get(j[-1]); --j)
+		{
+			*j = std::move(j[-1]);
+		}
+		*j = std::move(x);
+	}
+}
+
+/** Turns counts into starting offsets; false when all n elements share one digit. */
+inline bool mfsort_offsets(std::size_t* count, std::size_t n)
+{
+	std::size_t sum = 0;
+	for (std::size_t d = 0; d < mfsort_radix; ++d)
+	{
+		if (count[d] == n)
+		{
+			return false;
+		}
+		std::size_t c = count[d];
+		count[d] = sum;
+		sum += c;
+	}
+	return true;
+}
+
+template<typename T>
+void mfsort_scatter(const T* first, const T* last, T* out, std::size_t* offset, unsigned shift)
+{
+	for (const T* p = first; p != last; ++p)
+	{
+		out[offset[mfsort_digit(*p, shift)]++] = *p;
+	}
+}
+
+/**
+ * One thread: the histograms of all passes come from a single read of the
+ * input. Returns the buffer holding the result.
+ */
+template<typename T>
+T* mfsort_serial(T* src, T* dst, std::size_t n)
+{
+	static const unsigned passes = sizeof(typename mfsort_key<T>::type) * 8 / mfsort_digit_bits;
+	std::size_t count[passes][mfsort_radix] = {};
+	for (const T* p = src; p != src + n; ++p)
+	{
+		typename mfsort_key<T>::type k = mfsort_key<T>::get(*p);
+		for (unsigned pass = 0; pass < passes; ++pass)
+		{
+			++count[pass][std::size_t(k >> (pass * mfsort_digit_bits)) & (mfsort_radix - 1)];
+		}
+	}
+	for (unsigned pass = 0; pass < passes; ++pass)
+	{
+		if (mfsort_offsets(count[pass], n))
+		{
+			mfsort_scatter(src, src + n, dst, count[pass], pass * mfsort_digit_bits);
+			std::swap(src, dst);
+		}
+	}
+	return src;
+}
+
+/**
+ * Several threads: every pass counts digits per chunk, then each chunk
+ * scatters to its own offsets within each digit's range, which keeps the
+ * sort stable. Returns the buffer holding the result.
+ */
+template<typename T>
+T* mfsort_parallel(mfthreadpool& pool, T* src, T* dst, std::size_t n)
+{
+	static const unsigned passes = sizeof(typename mfsort_key<T>::type) * 8 / mfsort_digit_bits;
+	std::size_t chunks = std::min(mfparallel_chunks(pool, n, mfparallel_grain), mfsort_max_chunks);
+	std::size_t count[mfsort_max_chunks][mfsort_radix];
+	for (unsigned pass = 0; pass < passes; ++pass)
+	{
+		unsigned shift = pass * mfsort_digit_bits;
+		pool.run(chunks, [&](std::size_t c) {
+			std::fill(count[c], count[c] + mfsort_radix, std::size_t(0));
+			for (const T* p = src + n * c / chunks; p != src + n * (c + 1) / chunks; ++p)
+			{
+				++count[c][mfsort_digit(*p, shift)];
+			}
+		});
+		std::size_t sum = 0;
+		bool constant = false;
+		for (std::size_t d = 0; d < mfsort_radix && !constant; ++d)
+		{
+			std::size_t total = sum;
+			for (std::size_t c = 0; c < chunks; ++c)
+			{
+				std::size_t k = count[c][d];
+				count[c][d] = sum;
+				sum += k;
+			}
+			constant = sum - total == n;
+		}
+		if (constant)
+		{
+			continue;
+		}
+		pool.run(chunks, [&](std::size_t c) {
+			mfsort_scatter(src + n * c / chunks, src + n * (c + 1) / chunks, dst, count[c], shift);
+		});
+		std::swap(src, dst);
+	}
+	return src;
+}
+
+/**
+ * Sorts v by mfsort_key<T>, using scratch as the second buffer. scratch is
+ * resized to v.size(), which allocates only if it is too small, and v and
+ * scratch may trade buffers (unless one of them is mapped to a file), so
+ * keep the scratch vector around for the next call. Returns false, leaving
+ * v untouched, if scratch cannot be made large enough.
+ */
+template<typename T, typename G>
+bool mfradix_sort(mfthreadpool& pool, mfvector<T, G>& v, mfvector<T, G>& scratch)
+{
+	std::size_t n = v.size();
+	if (n < mfsort_small)
+	{
+		mfsort_insertion(v.begin(), v.end());
+		return true;
+	}
+	if (scratch.size() != n)
+	{
+		scratch.resize(n);
+		if (scratch.size() < n)
+		{
+			return false;
+		}
+	}
+	T* out = n >= mfsort_parallel_min && pool.size() > 1 ? mfsort_parallel(pool, v.begin(), scratch.begin(), n)
+	                                                     : mfsort_serial(v.begin(), scratch.begin(), n);
+	if (out != v.begin())
+	{
+		if (v.mapped() || scratch.mapped())
+		{
+			std::copy(out, out + n, v.begin());
+		}
+		else
+		{
+			v.swap(scratch);
+		}
+	}
+	return true;
+}
+
+template<typename T, typename G>
+bool mfradix_sort(mfvector<T, G>& v, mfvector<T, G>& scratch)
+{
+	return mfradix_sort(mfthreadpool_default(), v, scratch);
+}
+
+#endif
@@ -0,0 +1,99 @@
+//
+// Copyright (c) 2014 Jakub Jabłoński
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+
+#include "mfbench.h"
+#include "mfsort.h"
+
+typedef std::pair<std::uint32_t, std::uint32_t> sort_record;
+
+template<typename T>
+T sort_input(std::uint64_t x, std::uint64_t mask);
+
+template<>
+std::uint64_t sort_input<std::uint64_t>(std::uint64_t x, std::uint64_t mask)
+{
+	return x & mask;
+}
+
+template<>
+sort_record sort_input<sort_record>(std::uint64_t x, std::uint64_t mask)
+{
+	return sort_record(std::uint32_t(x & mask), std::uint32_t(x >> 32));
+}
+
+/**
+ * Sorting n random values with std::sort and with mfradix_sort on one
+ * thread and on the default pool, if it has more. Each iteration restores the unsorted
+ * input first, which both sides pay for.
+ */
+template<typename T>
+static void sort_suite(mfbench& b, const char* name, std::uint64_t mask)
+{
+	static const std::size_t sizes[] = { 1 << 10, 1 << 16, 1 << 20, 1 << 23 };
+	mfthreadpool serial(1);
+	for (std::size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s)
+	{
+		std::size_t n = sizes[s];
+		mfvector<T> input(n), v(n), scratch(n);
+		for (std::size_t i = 0; i < n; ++i)
+		{
+			input.push_back(sort_input<T>(mfhash_mix(i), mask));
+		}
+		std::string suffix = std::string("/") + name + "/" + std::to_string(n);
+
+		b.run("std_sort" + suffix, n, n * sizeof(T), [&] {
+			v.clear();
+			v.append(input.begin(), input.end());
+			std::sort(v.begin(), v.end(), [](const T& x, const T& y) { return mfsort_key<T>::get(x) < mfsort_key<T>::get(y); });
+			mfbench_keep(v[0]);
+		});
+		b.run("radix/threads:1" + suffix, n, n * sizeof(T), [&] {
+			v.clear();
+			v.append(input.begin(), input.end());
+			mfradix_sort(serial, v, scratch);
+			mfbench_keep(v[0]);
+		});
+		if (mfthreadpool_default().size() > 1)
+		{
+			b.run("radix/threads:" + std::to_string(mfthreadpool_default().size()) + suffix, n, n * sizeof(T), [&] {
+				v.clear();
+				v.append(input.begin(), input.end());
+				mfradix_sort(v, scratch);
+				mfbench_keep(v[0]);
+			});
+		}
+	}
+}
+
+MFBENCH(sort)
+{
+	sort_suite<std::uint64_t>(b, "u64", ~0ULL);
+	sort_suite<std::uint64_t>(b, "u64_40bit", (1ULL << 40) - 1);
+	sort_suite<sort_record>(b, "pair_u32", ~0ULL);
+}
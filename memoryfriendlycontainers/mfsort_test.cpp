@@ -0,0 +1,137 @@
+//
+// Copyright (c) 2014 Jakub Jabłoński
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "mfsort.h"
+#include "gtest/gtest.h"
+
+namespace
+{
+    /** Deterministic pseudo-random keys, masked to the given bits. */
+    std::uint64_t random_key(std::uint64_t& state, std::uint64_t mask)
+    {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        return mfhash_mix(state) & mask;
+    }
+
+    template<typename T>
+    std::vector<T> to_std(const mfvector<T>& v)
+    {
+        return std::vector<T>(v.begin(), v.end());
+    }
+}
+
+TEST(SortTest, SmallAndEmpty)
+{
+    mfthreadpool pool(1);
+    mfvector<std::uint64_t> v(10), scratch;
+    EXPECT_TRUE(mfradix_sort(pool, v, scratch));
+    std::uint64_t keys[] = { 5, 3, 9, 3, 0, 1 };
+    v.append(keys, keys + 6);
+    EXPECT_TRUE(mfradix_sort(pool, v, scratch));
+    std::sort(keys, keys + 6);
+    EXPECT_EQ(std::vector<std::uint64_t>(keys, keys + 6), to_std(v));
+}
+
+TEST(SortTest, MatchesStdSort)
+{
+    static const std::uint64_t masks[] = { ~0ULL, 0xffffULL, 0xff00ff0000ULL, 0 };
+    static const unsigned threads[] = { 1, 4 };
+    for (std::size_t t = 0; t < 2; ++t)
+    {
+        mfthreadpool pool(threads[t]);
+        for (std::size_t m = 0; m < sizeof(masks) / sizeof(masks[0]); ++m)
+        {
+            for (std::size_t n = 100; n <= 100000; n *= 30)
+            {
+                std::uint64_t state = n + m;
+                mfvector<std::uint64_t> v(n), scratch;
+                for (std::size_t i = 0; i < n; ++i)
+                {
+                    v.push_back(random_key(state, masks[m]));
+                }
+                std::vector<std::uint64_t> expected = to_std(v);
+                std::sort(expected.begin(), expected.end());
+                ASSERT_TRUE(mfradix_sort(pool, v, scratch));
+                EXPECT_EQ(n, v.size());
+                EXPECT_TRUE(expected == to_std(v)) << "threads " << threads[t] << " mask " << m << " n " << n;
+            }
+        }
+    }
+}
+
+TEST(SortTest, SignedKeys)
+{
+    mfvector<int> v(1000), scratch;
+    for (int i = 0; i < 1000; ++i)
+    {
+        v.push_back((i * 7919) % 1000 - 500);
+    }
+    ASSERT_TRUE(mfradix_sort(v, scratch));
+    for (int i = 0; i < 1000; ++i)
+    {
+        EXPECT_EQ(i - 500, v[i]);
+    }
+}
+
+TEST(SortTest, PairsAreStable)
+{
+    typedef std::pair<std::uint32_t, std::uint32_t> record;
+    static const unsigned threads[] = { 1, 4 };
+    for (std::size_t t = 0; t < 2; ++t)
+    {
+        mfthreadpool pool(threads[t]);
+        static const std::size_t n = 100000;
+        std::uint64_t state = 7;
+        mfvector<record> v(n), scratch;
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            v.push_back(record(std::uint32_t(random_key(state, 0xfff)) << 8, std::uint32_t(i)));
+        }
+        std::vector<record> expected = to_std(v);
+        std::stable_sort(expected.begin(), expected.end(), [](const record& a, const record& b) { return a.first < b.first; });
+        ASSERT_TRUE(mfradix_sort(pool, v, scratch));
+        EXPECT_TRUE(expected == to_std(v)) << "threads " << threads[t];
+    }
+}
+
+TEST(SortTest, ScratchIsReused)
+{
+    mfthreadpool pool(1);
+    mfvector<std::uint32_t> v(1000), scratch(1000);
+    for (std::uint32_t i = 0; i < 1000; ++i)
+    {
+        v.push_back(1000 - i);
+    }
+    ASSERT_TRUE(mfradix_sort(pool, v, scratch));
+    EXPECT_EQ(1000, v.size());
+    EXPECT_EQ(1000, scratch.size());
+    EXPECT_EQ(1000, scratch.capacity());
+    EXPECT_EQ(1u, v[0]);
+    EXPECT_EQ(1000u, v[999]);
+}
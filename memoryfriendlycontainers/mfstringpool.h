@@ -0,0 +1,379 @@
+//
+// Copyright (c) 2014 Jakub Jabłoński
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#ifndef memoryfriendlycontainers_mfstringpool_h
+#define memoryfriendlycontainers_mfstringpool_h
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string>
+
+#include <ostream>
+
+#include "mffootprint.h"
+#include "mfhash.h"
+#include "mfhashmapsc.h"
+#include "mfvector.h"
+
+/**
+ * Interned string: an index into an mfstringpool. Two handles from the same
+ * pool are equal exactly when their strings are, so comparing and hashing
+ * them never looks at the characters.
+ */
+struct mfstring_handle
+{
+	std::uint32_t id;
+
+	bool operator==(mfstring_handle rhs) const
+	{
+		return id == rhs.id;
+	}
+
+	bool operator!=(mfstring_handle rhs) const
+	{
+		return id != rhs.id;
+	}
+
+	bool operator<(mfstring_handle rhs) const
+	{
+		return id < rhs.id;
+	}
+};
+
+/** Handle of no string; find() returns it for strings not in the pool. */
+static const mfstring_handle mfstring_npos = { 0xffffffffu };
+
+inline std::ostream& operator<<(std::ostream& o, mfstring_handle h)
+{
+	return o << "string#" << h.id;
+}
+
+namespace std
+{
+	template<>
+	struct hash<mfstring_handle>
+	{
+		std::size_t operator()(mfstring_handle h) const
+		{
+			return h.id;
+		}
+	};
+}
+
+/** Handles are dense, so the id only needs mixing with the seed. */
+template<>
+struct mfhash<mfstring_handle>
+{
+	std::size_t mask;
+	std::size_t seed;
+
+	std::size_t operator()(mfstring_handle key) const
+	{
+		return std::size_t(mfhash_mix(std::uint64_t(key.id) + seed)) & mask;
+	}
+};
+
+/**
+ * Arena of interned strings. The characters of all strings are kept back
+ * to back, each followed by a 0, in one growing buffer; a table holds the
+ * offset, length and hash of every string, and a handle is the index into
+ * it. Interning the same characters again returns the same handle.
+ *
+ * Strings are never removed. c_str() pointers are invalidated when the
+ * buffer grows, handles stay valid for the life of the pool.
+ *
+ *  chars_   | n a m e 0 | i d 0 | s i z e 0 |
+ *             ^           ^       ^
+ *  strings_ | 0, 4, h0  | 5, 2, h1 | 8, 4, h2 |
+ *
+ *  slots_   | - | 2 | - | 0 | 1 | - | - | - |   (handle + 1, 0 is empty)
+ */
+class mfstringpool
+{
+public:
+	explicit mfstringpool(std::size_t chars = 0, std::size_t strings = 0)
+		: chars_(chars), strings_(strings), seed_(std::uint32_t(mfhash_random_seed()))
+	{
+		std::size_t n = 16;
+		while (n < 2 * strings)
+		{
+			n <<= 1;
+		}
+		slots_.resize(n, 0);
+	}
+
+	/** Number of distinct strings. */
+	std::size_t size() const
+	{
+		return strings_.size();
+	}
+
+	/**
+	 * Handle of the n characters at s, adding them if they are new. Returns
+	 * mfstring_npos if the pool has reached 4 GB or 2^32 - 1 strings.
+	 */
+	mfstring_handle intern(const char* s, std::size_t n)
+	{
+		std::uint32_t h = hash_of(s, n);
+		std::size_t slot = find_slot(s, n, h);
+		if (slots_[slot])
+		{
+			mfstring_handle r = { slots_[slot] - 1 };
+			return r;
+		}
+		if (chars_.size() + n + 1 > 0xffffffffu || strings_.size() >= mfstring_npos.id)
+		{
+			return mfstring_npos;
+		}
+
+		string_t e = { std::uint32_t(chars_.size()), std::uint32_t(n), h };
+		chars_.append(s, s + n);
+		chars_.push_back('\0');
+		strings_.push_back(e);
+		mfstring_handle r = { std::uint32_t(strings_.size() - 1) };
+		slots_[slot] = r.id + 1;
+		if (2 * strings_.size() > slots_.size())
+		{
+			grow_slots();
+		}
+		return r;
+	}
+
+	mfstring_handle intern(const char* s)
+	{
+		return intern(s, std::strlen(s));
+	}
+
+	mfstring_handle intern(const std::string& s)
+	{
+		return intern(s.data(), s.size());
+	}
+
+	/** Handle of the n characters at s, or mfstring_npos if they were never interned. */
+	mfstring_handle find(const char* s, std::size_t n) const
+	{
+		std::size_t slot = find_slot(s, n, hash_of(s, n));
+		mfstring_handle r = { slots_[slot] ? slots_[slot] - 1 : mfstring_npos.id };
+		return r;
+	}
+
+	mfstring_handle find(const char* s) const
+	{
+		return find(s, std::strlen(s));
+	}
+
+	mfstring_handle find(const std::string& s) const
+	{
+		return find(s.data(), s.size());
+	}
+
+	/** The 0 terminated characters of h; valid until the next intern(). */
+	const char* c_str(mfstring_handle h) const
+	{
+		return &chars_[strings_[h.id].offset];
+	}
+
+	std::size_t length(mfstring_handle h) const
+	{
+		return strings_[h.id].length;
+	}
+
+	std::string str(mfstring_handle h) const
+	{
+		return std::string(c_str(h), length(h));
+	}
+
+	/** Hash of the characters of h, computed when it was interned. */
+	std::uint32_t hash(mfstring_handle h) const
+	{
+		return strings_[h.id].hash;
+	}
+
+	/**
+	 * Characters, 0 terminators included, are payload; the string table and
+	 * used slots are links, free slots count as empty buckets.
+	 */
+	mffootprint memory_footprint() const
+	{
+		mffootprint f = chars_.memory_footprint();
+		f += strings_.memory_footprint();
+		f += slots_.memory_footprint();
+		f.elements = strings_.size();
+		f.payload = chars_.size();
+		f.links = strings_.size() * (sizeof(string_t) + sizeof(std::uint32_t));
+		f.empty_buckets = (slots_.size() - strings_.size()) * sizeof(std::uint32_t);
+		f.unused = chars_.capacity() - chars_.size() + (strings_.capacity() - strings_.size()) * sizeof(string_t)
+		           + (slots_.capacity() - slots_.size()) * sizeof(std::uint32_t);
+		f.header = sizeof(*this);
+		return f;
+	}
+
+	void swap(mfstringpool& p)
+	{
+		chars_.swap(p.chars_);
+		strings_.swap(p.strings_);
+		slots_.swap(p.slots_);
+		std::swap(seed_, p.seed_);
+	}
+
+private:
+	struct string_t
+	{
+		std::uint32_t offset;
+		std::uint32_t length;
+		std::uint32_t hash;
+	};
+
+	mfstringpool(const mfstringpool&);
+	mfstringpool& operator=(const mfstringpool&);
+
+	mfvector<char, mfgrowth_geometric> chars_;
+	mfvector<string_t, mfgrowth_geometric> strings_;
+	mfvector<std::uint32_t, mfgrowth_geometric> slots_;
+	std::uint32_t seed_;
+
+	/** mfhash_bytes from the pool's seed, cut to the 32 bits kept per string. */
+	std::uint32_t hash_of(const char* s, std::size_t n) const
+	{
+		return std::uint32_t(mfhash_bytes(s, n, seed_));
+	}
+
+	/** Slot holding s, or the empty slot where it would go; linear probing. */
+	std::size_t find_slot(const char* s, std::size_t n, std::uint32_t h) const
+	{
+		std::size_t mask = slots_.size() - 1;
+		for (std::size_t slot = h & mask;; slot = (slot + 1) & mask)
+		{
+			std::uint32_t v = slots_[slot];
+			if (!v)
+			{
+				return slot;
+			}
+			const string_t& e = strings_[v - 1];
+			if (e.hash == h && e.length == n && !std::memcmp(&chars_[e.offset], s, n))
+			{
+				return slot;
+			}
+		}
+	}
+
+	/** Doubles the slots, placing the strings again by their stored hashes. */
+	void grow_slots()
+	{
+		mfvector<std::uint32_t, mfgrowth_geometric> slots(2 * slots_.size());
+		slots.resize(2 * slots_.size(), 0);
+		std::size_t mask = slots.size() - 1;
+		for (std::size_t i = 0; i < strings_.size(); ++i)
+		{
+			std::size_t slot = strings_[i].hash & mask;
+			while (slots[slot])
+			{
+				slot = (slot + 1) & mask;
+			}
+			slots[slot] = std::uint32_t(i + 1);
+		}
+		slots_.swap(slots);
+	}
+};
+
+inline void swap(mfstringpool& a, mfstringpool& b)
+{
+	a.swap(b);
+}
+
+/**
+ * mfhashmapsc keyed by strings interned in a pool: lookups turn the string
+ * into a handle once, then the map compares and hashes 32-bit integers.
+ * Keys are interned on insert; a string that was never interned becomes
+ * mfstring_npos, which is never a key, so looking it up returns none().
+ */
+template<typename V>
+class mfstringmap
+{
+public:
+	typedef mfhashmapsc<mfstring_handle, V> map_type;
+
+	mfstringmap(mfstringpool& pool, std::size_t capacity = 0) : pool_(&pool), map_(capacity)
+	{}
+
+	std::size_t size() const
+	{
+		return map_.size();
+	}
+
+	std::size_t capacity() const
+	{
+		return map_.capacity();
+	}
+
+	void insert(mfstring_handle key, const V& value)
+	{
+		map_.insert(key, value);
+	}
+
+	void insert(const std::string& key, const V& value)
+	{
+		mfstring_handle h = pool_->intern(key);
+		if (h != mfstring_npos)
+		{
+			map_.insert(h, value);
+		}
+	}
+
+	V& operator[](mfstring_handle key)
+	{
+		return map_[key];
+	}
+
+	V& operator[](const std::string& key)
+	{
+		return map_[pool_->find(key)];
+	}
+
+	V& operator[](const char* key)
+	{
+		return map_[pool_->find(key)];
+	}
+
+	V const& none() const
+	{
+		return map_.none();
+	}
+
+	mfstringpool& pool()
+	{
+		return *pool_;
+	}
+
+	map_type& map()
+	{
+		return map_;
+	}
+
+private:
+	mfstringpool* pool_;
+	map_type map_;
+};
+
+#endif
@@ -0,0 +1,117 @@
+//
+// Copyright (c) 2014 Jakub Jabłoński
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "mfbench.h"
+#include "mfhashmapsc.h"
+#include "mfstringpool.h"
+
+/** Names like object::name, long enough to live on the heap in a std::string. */
+static std::string make_name(std::size_t i)
+{
+	char s[48];
+	std::snprintf(s, sizeof(s), "object.name.%08zu", i);
+	return s;
+}
+
+/**
+ * Lookups in maps from names: mfhashmapsc keyed by std::string against
+ * mfstringmap keyed by interned handles, both when the caller already has
+ * the handle and when each lookup starts from the string. Counters give the
+ * bytes per entry of the map and, for the pool, of the shared characters.
+ */
+MFBENCH(stringpool)
+{
+	static const std::size_t sizes[] = { 1 << 10, 1 << 16, 1 << 20 };
+	static const std::size_t queries = 1 << 16;
+	for (std::size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s)
+	{
+		std::size_t n = sizes[s];
+		std::vector<std::string> names;
+		for (std::size_t i = 0; i < n; ++i)
+		{
+			names.push_back(make_name(i));
+		}
+		std::vector<std::size_t> lookups;
+		std::srand(1);
+		for (std::size_t q = 0; q < queries; ++q)
+		{
+			lookups.push_back((std::size_t(std::rand()) << 15 ^ std::rand()) % n);
+		}
+		std::string suffix = "/" + std::to_string(n);
+
+		mfhashmapsc<std::string, int> strings(n);
+		for (std::size_t i = 0; i < n; ++i)
+		{
+			strings.insert(names[i], int(i));
+		}
+		mfstringpool pool(n * (names[0].size() + 1), n);
+		mfstringmap<int> handles(pool, n);
+		std::vector<mfstring_handle> keys;
+		for (std::size_t i = 0; i < n; ++i)
+		{
+			keys.push_back(pool.intern(names[i]));
+			handles.insert(keys.back(), int(i));
+		}
+		// The std::string keys' heap blocks are not in the map's footprint.
+		double string_heap = names[0].capacity() + 1 + mffootprint_heap_overhead(names[0].capacity() + 1);
+
+		b.run("std_string/find" + suffix, queries, 0, [&] {
+			std::size_t sum = 0;
+			for (std::size_t q = 0; q < queries; ++q)
+			{
+				sum += strings[names[lookups[q]]];
+			}
+			mfbench_keep(sum);
+		}).counter("bytes_per_entry", strings.memory_footprint().bytes_per_element() + string_heap);
+		b.run("handle/find" + suffix, queries, 0, [&] {
+			std::size_t sum = 0;
+			for (std::size_t q = 0; q < queries; ++q)
+			{
+				sum += handles[keys[lookups[q]]];
+			}
+			mfbench_keep(sum);
+		}).counter("bytes_per_entry", handles.map().memory_footprint().bytes_per_element())
+		  .counter("pool_bytes_per_string", pool.memory_footprint().bytes_per_element());
+		b.run("handle/find_by_string" + suffix, queries, 0, [&] {
+			std::size_t sum = 0;
+			for (std::size_t q = 0; q < queries; ++q)
+			{
+				sum += handles[names[lookups[q]]];
+			}
+			mfbench_keep(sum);
+		});
+		b.run("intern_existing" + suffix, queries, 0, [&] {
+			std::size_t sum = 0;
+			for (std::size_t q = 0; q < queries; ++q)
+			{
+				sum += pool.intern(names[lookups[q]]).id;
+			}
+			mfbench_keep(sum);
+		});
+	}
+}
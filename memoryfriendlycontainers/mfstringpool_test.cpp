@@ -0,0 +1,124 @@
+//
+// Copyright (c) 2014 Jakub Jabłoński
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+
+
+#include <set>
+#include <string>
+#include <vector>
+
+#include "mfstringpool.h"
+#include "gtest/gtest.h"
+
+TEST(StringpoolTest, Intern)
+{
+    mfstringpool p;
+    mfstring_handle a = p.intern("alpha");
+    mfstring_handle b = p.intern(std::string("beta"));
+    mfstring_handle a2 = p.intern("alphabet", 5);
+    EXPECT_EQ(a, a2);
+    EXPECT_NE(a, b);
+    EXPECT_EQ(2, p.size());
+    EXPECT_STREQ("alpha", p.c_str(a));
+    EXPECT_EQ(4, p.length(b));
+    EXPECT_EQ("beta", p.str(b));
+    EXPECT_EQ(p.hash(a), p.hash(a2));
+}
+
+TEST(StringpoolTest, Find)
+{
+    mfstringpool p;
+    mfstring_handle a = p.intern("alpha");
+    EXPECT_EQ(a, p.find("alpha"));
+    EXPECT_EQ(mfstring_npos, p.find("alp"));
+    EXPECT_EQ(mfstring_npos, p.find(""));
+    mfstring_handle e = p.intern("");
+    EXPECT_EQ(e, p.find(std::string()));
+    EXPECT_EQ(0, p.length(e));
+    EXPECT_STREQ("", p.c_str(e));
+}
+
+TEST(StringpoolTest, EmbeddedZero)
+{
+    mfstringpool p;
+    mfstring_handle a = p.intern("a\0b", 3);
+    mfstring_handle b = p.intern("a\0c", 3);
+    EXPECT_NE(a, b);
+    EXPECT_EQ(3, p.length(a));
+    EXPECT_EQ(std::string("a\0b", 3), p.str(a));
+}
+
+TEST(StringpoolTest, Grow)
+{
+    mfstringpool p;
+    std::vector<mfstring_handle> handles;
+    for (int i = 0; i < 10000; ++i)
+    {
+        handles.push_back(p.intern("name" + std::to_string(i)));
+    }
+    EXPECT_EQ(10000, p.size());
+    std::set<mfstring_handle> distinct(handles.begin(), handles.end());
+    EXPECT_EQ(10000, distinct.size());
+    for (int i = 0; i < 10000; ++i)
+    {
+        std::string s = "name" + std::to_string(i);
+        EXPECT_EQ(handles[i], p.intern(s));
+        EXPECT_EQ(handles[i], p.find(s));
+        EXPECT_EQ(s, p.str(handles[i]));
+    }
+    EXPECT_EQ(10000, p.size());
+}
+
+TEST(StringpoolTest, Footprint)
+{
+    mfstringpool p(64, 8);
+    p.intern("abc");
+    p.intern("de");
+    mffootprint f = p.memory_footprint();
+    EXPECT_EQ(2, f.elements);
+    EXPECT_EQ(7, f.payload);
+    EXPECT_EQ(2 * (3 * sizeof(std::uint32_t) + sizeof(std::uint32_t)), f.links);
+    EXPECT_EQ((16 - 2) * sizeof(std::uint32_t), f.empty_buckets);
+    EXPECT_EQ(64 - 7 + 6 * 3 * sizeof(std::uint32_t), f.unused);
+}
+
+TEST(StringpoolTest, Map)
+{
+    mfstringpool p;
+    mfstringmap<int> m(p, 100);
+    m.insert("one", 1);
+    m.insert(std::string("two"), 2);
+    m.insert(p.intern("three"), 3);
+    EXPECT_EQ(3, m.size());
+    EXPECT_EQ(1, m["one"]);
+    EXPECT_EQ(2, m[std::string("two")]);
+    EXPECT_EQ(3, m[p.find("three")]);
+    EXPECT_EQ(m.none(), m["four"]);
+    EXPECT_EQ(mfstring_npos, p.find("four"));
+
+    // A second map over the same pool shares the characters.
+    mfstringmap<int> n(p, 100);
+    n.insert("one", 10);
+    EXPECT_EQ(3, p.size());
+    EXPECT_EQ(10, n["one"]);
+    EXPECT_EQ(1, m["one"]);
+}
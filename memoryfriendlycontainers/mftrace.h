@@ -0,0 +1,359 @@
+//
+// Copyright (c) 2014 Jakub Jabłoński
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#ifndef memoryfriendlycontainers_mftrace_h
+#define memoryfriendlycontainers_mftrace_h
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "mfhash.h"
+
+/**
+ * Binary traces of map operations, recorded from a running program and
+ * replayed offline against other maps, capacities or hash functions.
+ *
+ * A trace file is a 16 byte header (the magic "mftrace1" and the start time
+ * in nanoseconds since the epoch) followed by 12 byte records: the 64-bit
+ * key hash and a 32-bit word holding the operation in bits 0-1, whether it
+ * hit in bit 2 and the nanoseconds since the previous record in bits 3-31,
+ * saturating at about half a second. Both are little endian.
+ *
+ * Keys are recorded as mftrace_key(key), the seed-independent mfhash of the
+ * key, so a trace keeps which operations touch the same key without holding
+ * the keys themselves.
+ */
+
+enum mftrace_op
+{
+	mftrace_insert, /**< hit: the entry was stored */
+	mftrace_find,   /**< hit: the key was found */
+	mftrace_erase   /**< hit: an entry was removed */
+};
+
+static const std::size_t mftrace_ops = 3;
+
+struct mftrace_record
+{
+	std::uint64_t key;
+	std::uint32_t delta_ns;
+	mftrace_op op;
+	bool hit;
+};
+
+static const char mftrace_magic[8] = { 'm', 'f', 't', 'r', 'a', 'c', 'e', '1' };
+static const std::size_t mftrace_header_bytes = 16;
+static const std::size_t mftrace_record_bytes = 12;
+static const std::uint32_t mftrace_max_delta_ns = (std::uint32_t(1) << 29) - 1;
+
+/**
+ * A writer reads the clock for every this many records; the records in
+ * between have delta_ns 0, so the deltas still add up to the time traced.
+ */
+static const std::size_t mftrace_clock_interval = 16;
+
+/** Records buffered by a writer between writes to the file. */
+static const std::size_t mftrace_buffer_records = 4096;
+
+template<typename K>
+inline std::uint64_t mftrace_key(const K& key)
+{
+	return mfhash_stable(key);
+}
+
+inline void mftrace_put(unsigned char* p, std::uint64_t x, std::size_t bytes)
+{
+	for (std::size_t i = 0; i < bytes; ++i, x >>= 8)
+	{
+		p[i] = (unsigned char) x;
+	}
+}
+
+inline std::uint64_t mftrace_get(const unsigned char* p, std::size_t bytes)
+{
+	std::uint64_t x = 0;
+	for (std::size_t i = bytes; i-- > 0;)
+	{
+		x = (x << 8) | p[i];
+	}
+	return x;
+}
+
+/**
+ * Appends records to a trace file. Recording an operation mostly costs a
+ * copy into the buffer, since the clock is read only every
+ * mftrace_clock_interval records. The buffer is written out when full, on
+ * flush() and when the writer is destroyed. A writer is used by one thread at a time, like
+ * the map it is attached to.
+ */
+class mftrace_writer
+{
+public:
+	typedef std::chrono::steady_clock clock;
+
+	/** Creates or truncates the file at path; ok() tells whether that worked. */
+	explicit mftrace_writer(const char* path) : file_(std::fopen(path, "wb")), buffer_(0), used_(0), records_(0)
+	{
+		if (!file_)
+		{
+			return;
+		}
+		unsigned char header[mftrace_header_bytes];
+		std::memcpy(header, mftrace_magic, sizeof(mftrace_magic));
+		std::uint64_t start = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+		mftrace_put(header + 8, start, 8);
+		if (std::fwrite(header, sizeof(header), 1, file_) != 1)
+		{
+			std::fclose(file_);
+			file_ = 0;
+			return;
+		}
+		buffer_ = new unsigned char[mftrace_buffer_records * mftrace_record_bytes];
+		last_ = clock::now();
+	}
+
+	~mftrace_writer()
+	{
+		close();
+	}
+
+	bool ok() const
+	{
+		return file_ != 0;
+	}
+
+	/** Number of records written or buffered so far. */
+	std::size_t records() const
+	{
+		return records_;
+	}
+
+	void record(mftrace_op op, std::uint64_t key, bool hit)
+	{
+		if (!file_)
+		{
+			return;
+		}
+		std::uint64_t delta = 0;
+		if (records_ % mftrace_clock_interval == 0)
+		{
+			clock::time_point now = clock::now();
+			delta = std::chrono::duration_cast<std::chrono::nanoseconds>(now - last_).count();
+			last_ = now;
+		}
+		std::uint32_t word = std::uint32_t(op) | (hit ? 4 : 0) | (std::uint32_t(std::min<std::uint64_t>(delta, mftrace_max_delta_ns)) << 3);
+		unsigned char* p = buffer_ + used_ * mftrace_record_bytes;
+		mftrace_put(p, key, 8);
+		mftrace_put(p + 8, word, 4);
+		++records_;
+		if (++used_ == mftrace_buffer_records)
+		{
+			flush();
+		}
+	}
+
+	/** Writes the buffered records to the file. */
+	bool flush()
+	{
+		if (!file_)
+		{
+			return false;
+		}
+		bool written = std::fwrite(buffer_, mftrace_record_bytes, used_, file_) == used_;
+		used_ = 0;
+		return std::fflush(file_) == 0 && written;
+	}
+
+	void close()
+	{
+		if (file_)
+		{
+			flush();
+			std::fclose(file_);
+			file_ = 0;
+		}
+		delete[] buffer_;
+		buffer_ = 0;
+	}
+
+private:
+	mftrace_writer(const mftrace_writer&);
+	mftrace_writer& operator=(const mftrace_writer&);
+
+	std::FILE* file_;
+	unsigned char* buffer_;
+	std::size_t used_;
+	std::size_t records_;
+	clock::time_point last_;
+};
+
+/**
+ * Reads the records of the trace file at path into ops. Returns false if
+ * the file can't be read, is not a trace or holds a record with an unknown
+ * operation; a truncated last record is dropped.
+ */
+inline bool mftrace_load(const char* path, std::vector<mftrace_record>& ops)
+{
+	std::FILE* f = std::fopen(path, "rb");
+	if (!f)
+	{
+		return false;
+	}
+	unsigned char header[mftrace_header_bytes];
+	if (std::fread(header, sizeof(header), 1, f) != 1 || std::memcmp(header, mftrace_magic, sizeof(mftrace_magic)))
+	{
+		std::fclose(f);
+		return false;
+	}
+	std::vector<unsigned char> buffer(mftrace_buffer_records * mftrace_record_bytes);
+	std::size_t n;
+	while ((n = std::fread(&buffer[0], mftrace_record_bytes, mftrace_buffer_records, f)) > 0)
+	{
+		for (std::size_t i = 0; i < n; ++i)
+		{
+			const unsigned char* p = &buffer[i * mftrace_record_bytes];
+			std::uint32_t word = std::uint32_t(mftrace_get(p + 8, 4));
+			if ((word & 3) > mftrace_erase)
+			{
+				std::fclose(f);
+				return false;
+			}
+			mftrace_record r;
+			r.key = mftrace_get(p, 8);
+			r.op = mftrace_op(word & 3);
+			r.hit = (word & 4) != 0;
+			r.delta_ns = word >> 3;
+			ops.push_back(r);
+		}
+	}
+	std::fclose(f);
+	return true;
+}
+
+/** Latencies of one kind of operation, in nanoseconds. */
+struct mftrace_latency
+{
+	std::size_t count;
+	double p50;
+	double p90;
+	double p99;
+	double p999;
+	double max;
+};
+
+struct mftrace_replay_result
+{
+	double ops_per_second;              /**< replaying without timing each operation */
+	std::size_t hits;                   /**< operations that hit in the replayed map */
+	mftrace_latency latency[mftrace_ops]; /**< indexed by mftrace_op */
+};
+
+/** Percentiles of the latencies in v, which gets reordered. */
+inline mftrace_latency mftrace_percentiles(std::vector<double>& v)
+{
+	mftrace_latency l = { v.size(), 0, 0, 0, 0, 0 };
+	if (v.empty())
+	{
+		return l;
+	}
+	std::sort(v.begin(), v.end());
+	l.p50 = v[(v.size() - 1) * 50 / 100];
+	l.p90 = v[(v.size() - 1) * 90 / 100];
+	l.p99 = v[(v.size() - 1) * 99 / 100];
+	l.p999 = v[(v.size() - 1) * 999 / 1000];
+	l.max = v.back();
+	return l;
+}
+
+/** Applies one traced operation to map; true if it hit. */
+template<typename M>
+inline bool mftrace_apply(M& map, const mftrace_record& op)
+{
+	switch (op.op)
+	{
+	case mftrace_insert:
+		return map.insert(op.key);
+	case mftrace_find:
+		return map.find(op.key);
+	default:
+		return map.erase(op.key);
+	}
+}
+
+/**
+ * Applies ops to maps returned by make() and measures them. make() is called
+ * twice, for a pass that measures throughput and one that times every
+ * operation; its result needs insert(key) and erase(key) returning whether
+ * they changed the map, and find(key) returning whether key is there. The
+ * cost of reading the clock is subtracted from the latencies.
+ */
+template<typename Make>
+mftrace_replay_result mftrace_replay(const std::vector<mftrace_record>& ops, Make make)
+{
+	typedef std::chrono::steady_clock clock;
+	typedef decltype(make()) map_type;
+	mftrace_replay_result r;
+	r.hits = 0;
+
+	{
+		map_type m = make();
+		std::size_t hits = 0;
+		clock::time_point start = clock::now();
+		for (std::size_t i = 0; i < ops.size(); ++i)
+		{
+			hits += mftrace_apply(m, ops[i]);
+		}
+		double elapsed = std::chrono::duration<double>(clock::now() - start).count();
+		r.ops_per_second = elapsed > 0 ? ops.size() / elapsed : 0;
+		r.hits = hits;
+	}
+
+	double clock_ns = 1e9;
+	for (int i = 0; i < 1000; ++i)
+	{
+		clock::time_point a = clock::now();
+		clock::time_point b = clock::now();
+		clock_ns = std::min(clock_ns, std::chrono::duration<double, std::nano>(b - a).count());
+	}
+
+	std::vector<double> latencies[mftrace_ops];
+	map_type m = make();
+	for (std::size_t i = 0; i < ops.size(); ++i)
+	{
+		clock::time_point start = clock::now();
+		mftrace_apply(m, ops[i]);
+		clock::time_point end = clock::now();
+		latencies[ops[i].op].push_back(std::max(0.0, std::chrono::duration<double, std::nano>(end - start).count() - clock_ns));
+	}
+	for (std::size_t k = 0; k < mftrace_ops; ++k)
+	{
+		r.latency[k] = mftrace_percentiles(latencies[k]);
+	}
+	return r;
+}
+
+#endif
@@ -0,0 +1,222 @@
+//
+// Copyright (c) 2014 Jakub Jabłoński
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "mfhashmapsc.h"
+#include "mftrace.h"
+#include "gtest/gtest.h"
+
+class TraceTest : public ::testing::Test
+{
+protected:
+    /** Set of keys that replays like a map. */
+    struct set_replay
+    {
+        std::set<std::uint64_t> keys;
+
+        bool insert(std::uint64_t key)
+        {
+            return keys.insert(key).second;
+        }
+
+        bool find(std::uint64_t key)
+        {
+            return keys.count(key) != 0;
+        }
+
+        bool erase(std::uint64_t key)
+        {
+            return keys.erase(key) != 0;
+        }
+    };
+
+    TraceTest()
+    {
+        std::strcpy(path, "/tmp/mftrace_test_XXXXXX");
+        close(mkstemp(path));
+    }
+
+    ~TraceTest()
+    {
+        unlink(path);
+    }
+
+    char path[32];
+};
+
+TEST_F(TraceTest, WriteAndLoad)
+{
+    {
+        mftrace_writer w(path);
+        ASSERT_TRUE(w.ok());
+        for (std::uint64_t i = 0; i < 10000; ++i)
+        {
+            w.record(mftrace_op(i % 3), i * 0x100000001ULL, i % 2 == 0);
+        }
+        EXPECT_EQ(10000, w.records());
+    }
+
+    std::vector<mftrace_record> ops;
+    ASSERT_TRUE(mftrace_load(path, ops));
+    ASSERT_EQ(10000, ops.size());
+    for (std::uint64_t i = 0; i < ops.size(); ++i)
+    {
+        EXPECT_EQ(i * 0x100000001ULL, ops[i].key);
+        EXPECT_EQ(mftrace_op(i % 3), ops[i].op);
+        EXPECT_EQ(i % 2 == 0, ops[i].hit);
+        EXPECT_LE(ops[i].delta_ns, mftrace_max_delta_ns);
+    }
+
+    FILE* f = std::fopen(path, "rb");
+    ASSERT_TRUE(f != 0);
+    std::fseek(f, 0, SEEK_END);
+    EXPECT_EQ(long(mftrace_header_bytes + 10000 * mftrace_record_bytes), std::ftell(f));
+    std::fclose(f);
+}
+
+TEST_F(TraceTest, NotATrace)
+{
+    FILE* f = std::fopen(path, "wb");
+    std::fputs("mfvector and more", f);
+    std::fclose(f);
+    std::vector<mftrace_record> ops;
+    EXPECT_FALSE(mftrace_load(path, ops));
+    EXPECT_FALSE(mftrace_load("/nonexistent/trace", ops));
+}
+
+TEST_F(TraceTest, UnknownOp)
+{
+    unsigned char bytes[mftrace_header_bytes + 2 * mftrace_record_bytes] = {};
+    std::memcpy(bytes, mftrace_magic, sizeof(mftrace_magic));
+    unsigned char* record = bytes + mftrace_header_bytes;
+    mftrace_put(record + 8, mftrace_find, 4);
+    record += mftrace_record_bytes;
+    mftrace_put(record, 42, 8);
+    mftrace_put(record + 8, 3 | 4, 4);
+    FILE* f = std::fopen(path, "wb");
+    ASSERT_TRUE(f != 0);
+    std::fwrite(bytes, sizeof(bytes), 1, f);
+    std::fclose(f);
+    std::vector<mftrace_record> ops;
+    EXPECT_FALSE(mftrace_load(path, ops));
+}
+
+TEST_F(TraceTest, RecordHashmap)
+{
+    mfhashmapsc<int, int> m(4);
+    {
+        mftrace_writer w(path);
+        m.set_trace(&w);
+        m.insert(1, 10);
+        m.insert(2, 20);
+        EXPECT_EQ(10, m[1]);
+        EXPECT_EQ(0, m[3]);
+        m.set_trace(0);
+        m.insert(3, 30);
+    }
+
+    std::vector<mftrace_record> ops;
+    ASSERT_TRUE(mftrace_load(path, ops));
+    ASSERT_EQ(4, ops.size());
+    EXPECT_EQ(mftrace_insert, ops[0].op);
+    EXPECT_EQ(mftrace_key(1), ops[0].key);
+    EXPECT_TRUE(ops[0].hit);
+    EXPECT_EQ(mftrace_key(2), ops[1].key);
+    EXPECT_EQ(mftrace_find, ops[2].op);
+    EXPECT_EQ(mftrace_key(1), ops[2].key);
+    EXPECT_TRUE(ops[2].hit);
+    EXPECT_EQ(mftrace_key(3), ops[3].key);
+    EXPECT_FALSE(ops[3].hit);
+}
+
+/** Key with an mfhash but no std::hash. */
+struct trace_point
+{
+    int x;
+    int y;
+};
+
+template<>
+struct mfhash<trace_point>
+{
+    std::size_t mask;
+    std::size_t seed;
+
+    std::size_t operator()(const trace_point& p) const
+    {
+        return std::size_t(mfhash_mix((std::uint64_t(unsigned(p.x)) << 32 | unsigned(p.y)) + seed)) & mask;
+    }
+};
+
+TEST_F(TraceTest, KeyWithoutStdHash)
+{
+    trace_point a = { 1, 2 };
+    trace_point b = { 2, 1 };
+    EXPECT_EQ(mftrace_key(a), mftrace_key(a));
+    EXPECT_NE(mftrace_key(a), mftrace_key(b));
+    EXPECT_EQ(mftrace_key(std::string("key")), mftrace_key(std::string("key")));
+}
+
+TEST_F(TraceTest, Replay)
+{
+    std::vector<mftrace_record> ops;
+    for (std::uint64_t i = 0; i < 1000; ++i)
+    {
+        mftrace_record r = { mfhash_mix(i % 100), 0, i < 100 ? mftrace_insert : i < 900 ? mftrace_find : mftrace_erase, false };
+        ops.push_back(r);
+    }
+    mftrace_replay_result r = mftrace_replay(ops, [] { return set_replay(); });
+    // 100 inserts, 800 finds of inserted keys, 100 erases of them.
+    EXPECT_EQ(1000, r.hits);
+    EXPECT_GT(r.ops_per_second, 0);
+    EXPECT_EQ(100, r.latency[mftrace_insert].count);
+    EXPECT_EQ(800, r.latency[mftrace_find].count);
+    EXPECT_EQ(100, r.latency[mftrace_erase].count);
+    EXPECT_LE(r.latency[mftrace_find].p50, r.latency[mftrace_find].p99);
+    EXPECT_LE(r.latency[mftrace_find].p99, r.latency[mftrace_find].max);
+}
+
+TEST(TraceReplayTest, Percentiles)
+{
+    std::vector<double> v;
+    for (int i = 1000; i > 0; --i)
+    {
+        v.push_back(i);
+    }
+    mftrace_latency l = mftrace_percentiles(v);
+    EXPECT_EQ(1000, l.count);
+    EXPECT_EQ(500, l.p50);
+    EXPECT_EQ(900, l.p90);
+    EXPECT_EQ(990, l.p99);
+    EXPECT_EQ(999, l.p999);
+    EXPECT_EQ(1000, l.max);
+}
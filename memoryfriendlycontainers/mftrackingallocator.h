@@ -0,0 +1,576 @@
+//
+// Copyright (c) 2014 Jakub Jabłoński
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef memoryfriendlycontainers_mftrackingallocator_h
+#define memoryfriendlycontainers_mftrackingallocator_h
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <mutex>
+#include <new>
+#include <string>
+#include <vector>
+
+#include <iomanip>
+#include <ostream>
+
+#if defined(__linux__) || defined(__APPLE__)
+#include <execinfo.h>
+#define MFTRACKING_BACKTRACE 1
+#else
+#define MFTRACKING_BACKTRACE 0
+#endif
+
+/*
+ * Allocation statistics for mftrackingallocator (and DebugAllocator).
+ *
+ * Every allocating type gets a key. Each thread counts calls, bytes and
+ * allocation sizes per key in its own block, with relaxed atomic stores
+ * that compile to plain adds, so recording costs a few nanoseconds and no
+ * shared cache line is written. mftracking_collect() adds up the blocks of
+ * all threads, including those that exited, when a report is wanted.
+ *
+ * Live bytes per key are exact. The process-wide live and peak bytes are
+ * kept in shared counters that each thread updates only after its own
+ * balance moved by mftracking_flush_bytes, so the peak is exact to within
+ * that much per thread.
+ *
+ * Optionally every mftracking_set_sample_interval() bytes a thread records
+ * the call stack of the allocation, so reports can name the call sites
+ * that allocate most; sampled stacks are weighted by the interval.
+ */
+
+/** Distinct keys counted separately; later ones are counted under the last. */
+static const int mftracking_max_keys = 128;
+
+/** Size classes of the histograms: up to 8 bytes, up to 16, ..., larger than 32 MB. */
+static const int mftracking_size_classes = 24;
+
+/** Change of a thread's balance after which the shared live and peak bytes are updated. */
+static const std::int64_t mftracking_flush_bytes = 64 * 1024;
+
+/** Frames kept of a sampled call stack. */
+static const int mftracking_frames = 12;
+
+inline int mftracking_size_class(std::size_t n)
+{
+	if (n <= 8)
+	{
+		return 0;
+	}
+	int c = 61 - __builtin_clzll((unsigned long long) n - 1);
+	return c < mftracking_size_classes - 1 ? c : mftracking_size_classes - 1;
+}
+
+/** Largest size in class c, 0 for the last one. */
+inline std::size_t mftracking_size_class_limit(int c)
+{
+	return c < mftracking_size_classes - 1 ? std::size_t(8) << c : 0;
+}
+
+/** Counters of one key; only the owning thread writes them. */
+struct mftracking_counters
+{
+	std::atomic<std::uint64_t> allocs;
+	std::atomic<std::uint64_t> frees;
+	std::atomic<std::uint64_t> bytes_allocated;
+	std::atomic<std::uint64_t> bytes_freed;
+	std::atomic<std::uint64_t> size_classes[mftracking_size_classes];
+};
+
+inline void mftracking_add(std::atomic<std::uint64_t>& c, std::uint64_t n)
+{
+	c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+struct mftracking_thread
+{
+	mftracking_counters keys[mftracking_max_keys];
+	std::int64_t balance;
+	std::atomic<std::int64_t> until_sample;
+
+	mftracking_thread() : balance(0), until_sample(std::numeric_limits<std::int64_t>::max())
+	{
+		std::memset((void*) keys, 0, sizeof(keys));
+	}
+
+	void merge(const mftracking_thread& t)
+	{
+		for (int k = 0; k < mftracking_max_keys; ++k)
+		{
+			mftracking_counters& c = keys[k];
+			const mftracking_counters& o = t.keys[k];
+			mftracking_add(c.allocs, o.allocs.load(std::memory_order_relaxed));
+			mftracking_add(c.frees, o.frees.load(std::memory_order_relaxed));
+			mftracking_add(c.bytes_allocated, o.bytes_allocated.load(std::memory_order_relaxed));
+			mftracking_add(c.bytes_freed, o.bytes_freed.load(std::memory_order_relaxed));
+			for (int s = 0; s < mftracking_size_classes; ++s)
+			{
+				mftracking_add(c.size_classes[s], o.size_classes[s].load(std::memory_order_relaxed));
+			}
+		}
+	}
+};
+
+/** Call stack seen by the sampler. */
+struct mftracking_site
+{
+	void* frames[mftracking_frames];
+	int depth;
+	int key;
+	std::uint64_t samples;
+	std::uint64_t sampled_bytes;
+	std::uint64_t estimated_bytes;
+};
+
+/** Shared state; threads take the lock only to attach, detach and sample. */
+struct mftracking_registry
+{
+	std::mutex lock;
+	std::vector<std::string> names;
+	std::vector<mftracking_thread*> threads;
+	mftracking_thread retired;
+	std::vector<mftracking_site> sites;
+	std::atomic<std::int64_t> live;
+	std::atomic<std::int64_t> peak;
+	std::atomic<std::int64_t> sample_interval;
+
+	mftracking_registry() : live(0), peak(0), sample_interval(0)
+	{}
+};
+
+inline mftracking_registry& mftracking_global()
+{
+	static mftracking_registry registry;
+	return registry;
+}
+
+/**
+ * Block of the current thread: 0 until the thread first counts, and 0
+ * again once its attachment is destroyed, with detached set.
+ */
+struct mftracking_local_state
+{
+	mftracking_thread* block;
+	bool detached;
+};
+
+inline mftracking_local_state& mftracking_tls()
+{
+	static thread_local mftracking_local_state state = { 0, false };
+	return state;
+}
+
+/** Registers the block of the current thread while the thread runs. */
+struct mftracking_attachment
+{
+	mftracking_thread block;
+
+	mftracking_attachment()
+	{
+		mftracking_registry& r = mftracking_global();
+		std::lock_guard<std::mutex> guard(r.lock);
+		std::int64_t interval = r.sample_interval.load(std::memory_order_relaxed);
+		if (interval)
+		{
+			block.until_sample.store(interval, std::memory_order_relaxed);
+		}
+		r.threads.push_back(&block);
+	}
+
+	~mftracking_attachment()
+	{
+		mftracking_registry& r = mftracking_global();
+		std::lock_guard<std::mutex> guard(r.lock);
+		r.retired.merge(block);
+		r.threads.erase(std::find(r.threads.begin(), r.threads.end(), &block));
+		r.live.fetch_add(block.balance, std::memory_order_relaxed);
+		block.balance = 0;
+		mftracking_local_state& s = mftracking_tls();
+		s.block = 0;
+		s.detached = true;
+	}
+};
+
+/**
+ * Block of the current thread, or 0 when the thread's locals are being
+ * destroyed and its block is gone; its counts then go to retired.
+ */
+inline mftracking_thread* mftracking_local()
+{
+	mftracking_local_state& s = mftracking_tls();
+	if (!s.block && !s.detached)
+	{
+		static thread_local mftracking_attachment attachment;
+		s.block = &attachment.block;
+	}
+	return s.block;
+}
+
+/** Key for a name; keys beyond mftracking_max_keys share the last one. */
+inline int mftracking_register(const std::string& name)
+{
+	mftracking_registry& r = mftracking_global();
+	std::lock_guard<std::mutex> guard(r.lock);
+	if (r.names.size() == std::size_t(mftracking_max_keys - 1))
+	{
+		r.names.push_back("(other)");
+	}
+	if (r.names.size() == std::size_t(mftracking_max_keys))
+	{
+		return mftracking_max_keys - 1;
+	}
+	r.names.push_back(name);
+	return int(r.names.size() - 1);
+}
+
+/** Name of T taken from the compiler's function signature, as RTTI may be off. */
+template<typename T>
+std::string mftracking_type_name()
+{
+	std::string s = __PRETTY_FUNCTION__;
+	std::size_t b = s.find("T = ");
+	if (b == std::string::npos)
+	{
+		return s;
+	}
+	b += 4;
+	std::size_t e = s.find_first_of(";]", b);
+	return s.substr(b, e == std::string::npos ? e : e - b);
+}
+
+/** Key of allocations of T. */
+template<typename T>
+int mftracking_key()
+{
+	static const int key = mftracking_register(mftracking_type_name<T>());
+	return key;
+}
+
+inline void mftracking_flush(mftracking_thread& t)
+{
+	mftracking_registry& r = mftracking_global();
+	std::int64_t live = r.live.fetch_add(t.balance, std::memory_order_relaxed) + t.balance;
+	t.balance = 0;
+	std::int64_t peak = r.peak.load(std::memory_order_relaxed);
+	while (live > peak && !r.peak.compare_exchange_weak(peak, live, std::memory_order_relaxed))
+	{
+	}
+}
+
+inline void mftracking_sample(mftracking_thread& t, int key, std::size_t n)
+{
+	mftracking_registry& r = mftracking_global();
+	std::int64_t interval = r.sample_interval.load(std::memory_order_relaxed);
+	t.until_sample.store(interval ? interval : std::numeric_limits<std::int64_t>::max(), std::memory_order_relaxed);
+	if (!interval)
+	{
+		return;
+	}
+	mftracking_site s;
+#if MFTRACKING_BACKTRACE
+	s.depth = backtrace(s.frames, mftracking_frames);
+#else
+	s.depth = 0;
+#endif
+	std::lock_guard<std::mutex> guard(r.lock);
+	std::vector<mftracking_site>::iterator i = r.sites.begin();
+	while (i != r.sites.end()
+	       && (i->key != key || i->depth != s.depth || std::memcmp(i->frames, s.frames, s.depth * sizeof(void*))))
+	{
+		++i;
+	}
+	if (i == r.sites.end())
+	{
+		s.key = key;
+		s.samples = 0;
+		s.sampled_bytes = 0;
+		s.estimated_bytes = 0;
+		i = r.sites.insert(r.sites.end(), s);
+	}
+	++i->samples;
+	i->sampled_bytes += n;
+	i->estimated_bytes += std::max<std::uint64_t>(n, interval);
+}
+
+/** Counts n bytes allocated under key in t; true when its balance is due to be flushed. */
+inline bool mftracking_count_allocated(mftracking_thread& t, int key, std::size_t n)
+{
+	mftracking_counters& c = t.keys[key];
+	mftracking_add(c.allocs, 1);
+	mftracking_add(c.bytes_allocated, n);
+	mftracking_add(c.size_classes[mftracking_size_class(n)], 1);
+	return (t.balance += n) >= mftracking_flush_bytes;
+}
+
+inline bool mftracking_count_freed(mftracking_thread& t, int key, std::size_t n)
+{
+	mftracking_counters& c = t.keys[key];
+	mftracking_add(c.frees, 1);
+	mftracking_add(c.bytes_freed, n);
+	return (t.balance -= n) <= -mftracking_flush_bytes;
+}
+
+/** Records n bytes allocated under key by the current thread. */
+inline void mftracking_allocated(int key, std::size_t n)
+{
+	mftracking_thread* p = mftracking_local();
+	if (!p)
+	{
+		mftracking_registry& r = mftracking_global();
+		std::lock_guard<std::mutex> guard(r.lock);
+		mftracking_count_allocated(r.retired, key, n);
+		mftracking_flush(r.retired);
+		return;
+	}
+	mftracking_thread& t = *p;
+	if (mftracking_count_allocated(t, key, n))
+	{
+		mftracking_flush(t);
+	}
+	std::int64_t until = t.until_sample.load(std::memory_order_relaxed) - std::int64_t(n);
+	t.until_sample.store(until, std::memory_order_relaxed);
+	if (until < 0)
+	{
+		mftracking_sample(t, key, n);
+	}
+}
+
+/** Records n bytes under key freed by the current thread. */
+inline void mftracking_freed(int key, std::size_t n)
+{
+	mftracking_thread* t = mftracking_local();
+	if (!t)
+	{
+		mftracking_registry& r = mftracking_global();
+		std::lock_guard<std::mutex> guard(r.lock);
+		mftracking_count_freed(r.retired, key, n);
+		mftracking_flush(r.retired);
+		return;
+	}
+	if (mftracking_count_freed(*t, key, n))
+	{
+		mftracking_flush(*t);
+	}
+}
+
+/**
+ * Samples a call stack about every interval allocated bytes in each thread;
+ * 0 turns sampling off. Earlier samples are kept.
+ */
+inline void mftracking_set_sample_interval(std::size_t interval)
+{
+	mftracking_registry& r = mftracking_global();
+	std::lock_guard<std::mutex> guard(r.lock);
+	r.sample_interval.store(interval, std::memory_order_relaxed);
+	for (std::size_t i = 0; i < r.threads.size(); ++i)
+	{
+		r.threads[i]->until_sample.store(interval ? std::int64_t(interval) : std::numeric_limits<std::int64_t>::max(),
+		                                 std::memory_order_relaxed);
+	}
+}
+
+/** Totals of one key over all threads. */
+struct mftracking_key_stats
+{
+	std::string name;
+	std::uint64_t allocs;
+	std::uint64_t frees;
+	std::uint64_t bytes_allocated;
+	std::uint64_t bytes_freed;
+	std::uint64_t size_classes[mftracking_size_classes];
+
+	std::int64_t live_bytes() const
+	{
+		return std::int64_t(bytes_allocated - bytes_freed);
+	}
+};
+
+struct mftracking_snapshot
+{
+	std::vector<mftracking_key_stats> keys; /**< keys that allocated, most live bytes first */
+	std::vector<mftracking_site> sites;     /**< sampled call stacks, most estimated bytes first */
+	std::int64_t live_bytes;
+	std::int64_t peak_bytes;
+	std::size_t sample_interval;
+
+	const mftracking_key_stats* find(const std::string& name) const
+	{
+		for (std::size_t i = 0; i < keys.size(); ++i)
+		{
+			if (keys[i].name == name)
+			{
+				return &keys[i];
+			}
+		}
+		return 0;
+	}
+};
+
+/** Adds up the counters of all threads; they keep counting meanwhile. */
+inline mftracking_snapshot mftracking_collect()
+{
+	mftracking_registry& r = mftracking_global();
+	mftracking_thread* sum = new mftracking_thread;
+	mftracking_snapshot s;
+	std::int64_t unflushed = 0;
+	{
+		std::lock_guard<std::mutex> guard(r.lock);
+		sum->merge(r.retired);
+		for (std::size_t i = 0; i < r.threads.size(); ++i)
+		{
+			sum->merge(*r.threads[i]);
+		}
+		for (std::size_t k = 0; k < r.names.size(); ++k)
+		{
+			const mftracking_counters& c = sum->keys[k];
+			if (!c.allocs.load(std::memory_order_relaxed))
+			{
+				continue;
+			}
+			mftracking_key_stats ks;
+			ks.name = r.names[k];
+			ks.allocs = c.allocs.load(std::memory_order_relaxed);
+			ks.frees = c.frees.load(std::memory_order_relaxed);
+			ks.bytes_allocated = c.bytes_allocated.load(std::memory_order_relaxed);
+			ks.bytes_freed = c.bytes_freed.load(std::memory_order_relaxed);
+			for (int i = 0; i < mftracking_size_classes; ++i)
+			{
+				ks.size_classes[i] = c.size_classes[i].load(std::memory_order_relaxed);
+			}
+			s.keys.push_back(ks);
+			unflushed += ks.live_bytes();
+		}
+		s.sites = r.sites;
+		s.sample_interval = std::size_t(r.sample_interval.load(std::memory_order_relaxed));
+	}
+	delete sum;
+	s.live_bytes = unflushed;
+	s.peak_bytes = std::max(r.peak.load(std::memory_order_relaxed), s.live_bytes);
+	std::sort(s.keys.begin(), s.keys.end(), [](const mftracking_key_stats& a, const mftracking_key_stats& b) {
+		return a.live_bytes() > b.live_bytes();
+	});
+	std::sort(s.sites.begin(), s.sites.end(), [](const mftracking_site& a, const mftracking_site& b) {
+		return a.estimated_bytes > b.estimated_bytes;
+	});
+	return s;
+}
+
+/** Prints a collected report: keys with their size histograms, then the heaviest sampled call sites. */
+inline void mftracking_report(std::ostream& o, std::size_t max_sites = 10)
+{
+	mftracking_snapshot s = mftracking_collect();
+	o << "mftracking: live " << s.live_bytes << " bytes, peak " << s.peak_bytes << " bytes\n";
+	o << std::setw(12) << "allocs" << std::setw(12) << "frees" << std::setw(16) << "allocated" << std::setw(16)
+	  << "live" << "  type\n";
+	for (std::size_t k = 0; k < s.keys.size(); ++k)
+	{
+		const mftracking_key_stats& ks = s.keys[k];
+		o << std::setw(12) << ks.allocs << std::setw(12) << ks.frees << std::setw(16) << ks.bytes_allocated
+		  << std::setw(16) << ks.live_bytes() << "  " << ks.name << "\n" << std::setw(54) << "sizes";
+		for (int c = 0; c < mftracking_size_classes; ++c)
+		{
+			if (ks.size_classes[c])
+			{
+				std::size_t limit = mftracking_size_class_limit(c);
+				o << (limit ? " <=" : " >") << (limit ? limit : mftracking_size_class_limit(c - 1)) << ":"
+				  << ks.size_classes[c];
+			}
+		}
+		o << "\n";
+	}
+	if (s.sites.empty())
+	{
+		return;
+	}
+	mftracking_registry& r = mftracking_global();
+	o << "sampled call sites (every " << s.sample_interval << " bytes):\n";
+	for (std::size_t i = 0; i < s.sites.size() && i < max_sites; ++i)
+	{
+		const mftracking_site& site = s.sites[i];
+		std::string name;
+		{
+			std::lock_guard<std::mutex> guard(r.lock);
+			name = r.names[site.key];
+		}
+		o << "  ~" << site.estimated_bytes << " bytes in " << site.samples << " samples of " << name << "\n";
+#if MFTRACKING_BACKTRACE
+		char** symbols = backtrace_symbols(site.frames, site.depth);
+		for (int f = 0; symbols && f < site.depth; ++f)
+		{
+			o << "      " << symbols[f] << "\n";
+		}
+		std::free(symbols);
+#endif
+	}
+}
+
+/**
+ * Allocator counting its allocations under the key of T (the element type
+ * it was rebound to), e.g. to find which node types of a std::map hog
+ * memory. Allocates with the global operator new.
+ */
+template<typename T>
+class mftrackingallocator
+{
+public:
+	typedef T value_type;
+
+	mftrackingallocator()
+	{}
+
+	template<typename U>
+	mftrackingallocator(const mftrackingallocator<U>&)
+	{}
+
+	T* allocate(std::size_t n)
+	{
+		T* p = (T*) ::operator new(n * sizeof(T));
+		mftracking_allocated(mftracking_key<T>(), n * sizeof(T));
+		return p;
+	}
+
+	void deallocate(T* p, std::size_t n)
+	{
+		mftracking_freed(mftracking_key<T>(), n * sizeof(T));
+		::operator delete((void*) p);
+	}
+};
+
+template<typename T1, typename T2>
+bool operator==(const mftrackingallocator<T1>&, const mftrackingallocator<T2>&)
+{
+	return true;
+}
+
+template<typename T1, typename T2>
+bool operator!=(const mftrackingallocator<T1>&, const mftrackingallocator<T2>&)
+{
+	return false;
+}
+
+
+#endif
@@ -0,0 +1,64 @@
+//
+// Copyright (c) 2014 Jakub Jabłoński
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "mfbench.h"
+#include "mftrackingallocator.h"
+
+struct tracked_node
+{
+	char bytes[64];
+};
+
+template<typename A>
+static void alloc_free(mfbench& b, const char* name, std::vector<tracked_node*>& live)
+{
+	A alloc;
+	b.run(name, live.size(), 0, [&] {
+		for (std::size_t i = 0; i < live.size(); ++i)
+		{
+			live[i] = alloc.allocate(1);
+		}
+		for (std::size_t i = 0; i < live.size(); ++i)
+		{
+			alloc.deallocate(live[i], 1);
+		}
+	});
+}
+
+/**
+ * Cost of counting allocations: batches of 64 byte allocations and frees
+ * through std::allocator and mftrackingallocator, without and with call
+ * stack sampling at a production-like interval.
+ */
+MFBENCH(trackingallocator)
+{
+	std::vector<tracked_node*> live(1024);
+	alloc_free<std::allocator<tracked_node> >(b, "std_allocator", live);
+	alloc_free<mftrackingallocator<tracked_node> >(b, "tracking", live);
+	mftracking_set_sample_interval(512 * 1024);
+	alloc_free<mftrackingallocator<tracked_node> >(b, "tracking_sampled", live);
+	mftracking_set_sample_interval(0);
+}
@@ -0,0 +1,194 @@
+//
+// Copyright (c) 2014 Jakub Jabłoński
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+
+#include <cstdint>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "debugallocator.h"
+#include "mftrackingallocator.h"
+#include "gtest/gtest.h"
+
+struct tracked_a
+{
+    std::uint32_t x;
+};
+
+struct tracked_b
+{
+    char bytes[40];
+};
+
+struct tracked_c
+{
+    std::uint64_t x;
+};
+
+TEST(TrackingAllocatorTest, SizeClasses)
+{
+    EXPECT_EQ(0, mftracking_size_class(1));
+    EXPECT_EQ(0, mftracking_size_class(8));
+    EXPECT_EQ(1, mftracking_size_class(9));
+    EXPECT_EQ(1, mftracking_size_class(16));
+    EXPECT_EQ(6, mftracking_size_class(512));
+    EXPECT_EQ(7, mftracking_size_class(513));
+    EXPECT_EQ(mftracking_size_classes - 1, mftracking_size_class(std::size_t(1) << 40));
+    EXPECT_EQ(512, mftracking_size_class_limit(6));
+    EXPECT_EQ(0, mftracking_size_class_limit(mftracking_size_classes - 1));
+}
+
+TEST(TrackingAllocatorTest, Vector)
+{
+    std::string name = mftracking_type_name<tracked_a>();
+    EXPECT_EQ("tracked_a", name);
+    {
+        std::vector<tracked_a, mftrackingallocator<tracked_a> > v;
+        v.reserve(100);
+        v.resize(10);
+        
+        mftracking_snapshot s = mftracking_collect();
+        const mftracking_key_stats* a = s.find(name);
+        ASSERT_TRUE(a != 0);
+        EXPECT_EQ(1, a->allocs);
+        EXPECT_EQ(0, a->frees);
+        EXPECT_EQ(400, a->bytes_allocated);
+        EXPECT_EQ(400, a->live_bytes());
+        EXPECT_EQ(1, a->size_classes[mftracking_size_class(400)]);
+        EXPECT_GE(s.peak_bytes, s.live_bytes);
+    }
+    mftracking_snapshot s = mftracking_collect();
+    const mftracking_key_stats* a = s.find(name);
+    ASSERT_TRUE(a != 0);
+    EXPECT_EQ(1, a->frees);
+    EXPECT_EQ(0, a->live_bytes());
+}
+
+TEST(TrackingAllocatorTest, Threads)
+{
+    mftrackingallocator<tracked_b> alloc;
+    tracked_b* kept[4];
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t)
+    {
+        threads.push_back(std::thread([&alloc, &kept, t] {
+            for (int i = 0; i < 1000; ++i)
+            {
+                alloc.deallocate(alloc.allocate(1), 1);
+            }
+            kept[t] = alloc.allocate(2);
+        }));
+    }
+    for (std::size_t t = 0; t < threads.size(); ++t)
+    {
+        threads[t].join();
+    }
+    
+    mftracking_snapshot s = mftracking_collect();
+    const mftracking_key_stats* b = s.find(mftracking_type_name<tracked_b>());
+    ASSERT_TRUE(b != 0);
+    EXPECT_EQ(4 * 1001, b->allocs);
+    EXPECT_EQ(4 * 1000, b->frees);
+    EXPECT_EQ(4 * 80, b->live_bytes());
+    EXPECT_EQ(4 * 1000, b->size_classes[mftracking_size_class(40)]);
+    
+    // freed by another thread than the one that allocated
+    for (int t = 0; t < 4; ++t)
+    {
+        alloc.deallocate(kept[t], 2);
+    }
+    s = mftracking_collect();
+    EXPECT_EQ(0, s.find(mftracking_type_name<tracked_b>())->live_bytes());
+}
+
+struct tracked_d
+{
+    std::uint64_t x[3];
+};
+
+/** Frees its allocation when the thread's locals are destroyed. */
+struct late_free
+{
+    tracked_d* p;
+
+    ~late_free()
+    {
+        mftrackingallocator<tracked_d> alloc;
+        alloc.deallocate(p, 1);
+        alloc.deallocate(alloc.allocate(2), 2);
+    }
+};
+
+TEST(TrackingAllocatorTest, ThreadLocalTeardown)
+{
+    std::thread([] {
+        // Constructed before the thread's block, so destroyed after it.
+        static thread_local late_free late = { 0 };
+        late.p = mftrackingallocator<tracked_d>().allocate(1);
+    }).join();
+
+    mftracking_snapshot s = mftracking_collect();
+    const mftracking_key_stats* d = s.find(mftracking_type_name<tracked_d>());
+    ASSERT_TRUE(d != 0);
+    EXPECT_EQ(2, d->allocs);
+    EXPECT_EQ(2, d->frees);
+    EXPECT_EQ(72, d->bytes_freed);
+    EXPECT_EQ(0, d->live_bytes());
+}
+
+TEST(TrackingAllocatorTest, SampledSites)
+{
+    mftracking_set_sample_interval(1);
+    {
+        std::map<int, int, std::less<int>, mftrackingallocator<std::pair<const int, tracked_c> > > m;
+        std::vector<tracked_c, mftrackingallocator<tracked_c> > v(10);
+    }
+    mftracking_set_sample_interval(0);
+    
+    mftracking_snapshot s = mftracking_collect();
+    ASSERT_FALSE(s.sites.empty());
+    for (std::size_t i = 0; i < s.sites.size(); ++i)
+    {
+        EXPECT_LT(0, s.sites[i].samples);
+        EXPECT_GE(s.sites[i].estimated_bytes, s.sites[i].sampled_bytes);
+    }
+    
+    std::ostringstream report;
+    mftracking_report(report);
+    EXPECT_NE(std::string::npos, report.str().find("tracked_c")) << report.str();
+    EXPECT_NE(std::string::npos, report.str().find("sampled call sites")) << report.str();
+}
+
+TEST(TrackingAllocatorTest, DebugAllocator)
+{
+    {
+        std::vector<tracked_c, DebugAllocator<tracked_c> > v(3);
+    }
+    mftracking_snapshot s = mftracking_collect();
+    const mftracking_key_stats* c = s.find(mftracking_type_name<tracked_c>());
+    ASSERT_TRUE(c != 0);
+    EXPECT_LE(1, c->allocs);
+    EXPECT_EQ(c->allocs, c->frees);
+}
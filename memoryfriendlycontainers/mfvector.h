@@ -25,75 +25,373 @@
 
 #include <algorithm>
 #include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <memory>
 #include <type_traits>
+#include <utility>
 
 #include <ostream>
 
-#include "purify.h"
+#if defined(__unix__) || defined(__APPLE__)
+#define MFVECTOR_MAP_FILE 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#define MFVECTOR_MAP_FILE 0
+#endif
 
-template<typename T> class mfvector;
-template<typename T> std::ostream& operator<<(std::ostream&,
-                                              const mfvector<T>& v);
+#include "mffootprint.h"
+#include "purify.h"
 
+/**
+ * Tells whether objects of type T can be moved to a new address with a plain
+ * memcpy, leaving the source storage to be released without running the
+ * destructor. True for trivially copyable types; specialize it for own types
+ * that hold no pointers into themselves.
+ */
 template<typename T>
+struct mfis_trivially_relocatable : std::integral_constant<bool, std::is_trivially_copyable<T>::value>
+{};
+
+/**
+ * Growth policies deciding how far mfvector grows when push_back finds no
+ * free capacity. Called with the current capacity and the number of elements
+ * required; any result smaller than required means "do not grow".
+ */
+struct mfgrowth_never
+{
+	std::size_t operator()(std::size_t capacity, std::size_t) const
+	{
+		return capacity;
+	}
+};
+
+struct mfgrowth_geometric
+{
+	double factor;
+    
+	explicit mfgrowth_geometric(double factor = 2.0) : factor(factor)
+	{}
+    
+	std::size_t operator()(std::size_t capacity, std::size_t required) const
+	{
+		return std::max(required, (std::size_t) (capacity * factor));
+	}
+};
+
+struct mfgrowth_fixed
+{
+	std::size_t increment;
+    
+	explicit mfgrowth_fixed(std::size_t increment = 16) : increment(increment)
+	{}
+    
+	std::size_t operator()(std::size_t capacity, std::size_t required) const
+	{
+		return std::max(required, capacity + increment);
+	}
+};
+
+/**
+ * Raw storage for trivially relocatable elements. Buffers of at least
+ * mfvector_mremap_threshold bytes are mapped directly, so that growing them
+ * only moves page mappings (mremap) instead of copying the bytes.
+ */
+static const std::size_t mfvector_mremap_threshold = 1 << 20;
+
+inline void* mfvector_raw_allocate(std::size_t bytes)
+{
+#ifdef __linux__
+	if (bytes >= mfvector_mremap_threshold)
+	{
+		void* p = mmap(0, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		return p == MAP_FAILED ? 0 : p;
+	}
+#endif
+	return std::malloc(bytes);
+}
+
+inline void mfvector_raw_deallocate(void* p, std::size_t bytes)
+{
+#ifdef __linux__
+	if (bytes >= mfvector_mremap_threshold)
+	{
+		munmap(p, bytes);
+		return;
+	}
+#endif
+	std::free(p);
+}
+
+inline void* mfvector_raw_reallocate(void* p, std::size_t old_bytes, std::size_t new_bytes)
+{
+#ifdef __linux__
+	if (old_bytes >= mfvector_mremap_threshold || new_bytes >= mfvector_mremap_threshold)
+	{
+		if (old_bytes >= mfvector_mremap_threshold && new_bytes >= mfvector_mremap_threshold)
+		{
+			void* n = mremap(p, old_bytes, new_bytes, MREMAP_MAYMOVE);
+			return n == MAP_FAILED ? 0 : n;
+		}
+		// Exactly one side is mapped; the other, smaller one is what to copy.
+		void* n = mfvector_raw_allocate(new_bytes);
+		if (n)
+		{
+			std::memcpy(n, p, old_bytes < mfvector_mremap_threshold ? old_bytes : new_bytes);
+			mfvector_raw_deallocate(p, old_bytes);
+		}
+		return n;
+	}
+#endif
+	(void) old_bytes;
+	return std::realloc(p, new_bytes);
+}
+
+/** How mfvector::map_file opens its file. */
+enum mfvector_map_mode
+{
+	mfvector_map_read,  /**< read-only; the vector is full and can't grow */
+	mfvector_map_shared /**< read-write, changes go to the file; created if missing */
+};
+
+/**
+ * Start of a file used by mfvector::map_file. The elements follow it; it is
+ * a cache line long so they are as aligned as in memory.
+ */
+struct mfvector_file_header
+{
+	char magic[8];
+	std::uint64_t element_size;
+	std::uint64_t size;
+	std::uint64_t capacity;
+	char reserved[32];
+};
+
+static const char mfvector_file_magic[8] = { 'm', 'f', 'v', 'e', 'c', 't', 'o', 'r' };
+
+/** Open file mapping of a vector; header points at the start of the mapping. */
+struct mfvector_mapping
+{
+	int fd;
+	mfvector_map_mode mode;
+	mfvector_file_header* header;
+	std::size_t bytes;
+};
+
+#if MFVECTOR_MAP_FILE
+
+/**
+ * Opens path and maps its header and capacity elements (more if the file
+ * already has room for more). Returns 0 if the file can't be opened or
+ * holds elements of another size.
+ */
+inline mfvector_mapping* mfvector_map_open(const char* path, mfvector_map_mode mode, std::size_t element_size,
+                                           std::size_t capacity)
+{
+	int fd = open(path, mode == mfvector_map_read ? O_RDONLY : O_RDWR | O_CREAT, 0644);
+	if (fd < 0)
+	{
+		return 0;
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0)
+	{
+		close(fd);
+		return 0;
+	}
+	mfvector_file_header h;
+	std::memset(&h, 0, sizeof(h));
+	bool fresh = st.st_size == 0;
+	if (fresh)
+	{
+		std::memcpy(h.magic, mfvector_file_magic, sizeof(h.magic));
+		h.element_size = element_size;
+	}
+	if ((fresh && mode == mfvector_map_read)
+	    || (!fresh && (pread(fd, &h, sizeof(h), 0) != sizeof(h) || std::memcmp(h.magic, mfvector_file_magic, sizeof(h.magic))
+	                   || h.element_size != element_size || h.size > h.capacity
+	                   || std::uint64_t(st.st_size) < sizeof(h) + h.capacity * element_size)))
+	{
+		close(fd);
+		return 0;
+	}
+
+	std::size_t n = mode == mfvector_map_read ? h.capacity : std::max<std::size_t>(capacity, h.capacity);
+	std::size_t bytes = sizeof(h) + n * element_size;
+	if ((fresh || n > h.capacity) && ftruncate(fd, bytes) != 0)
+	{
+		close(fd);
+		return 0;
+	}
+	void* p = mmap(0, bytes, mode == mfvector_map_read ? PROT_READ : PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (p == MAP_FAILED)
+	{
+		close(fd);
+		return 0;
+	}
+	mfvector_mapping* m = new mfvector_mapping;
+	m->fd = fd;
+	m->mode = mode;
+	m->header = (mfvector_file_header*) p;
+	m->bytes = bytes;
+	if (fresh)
+	{
+		*m->header = h;
+	}
+	if (mode != mfvector_map_read)
+	{
+		m->header->capacity = n;
+	}
+	return m;
+}
+
+/** Resizes the file and its mapping to hold capacity elements. */
+inline bool mfvector_map_resize(mfvector_mapping* m, std::size_t capacity)
+{
+	if (m->mode == mfvector_map_read)
+	{
+		return false;
+	}
+	std::size_t bytes = sizeof(mfvector_file_header) + capacity * m->header->element_size;
+	if (bytes > m->bytes && ftruncate(m->fd, bytes) != 0)
+	{
+		return false;
+	}
+#ifdef __linux__
+	void* p = mremap(m->header, m->bytes, bytes, MREMAP_MAYMOVE);
+#else
+	munmap(m->header, m->bytes);
+	void* p = mmap(0, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, m->fd, 0);
+#endif
+	if (p == MAP_FAILED)
+	{
+		return false;
+	}
+	if (bytes < m->bytes)
+	{
+		// If this fails the file keeps its old length; the header has the capacity.
+		int r = ftruncate(m->fd, bytes);
+		(void) r;
+	}
+	m->header = (mfvector_file_header*) p;
+	m->bytes = bytes;
+	m->header->capacity = capacity;
+	return true;
+}
+
+inline bool mfvector_map_sync(mfvector_mapping* m, bool wait)
+{
+	return m->mode == mfvector_map_read || msync(m->header, m->bytes, wait ? MS_SYNC : MS_ASYNC) == 0;
+}
+
+inline void mfvector_map_close(mfvector_mapping* m)
+{
+	munmap(m->header, m->bytes);
+	close(m->fd);
+	delete m;
+}
+
+#else
+
+inline mfvector_mapping* mfvector_map_open(const char*, mfvector_map_mode, std::size_t, std::size_t)
+{
+	return 0;
+}
+
+inline bool mfvector_map_resize(mfvector_mapping*, std::size_t)
+{
+	return false;
+}
+
+inline bool mfvector_map_sync(mfvector_mapping*, bool)
+{
+	return false;
+}
+
+inline void mfvector_map_close(mfvector_mapping*)
+{}
+
+#endif
+
+template<typename T, typename G> class mfvector;
+template<typename T, typename G> std::ostream& operator<<(std::ostream&,
+                                                          const mfvector<T, G>& v);
+
+/**
+ * Vector with capacity fixed at construction. push_back on a full vector is
+ * a no-op unless a growth policy other than mfgrowth_never is given;
+ * reserve, resize and shrink_to_fit change the capacity regardless of it.
+ *
+ * A vector made by map_file keeps its elements in a memory-mapped file
+ * instead of on the heap.
+ */
+template<typename T, typename G = mfgrowth_never>
 class mfvector {
-	friend std::ostream& operator<<<T> (std::ostream& o, const mfvector<T>& v);
+	friend std::ostream& operator<<<T, G> (std::ostream& o, const mfvector<T, G>& v);
     
 	typedef typename std::aligned_storage<sizeof(T), std::alignment_of<T>::value>::type uninitialized_T;
+	typedef std::integral_constant<bool, mfis_trivially_relocatable<T>::value
+	                                     && std::alignment_of<T>::value <= std::alignment_of<std::max_align_t>::value> relocatable;
+	typedef std::integral_constant<bool, mfis_trivially_relocatable<T>::value> relocatable_bits;
 public:
-	explicit mfvector(size_t capacity = 0)
+	explicit mfvector(size_t capacity = 0, const G& growth = G()) : growth_fn(growth)
 	{
 		init(capacity);
 		start_watch();
-		std::cout << this << ": constructor" << std::endl;
+//		std::cout << this << ": constructor" << std::endl;
 	}
     
-	mfvector(const mfvector& org)
+	mfvector(const mfvector& org) : growth_fn(org.growth_fn)
 	{
+		map_ = 0;
 		if (&org != this) {
 			size_ = org.size_;
 			capacity_ = org.capacity_;
-			if (capacity_) {
-				data_ = (T*) (new uninitialized_T[capacity_]);
-				std::uninitialized_copy(org.data_, size_, data_);
+			data_ = allocate(capacity_);
+			if (data_) {
+				std::uninitialized_copy(org.data_, org.data_ + size_, data_);
 			} else {
-				data_ = 0;
+				// Out of memory, or org has no capacity: an empty copy, as reserve leaves it.
+				size_ = 0;
+				capacity_ = 0;
 			}
 			start_watch();
 		}
-		std::cout << this << ": copy constructor from " << (&org) << std::endl;
+//		std::cout << this << ": copy constructor from " << (&org) << std::endl;
 	}
     
-	mfvector(mfvector&& org)
+	mfvector(mfvector&& org) : growth_fn(org.growth_fn)
 	{
 		init();
-		swap_unwatched(org);
 		start_watch();
-		std::cout << this << ": move constructor from " << (&org) << std::endl;
+		swap(org);
+//		std::cout << this << ": move constructor from " << (&org) << std::endl;
 	}
     
 	mfvector& operator=(const mfvector& org)
 	{
-		stop_watch();
 		mfvector tmp(org);
-		swap_unwatched(tmp);
-		std::cout << this << ": copy assignment" << std::endl;
-		start_watch();
+		swap(tmp);
+//		std::cout << this << ": copy assignment" << std::endl;
 		return *this;
 	}
     
 	mfvector& operator=(mfvector&& org)
 	{
-		stop_watch();
-		swap_unwatched(org);
-		std::cout << this << ": move assignment from " << (&org) << std::endl;
-		start_watch();
+		swap(org);
+//		std::cout << this << ": move assignment from " << (&org) << std::endl;
 		return *this;
 	}
     
 	~mfvector()
 	{
-		std::cout << this << ": destructor" << std::endl;
+//		std::cout << this << ": destructor" << std::endl;
 		stop_watch();
 		destroy();
 	}
@@ -108,6 +406,140 @@ public:
 		return size_;
 	}
     
+	G& growth()
+	{
+		return growth_fn;
+	}
+
+	/** Bytes taken by the elements, the spare capacity and the allocation. */
+	mffootprint memory_footprint() const
+	{
+		mffootprint f;
+		f.elements = size_;
+		f.payload = size_ * sizeof(T);
+		f.unused = (capacity_ - size_) * sizeof(T);
+		f.header = sizeof(*this);
+		if (map_)
+		{
+			// The file header and, for a read-only mapping, the room past size.
+			f.add_mapped_block(map_->bytes);
+			f.allocator += map_->bytes - capacity_ * sizeof(T);
+			f.add_heap_block(sizeof(mfvector_mapping));
+		}
+		else if (relocatable::value && capacity_ * sizeof(T) >= mfvector_mremap_threshold)
+		{
+#ifdef __linux__
+			f.add_mapped_block(capacity_ * sizeof(T));
+#else
+			f.add_heap_block(capacity_ * sizeof(T));
+#endif
+		}
+		else
+		{
+			f.add_heap_block(capacity_ * sizeof(T));
+		}
+		return f;
+	}
+    
+	/**
+	 * Opens a vector stored in the file at path. The elements are used in
+	 * place, so opening takes the same time for any size, and the kernel
+	 * writes changes back. A read-only vector is full: push_back is a no-op
+	 * and writing to elements faults. In shared mode a missing file is
+	 * created, the file is extended to hold at least capacity elements, and
+	 * growing the vector grows the file. The size in the file header is
+	 * updated by sync() and when the vector is destroyed.
+	 *
+	 * Returns an empty vector, for which mapped() is false, if the file
+	 * can't be opened or was written for another element size.
+	 */
+	static mfvector map_file(const char* path, mfvector_map_mode mode, std::size_t capacity = 0, const G& growth = G())
+	{
+		static_assert(std::is_trivially_copyable<T>::value && relocatable::value,
+		              "map_file needs a trivially copyable T");
+		mfvector v(0, growth);
+		mfvector_mapping* m = mfvector_map_open(path, mode, sizeof(T), capacity);
+		if (m)
+		{
+			v.stop_watch();
+			v.map_ = m;
+			v.data_ = (T*) (m->header + 1);
+			v.size_ = m->header->size;
+			v.capacity_ = mode == mfvector_map_read ? v.size_ : m->header->capacity;
+			v.start_watch();
+		}
+		return v;
+	}
+    
+	bool mapped() const
+	{
+		return map_ != 0;
+	}
+    
+	/**
+	 * Writes size and capacity to the header of a mapped vector and flushes
+	 * it to the file; with wait false the write-back is only scheduled.
+	 */
+	bool sync(bool wait = true)
+	{
+		if (!map_)
+		{
+			return false;
+		}
+		if (map_->mode != mfvector_map_read)
+		{
+			map_->header->size = size_;
+		}
+		return mfvector_map_sync(map_, wait);
+	}
+    
+	/** Makes room for at least n elements, ignoring the growth policy. */
+	void reserve(std::size_t n)
+	{
+		if (n > capacity_)
+		{
+			stop_watch();
+			reallocate_unwatched(n);
+			start_watch();
+		}
+	}
+    
+	void resize(std::size_t n)
+	{
+		stop_watch();
+		if (resize_unwatched(n))
+		{
+			while (size_ < n)
+			{
+				new (&data_[size_++]) T();
+			}
+		}
+		start_watch();
+	}
+    
+	void resize(std::size_t n, const T& x)
+	{
+		stop_watch();
+		if (resize_unwatched(n))
+		{
+			while (size_ < n)
+			{
+				new (&data_[size_++]) T(x);
+			}
+		}
+		start_watch();
+	}
+    
+	void shrink_to_fit()
+	{
+		if (size_ < capacity_)
+		{
+			stop_watch();
+			reallocate_unwatched(size_);
+			start_watch();
+		}
+	}
+    
 	const T* begin() const
 	{
 		return data_;
@@ -130,26 +562,127 @@ public:
     
 	void push_back(const T& x)
 	{
-		std::cout << "mfvector::push_back(const T& x)\n";
+//		std::cout << "mfvector::push_back(const T& x)\n";
 		if (size_ < capacity_)
 		{
-			stop_watch();
-			std::cout << "mfvector::push_back(const T& x), adding at " << &data_[size_] << "-----------------------\n";
+			move_watch(size_ + 1);
 			new (&data_[size_++]) T(x);
-			start_watch();
+			return;
+		}
+		stop_watch();
+		const T* p = &x;
+		if (grow_unwatched(size_ + 1, p))
+		{
+//			std::cout << "mfvector::push_back(const T& x), adding at " << &data_[size_] << "-----------------------\n";
+			new (&data_[size_++]) T(*p);
 		}
+		start_watch();
 	}
     
 	void push_back(T&& x)
 	{
-		std::cout << "mfvector::push_back(T&& x)\n";
+//		std::cout << "mfvector::push_back(T&& x)\n";
 		if (size_ < capacity_)
 		{
-			stop_watch();
-			std::cout << "mfvector::push_back(T&& x), adding at " << &data_[size_] << "-----------------------\n";
+			move_watch(size_ + 1);
+			new (&data_[size_++]) T(std::move(x));
+			return;
+		}
+		stop_watch();
+		T* p = &x;
+		if (grow_unwatched(size_ + 1, p))
+		{
+//			std::cout << "mfvector::push_back(T&& x), adding at " << &data_[size_] << "-----------------------\n";
+			new (&data_[size_++]) T(std::move(*p));
+		}
+		start_watch();
+	}
+    
+	template<typename... Args>
+	void emplace_back(Args&&... args)
+	{
+		if (size_ < capacity_)
+		{
+			move_watch(size_ + 1);
+			new (&data_[size_++]) T(std::forward<Args>(args)...);
+			return;
+		}
+		stop_watch();
+		// Arguments may refer to elements moved by growing.
+		T x(std::forward<Args>(args)...);
+		T* p = &x;
+		if (grow_unwatched(size_ + 1, p))
+		{
 			new (&data_[size_++]) T(std::move(x));
+		}
+		start_watch();
+	}
+    
+	/**
+	 * Appends [first, last), which must not point into this vector, with one
+	 * capacity check. Elements that do not fit are dropped, as with
+	 * push_back. Returns the number of appended elements.
+	 */
+	template<typename ForwardIt>
+	std::size_t append(ForwardIt first, ForwardIt last)
+	{
+		std::size_t n = std::distance(first, last);
+		bool grow = size_ + n > capacity_;
+		if (grow)
+		{
+			stop_watch();
+			n = room_unwatched(n);
+		}
+		else
+		{
+			move_watch(size_ + n);
+		}
+		T* i = &data_[size_];
+		for (std::size_t k = n; k; --k, ++first, ++i)
+		{
+			new (i) T(*first);
+		}
+		size_ += n;
+		if (grow)
+		{
 			start_watch();
 		}
+		return n;
+	}
+    
+	/** Replaces the contents with n copies of x, as far as they fit. */
+	void assign(std::size_t n, const T& x)
+	{
+		stop_watch();
+		if (std::less_equal<const T*>()(data_, &x) && std::less<const T*>()(&x, end()))
+		{
+			// x is one of the elements cleared below.
+			T tmp(x);
+			clear_unwatched();
+			fill_unwatched(n, tmp);
+		}
+		else
+		{
+			clear_unwatched();
+			fill_unwatched(n, x);
+		}
+		start_watch();
+	}
+    
+	/**
+	 * Sets the size to n leaving new elements uninitialized, e.g. for
+	 * read()/recv() straight into the buffer. Grows like resize.
+	 */
+	void resize_uninitialized(std::size_t n)
+	{
+		static_assert(std::is_trivially_default_constructible<T>::value && std::is_trivially_destructible<T>::value,
+		              "resize_uninitialized requires a trivial element type");
+		stop_watch();
+		if (n <= capacity_ || reallocate_unwatched(n))
+		{
+			size_ = n;
+		}
+		start_watch();
 	}
     
 	T& operator[](size_t n)
@@ -162,7 +695,7 @@ public:
 		return data_[n];
 	}
     
-	void swap(mfvector<T>& v)
+	void swap(mfvector<T, G>& v)
 	{
 		stop_watch();
 		v.stop_watch();
@@ -186,22 +719,117 @@ public:
 	T* erase(T const* first, T const* last)
 	{
 		stop_watch();
-//		std::move(last, end(), first);
 		T* i = const_cast<T*>(first);
 		T* j = const_cast<T*>(last);
-		T* e = const_cast<T*>(end());
-		while (j != end())
+		std::size_t n = j - i;
+		if (n)
 		{
-//			*i++ = std::move(*j++);
+			erase_unwatched(i, j, relocatable_bits());
+			size_ -= n;
 		}
-		while (i != e)
+		start_watch();
+		return i;
+	}
+    
+	/**
+	 * Removes the element at position by moving the last element into its
+	 * place, so element order is not preserved.
+	 */
+	T* unordered_erase(T const* position)
+	{
+		stop_watch();
+		T* i = const_cast<T*>(position);
+		T* b = &data_[--size_];
+		if (i != b)
 		{
-			i->~T();
-			++i;
-			--size_;
+			unordered_erase_unwatched(i, b, relocatable_bits());
+		}
+		else
+		{
+			b->~T();
 		}
 		start_watch();
-		return const_cast<T*>(first);
+		return i;
+	}
+    
+	/**
+	 * Removes all elements satisfying pred in a single pass, keeping the
+	 * order of the remaining ones. Returns the number of removed elements.
+	 */
+	template<typename Pred>
+	std::size_t erase_if(Pred pred)
+	{
+		stop_watch();
+		std::size_t j = 0;
+		for (std::size_t i = 0; i < size_; ++i)
+		{
+			if (pred(const_cast<const T&>(data_[i])))
+			{
+				data_[i].~T();
+			}
+			else
+			{
+				if (i != j)
+				{
+					relocate_unwatched(&data_[j], &data_[i], relocatable_bits());
+				}
+				++j;
+			}
+		}
+		std::size_t n = size_ - j;
+		size_ = j;
+		start_watch();
+		return n;
+	}
+    
+	/**
+	 * Inserts before position. Returns end() if there is no room and the
+	 * growth policy does not allow growing.
+	 */
+	T* insert(T const* position, const T& x)
+	{
+		stop_watch();
+		const T* p = &x;
+		std::size_t ix = position - data_;
+		T* r = make_gap_unwatched(ix, 1, p) ? new (&data_[ix]) T(*p) : 0;
+		if (r)
+		{
+			++size_;
+		}
+		start_watch();
+		return r ? r : end();
+	}
+    
+	T* insert(T const* position, T&& x)
+	{
+		stop_watch();
+		T* p = &x;
+		std::size_t ix = position - data_;
+		T* r = make_gap_unwatched(ix, 1, p) ? new (&data_[ix]) T(std::move(*p)) : 0;
+		if (r)
+		{
+			++size_;
+		}
+		start_watch();
+		return r ? r : end();
+	}
+    
+	/** Inserts [first, last), which must not point into this vector. */
+	template<typename ForwardIt>
+	T* insert(T const* position, ForwardIt first, ForwardIt last)
+	{
+		stop_watch();
+		const T* p = 0;
+		std::size_t ix = position - data_;
+		std::size_t n = std::distance(first, last);
+		bool ok = make_gap_unwatched(ix, n, p);
+		if (ok)
+		{
+			std::uninitialized_copy(first, last, &data_[ix]);
+			size_ += n;
+		}
+		start_watch();
+		return ok ? &data_[ix] : end();
 	}
     
 public:
@@ -209,20 +837,258 @@ public:
 	std::size_t capacity_;
 	std::size_t size_;
 	int watch;
+	G growth_fn;
+	mfvector_mapping* map_;
     
-	void swap_unwatched(mfvector<T>& v)
+	void swap_unwatched(mfvector<T, G>& v)
 	{
 		std::swap(capacity_, v.capacity_);
 		std::swap(size_, v.size_);
 		std::swap(data_, v.data_);
 		std::swap(watch, v.watch);
+		std::swap(growth_fn, v.growth_fn);
+		std::swap(map_, v.map_);
+	}
+    
+	/**
+	 * Grows according to the policy so that required elements fit; p is
+	 * redirected if it pointed at an element that got moved.
+	 */
+	template<typename P>
+	bool grow_unwatched(std::size_t required, P*& p)
+	{
+		std::size_t n = growth_fn(capacity_, required);
+		if (n < required)
+		{
+			return false;
+		}
+		bool inside = std::less_equal<const T*>()(data_, p) && std::less<const T*>()(p, data_ + size_);
+		std::size_t ix = inside ? p - data_ : 0;
+		if (!reallocate_unwatched(n))
+		{
+			return false;
+		}
+		if (inside)
+		{
+			p = data_ + ix;
+		}
+		return true;
+	}
+    
+	/**
+	 * Grows according to the policy so that n more elements fit; returns how
+	 * many of them do.
+	 */
+	std::size_t room_unwatched(std::size_t n)
+	{
+		const T* p = 0;
+		if (size_ + n > capacity_)
+		{
+			grow_unwatched(size_ + n, p);
+		}
+		return std::min(n, capacity_ - size_);
+	}
+    
+	void fill_unwatched(std::size_t n, const T& x)
+	{
+		n = room_unwatched(n);
+		std::uninitialized_fill_n(&data_[size_], n, x);
+		size_ += n;
+	}
+    
+	bool resize_unwatched(std::size_t n)
+	{
+		if (n > capacity_ && !reallocate_unwatched(n))
+		{
+			return false;
+		}
+		while (size_ > n)
+		{
+			data_[--size_].~T();
+		}
+		return true;
+	}
+    
+	/** Moves *src to uninitialized dst, leaving src uninitialized. */
+	static void relocate_unwatched(T* dst, T* src, std::true_type)
+	{
+		std::memcpy((void*) dst, (const void*) src, sizeof(T));
+	}
+    
+	static void relocate_unwatched(T* dst, T* src, std::false_type)
+	{
+		new (dst) T(std::move(*src));
+		src->~T();
+	}
+    
+	void erase_unwatched(T* i, T* j, std::true_type)
+	{
+		for (T* k = i; k != j; ++k)
+		{
+			k->~T();
+		}
+		std::memmove((void*) i, (const void*) j, (end() - j) * sizeof(T));
+	}
+    
+	void erase_unwatched(T* i, T* j, std::false_type)
+	{
+		T* e = end();
+		i = std::move(j, e, i);
+		while (i != e)
+		{
+			i->~T();
+			++i;
+		}
+	}
+    
+	static void unordered_erase_unwatched(T* i, T* b, std::true_type)
+	{
+		i->~T();
+		relocate_unwatched(i, b, std::true_type());
+	}
+    
+	static void unordered_erase_unwatched(T* i, T* b, std::false_type)
+	{
+		*i = std::move(*b);
+		b->~T();
+	}
+    
+	/**
+	 * Opens an uninitialized gap of n elements at ix, growing if needed. p is
+	 * redirected if it pointed at an element that got moved.
+	 */
+	template<typename P>
+	bool make_gap_unwatched(std::size_t ix, std::size_t n, P*& p)
+	{
+		if (size_ + n > capacity_ && !grow_unwatched(size_ + n, p))
+		{
+			return false;
+		}
+		bool inside = std::less_equal<const T*>()(data_ + ix, p) && std::less<const T*>()(p, data_ + size_);
+		make_gap_unwatched(ix, n, relocatable_bits());
+		if (inside)
+		{
+			p += n;
+		}
+		return true;
+	}
+    
+	void make_gap_unwatched(std::size_t ix, std::size_t n, std::true_type)
+	{
+		std::memmove((void*) &data_[ix + n], (const void*) &data_[ix], (size_ - ix) * sizeof(T));
+	}
+    
+	void make_gap_unwatched(std::size_t ix, std::size_t n, std::false_type)
+	{
+		for (std::size_t i = size_; i-- > ix;)
+		{
+			if (i + n >= size_)
+			{
+				new (&data_[i + n]) T(std::move(data_[i]));
+			}
+			else
+			{
+				data_[i + n] = std::move(data_[i]);
+			}
+		}
+		for (std::size_t i = ix; i < ix + n && i < size_; ++i)
+		{
+			data_[i].~T();
+		}
+	}
+    
+	/** Moves the elements to a buffer for n elements (n >= size_). */
+	bool reallocate_unwatched(std::size_t n)
+	{
+		return reallocate_unwatched(n, relocatable());
+	}
+    
+	bool reallocate_unwatched(std::size_t n, std::true_type)
+	{
+		if (map_)
+		{
+			if (!mfvector_map_resize(map_, n))
+			{
+				return false;
+			}
+			data_ = (T*) (map_->header + 1);
+			capacity_ = n;
+			return true;
+		}
+		T* data = 0;
+		if (!capacity_)
+		{
+			data = allocate(n);
+		}
+		else if (!n)
+		{
+			deallocate(data_, capacity_);
+		}
+		else
+		{
+			data = (T*) mfvector_raw_reallocate(data_, capacity_ * sizeof(T), n * sizeof(T));
+		}
+		if (n && !data)
+		{
+			return false;
+		}
+		data_ = data;
+		capacity_ = n;
+		return true;
+	}
+    
+	bool reallocate_unwatched(std::size_t n, std::false_type)
+	{
+		T* data = allocate(n);
+		for (std::size_t i = 0; i < size_; ++i)
+		{
+			new (&data[i]) T(std::move_if_noexcept(data_[i]));
+			data_[i].~T();
+		}
+		deallocate(data_, capacity_);
+		data_ = data;
+		capacity_ = n;
+		return true;
+	}
+    
+	static T* allocate(std::size_t n)
+	{
+		return allocate(n, relocatable());
+	}
+    
+	static T* allocate(std::size_t n, std::true_type)
+	{
+		return n ? (T*) mfvector_raw_allocate(n * sizeof(T)) : 0;
+	}
+    
+	static T* allocate(std::size_t n, std::false_type)
+	{
+		return n ? (T*) (new uninitialized_T[n]) : 0;
+	}
+    
+	static void deallocate(T* p, std::size_t n)
+	{
+		deallocate(p, n, relocatable());
+	}
+    
+	static void deallocate(T* p, std::size_t n, std::true_type)
+	{
+		if (p)
+		{
+			mfvector_raw_deallocate(p, n * sizeof(T));
+		}
+	}
+    
+	static void deallocate(T* p, std::size_t, std::false_type)
+	{
+		delete[] ((uninitialized_T *) p);
 	}
     
 	void clear_unwatched()
 	{
-		while (size_--)
+		while (size_)
 		{
-			data_[size_].~T();
+			data_[--size_].~T();
 		}
 	}
     
@@ -245,34 +1111,51 @@ public:
 		}
 	}
     
+	/**
+	 * Shrinks or grows the watched tail to start after element n, before
+	 * elements up to n are touched; cheaper than stop_watch and start_watch.
+	 */
+	void move_watch(std::size_t n)
+	{
+		watch = purify_watch_move(watch, (char *) &data_[n], (capacity_ - n) * sizeof(T), (char *) "rw");
+	}
+    
 	void init(size_t capacity = 0)
 	{
 		capacity_ = capacity;
 		size_ = 0;
-		if (capacity)
-		{
-			data_ = (T*) (new uninitialized_T[capacity]);
-		}
-		else
+		watch = -1;
+		map_ = 0;
+		data_ = allocate(capacity);
+		if (!data_)
 		{
-			data_ = 0;
+			capacity_ = 0;
 		}
 	}
 	void destroy()
 	{
+		if (map_)
+		{
+			if (map_->mode != mfvector_map_read)
+			{
+				map_->header->size = size_;
+			}
+			mfvector_map_close(map_);
+			return;
+		}
 		clear_unwatched();
-		delete[] ((uninitialized_T *) data_);
+		deallocate(data_, capacity_);
 	}
 };
 
-template<typename T>
-void swap(mfvector<T>& a, mfvector<T>& b)
+template<typename T, typename G>
+void swap(mfvector<T, G>& a, mfvector<T, G>& b)
 {
 	a.swap(b);
 }
 
-template<typename T>
-std::ostream& operator<<(std::ostream& o, const mfvector<T>& v)
+template<typename T, typename G>
+std::ostream& operator<<(std::ostream& o, const mfvector<T, G>& v)
 {
 	o << std::dec << "mfvector at " << std::hex << (void *) &v << std::dec
     << "(size " << v.size_ << ", capacity " << v.capacity_ << ", data "
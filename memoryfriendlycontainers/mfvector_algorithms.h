@@ -0,0 +1,861 @@
+//
+// Copyright (c) 2014 Jakub Jabłoński
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef memoryfriendlycontainers_mfvector_algorithms_h
+#define memoryfriendlycontainers_mfvector_algorithms_h
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#include "mfvector.h"
+#include "mfsimd.h"
+
+/**
+ * Search and reduce algorithms over mfvector ranges (begin()/end()).
+ *
+ * Ranges of int32_t and float are processed with AVX2 or SSE2 kernels,
+ * chosen at runtime by mfsimd_level(); other element types, and machines
+ * without these instruction sets, use scalar loops. Results are the same as
+ * from the std algorithms, except that float sums are accumulated in a
+ * different order and NaNs are not supported by min/max.
+ */
+
+template<typename T>
+struct mfalgo_simd_type : std::false_type
+{};
+
+template<>
+struct mfalgo_simd_type<std::int32_t> : std::true_type
+{};
+
+template<>
+struct mfalgo_simd_type<float> : std::true_type
+{};
+
+/** Type the elements are summed up in. */
+template<typename T>
+struct mfsum_type
+{
+	typedef T type;
+};
+
+template<>
+struct mfsum_type<std::int32_t>
+{
+	typedef std::int64_t type;
+};
+
+/**
+ * Scalar kernels, used for any element type.
+ */
+template<typename T>
+struct mfalgo_scalar
+{
+	static const T* find(const T* first, const T* last, const T& value)
+	{
+		return std::find(first, last, value);
+	}
+
+	static std::size_t count(const T* first, const T* last, const T& value)
+	{
+		return std::count(first, last, value);
+	}
+
+	static T min(const T* first, const T* last)
+	{
+		return *std::min_element(first, last);
+	}
+
+	static T max(const T* first, const T* last)
+	{
+		return *std::max_element(first, last);
+	}
+
+	static typename mfsum_type<T>::type sum(const T* first, const T* last)
+	{
+		typename mfsum_type<T>::type s = typename mfsum_type<T>::type();
+		for (; first != last; ++first)
+		{
+			s += *first;
+		}
+		return s;
+	}
+
+	static std::size_t count_range(const T* first, const T* last, const T& lo, const T& hi)
+	{
+		std::size_t n = 0;
+		for (; first != last; ++first)
+		{
+			n += !(*first < lo) && !(hi < *first);
+		}
+		return n;
+	}
+
+	static T* filter_range(const T* first, const T* last, const T& lo, const T& hi, T* out)
+	{
+		for (; first != last; ++first)
+		{
+			if (!(*first < lo) && !(hi < *first))
+			{
+				*out++ = *first;
+			}
+		}
+		return out;
+	}
+};
+
+#if MFSIMD_X86
+
+/**
+ * Indices of the set bits of every 8-bit mask, one byte each, used to
+ * compress selected lanes to the front of an AVX2 register.
+ */
+struct mfalgo_compress_table
+{
+	std::uint64_t lanes[256];
+
+	mfalgo_compress_table()
+	{
+		for (unsigned m = 0; m < 256; ++m)
+		{
+			std::uint64_t l = 0;
+			for (unsigned i = 0, k = 0; i < 8; ++i)
+			{
+				if (m & (1u << i))
+				{
+					l |= (std::uint64_t) i << (8 * k++);
+				}
+			}
+			lanes[m] = l;
+		}
+	}
+
+	static const std::uint64_t* get()
+	{
+		static const mfalgo_compress_table table;
+		return table.lanes;
+	}
+};
+
+/**
+ * SSE2 kernels, four lanes per step.
+ */
+struct mfalgo_sse2
+{
+	static MFSIMD_SSE2 __m128i min_epi32(__m128i a, __m128i b)
+	{
+		__m128i gt = _mm_cmpgt_epi32(a, b);
+		return _mm_or_si128(_mm_and_si128(gt, b), _mm_andnot_si128(gt, a));
+	}
+
+	static MFSIMD_SSE2 __m128i max_epi32(__m128i a, __m128i b)
+	{
+		__m128i gt = _mm_cmpgt_epi32(a, b);
+		return _mm_or_si128(_mm_and_si128(gt, a), _mm_andnot_si128(gt, b));
+	}
+
+	/** Lanes equal to v set to all ones. */
+	static MFSIMD_SSE2 __m128i eq(const std::int32_t* p, __m128i v)
+	{
+		return _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*) p), v);
+	}
+
+	static MFSIMD_SSE2 __m128i eq(const float* p, __m128 v)
+	{
+		return _mm_castps_si128(_mm_cmpeq_ps(_mm_loadu_ps(p), v));
+	}
+
+	/** Lanes within [lo, hi] set to all ones. */
+	static MFSIMD_SSE2 __m128i in_range(const std::int32_t* p, __m128i lo, __m128i hi)
+	{
+		__m128i x = _mm_loadu_si128((const __m128i*) p);
+		__m128i out = _mm_or_si128(_mm_cmpgt_epi32(lo, x), _mm_cmpgt_epi32(x, hi));
+		return _mm_xor_si128(out, _mm_set1_epi32(-1));
+	}
+
+	static MFSIMD_SSE2 __m128i in_range(const float* p, __m128 lo, __m128 hi)
+	{
+		__m128 x = _mm_loadu_ps(p);
+		return _mm_castps_si128(_mm_and_ps(_mm_cmpge_ps(x, lo), _mm_cmple_ps(x, hi)));
+	}
+
+	static MFSIMD_SSE2 int mask(__m128i x)
+	{
+		return _mm_movemask_ps(_mm_castsi128_ps(x));
+	}
+
+	/** Sums the per-lane counters accumulated by subtracting masks. */
+	static MFSIMD_SSE2 std::size_t lane_count(__m128i n)
+	{
+		std::uint32_t l[4];
+		_mm_storeu_si128((__m128i*) l, n);
+		return (std::size_t) l[0] + l[1] + l[2] + l[3];
+	}
+
+	static MFSIMD_SSE2 __m128i set1(std::int32_t x)
+	{
+		return _mm_set1_epi32(x);
+	}
+
+	static MFSIMD_SSE2 __m128 set1(float x)
+	{
+		return _mm_set1_ps(x);
+	}
+
+	template<typename T>
+	static MFSIMD_SSE2 const T* find(const T* first, const T* last, T value)
+	{
+		auto v = set1(value);
+		for (; last - first >= 4; first += 4)
+		{
+			if (int m = mask(eq(first, v)))
+			{
+				return first + __builtin_ctz(m);
+			}
+		}
+		return std::find(first, last, value);
+	}
+
+	template<typename T>
+	static MFSIMD_SSE2 std::size_t count(const T* first, const T* last, T value)
+	{
+		auto v = set1(value);
+		__m128i n = _mm_setzero_si128();
+		for (; last - first >= 4; first += 4)
+		{
+			n = _mm_sub_epi32(n, eq(first, v));
+		}
+		return lane_count(n) + std::count(first, last, value);
+	}
+
+	static MFSIMD_SSE2 std::int32_t min(const std::int32_t* first, const std::int32_t* last)
+	{
+		std::int32_t r = *first;
+		if (last - first >= 4)
+		{
+			__m128i m = _mm_loadu_si128((const __m128i*) first);
+			for (first += 4; last - first >= 4; first += 4)
+			{
+				m = min_epi32(m, _mm_loadu_si128((const __m128i*) first));
+			}
+			std::int32_t l[4];
+			_mm_storeu_si128((__m128i*) l, m);
+			r = std::min(std::min(l[0], l[1]), std::min(l[2], l[3]));
+		}
+		for (; first != last; ++first)
+		{
+			r = std::min(r, *first);
+		}
+		return r;
+	}
+
+	static MFSIMD_SSE2 float min(const float* first, const float* last)
+	{
+		float r = *first;
+		if (last - first >= 4)
+		{
+			__m128 m = _mm_loadu_ps(first);
+			for (first += 4; last - first >= 4; first += 4)
+			{
+				m = _mm_min_ps(m, _mm_loadu_ps(first));
+			}
+			float l[4];
+			_mm_storeu_ps(l, m);
+			r = std::min(std::min(l[0], l[1]), std::min(l[2], l[3]));
+		}
+		for (; first != last; ++first)
+		{
+			r = std::min(r, *first);
+		}
+		return r;
+	}
+
+	static MFSIMD_SSE2 std::int32_t max(const std::int32_t* first, const std::int32_t* last)
+	{
+		std::int32_t r = *first;
+		if (last - first >= 4)
+		{
+			__m128i m = _mm_loadu_si128((const __m128i*) first);
+			for (first += 4; last - first >= 4; first += 4)
+			{
+				m = max_epi32(m, _mm_loadu_si128((const __m128i*) first));
+			}
+			std::int32_t l[4];
+			_mm_storeu_si128((__m128i*) l, m);
+			r = std::max(std::max(l[0], l[1]), std::max(l[2], l[3]));
+		}
+		for (; first != last; ++first)
+		{
+			r = std::max(r, *first);
+		}
+		return r;
+	}
+
+	static MFSIMD_SSE2 float max(const float* first, const float* last)
+	{
+		float r = *first;
+		if (last - first >= 4)
+		{
+			__m128 m = _mm_loadu_ps(first);
+			for (first += 4; last - first >= 4; first += 4)
+			{
+				m = _mm_max_ps(m, _mm_loadu_ps(first));
+			}
+			float l[4];
+			_mm_storeu_ps(l, m);
+			r = std::max(std::max(l[0], l[1]), std::max(l[2], l[3]));
+		}
+		for (; first != last; ++first)
+		{
+			r = std::max(r, *first);
+		}
+		return r;
+	}
+
+	static MFSIMD_SSE2 std::int64_t sum(const std::int32_t* first, const std::int32_t* last)
+	{
+		__m128i s = _mm_setzero_si128();
+		for (; last - first >= 4; first += 4)
+		{
+			__m128i x = _mm_loadu_si128((const __m128i*) first);
+			__m128i sign = _mm_srai_epi32(x, 31);
+			s = _mm_add_epi64(s, _mm_unpacklo_epi32(x, sign));
+			s = _mm_add_epi64(s, _mm_unpackhi_epi32(x, sign));
+		}
+		std::int64_t l[2];
+		_mm_storeu_si128((__m128i*) l, s);
+		return l[0] + l[1] + mfalgo_scalar<std::int32_t>::sum(first, last);
+	}
+
+	static MFSIMD_SSE2 float sum(const float* first, const float* last)
+	{
+		__m128 s = _mm_setzero_ps();
+		for (; last - first >= 4; first += 4)
+		{
+			s = _mm_add_ps(s, _mm_loadu_ps(first));
+		}
+		float l[4];
+		_mm_storeu_ps(l, s);
+		return (l[0] + l[1]) + (l[2] + l[3]) + mfalgo_scalar<float>::sum(first, last);
+	}
+
+	template<typename T>
+	static MFSIMD_SSE2 std::size_t count_range(const T* first, const T* last, T lo, T hi)
+	{
+		auto l = set1(lo);
+		auto h = set1(hi);
+		__m128i n = _mm_setzero_si128();
+		for (; last - first >= 4; first += 4)
+		{
+			n = _mm_sub_epi32(n, in_range(first, l, h));
+		}
+		return lane_count(n) + mfalgo_scalar<T>::count_range(first, last, lo, hi);
+	}
+
+	template<typename T>
+	static MFSIMD_SSE2 T* filter_range(const T* first, const T* last, T lo, T hi, T* out)
+	{
+		auto l = set1(lo);
+		auto h = set1(hi);
+		for (; last - first >= 4; first += 4)
+		{
+			for (int m = mask(in_range(first, l, h)); m; m &= m - 1)
+			{
+				*out++ = first[__builtin_ctz(m)];
+			}
+		}
+		return mfalgo_scalar<T>::filter_range(first, last, lo, hi, out);
+	}
+};
+
+/**
+ * AVX2 kernels, eight lanes per step.
+ */
+struct mfalgo_avx2
+{
+	static MFSIMD_AVX2 int eq_mask(const std::int32_t* p, __m256i v)
+	{
+		return _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i*) p), v)));
+	}
+
+	static MFSIMD_AVX2 int eq_mask(const float* p, __m256 v)
+	{
+		return _mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(p), v, _CMP_EQ_OQ));
+	}
+
+	static MFSIMD_AVX2 int range_mask(const std::int32_t* p, __m256i lo, __m256i hi)
+	{
+		__m256i x = _mm256_loadu_si256((const __m256i*) p);
+		__m256i out = _mm256_or_si256(_mm256_cmpgt_epi32(lo, x), _mm256_cmpgt_epi32(x, hi));
+		return ~_mm256_movemask_ps(_mm256_castsi256_ps(out)) & 0xff;
+	}
+
+	static MFSIMD_AVX2 int range_mask(const float* p, __m256 lo, __m256 hi)
+	{
+		__m256 x = _mm256_loadu_ps(p);
+		return _mm256_movemask_ps(_mm256_and_ps(_mm256_cmp_ps(x, lo, _CMP_GE_OQ), _mm256_cmp_ps(x, hi, _CMP_LE_OQ)));
+	}
+
+	static MFSIMD_AVX2 __m256i set1(std::int32_t x)
+	{
+		return _mm256_set1_epi32(x);
+	}
+
+	static MFSIMD_AVX2 __m256 set1(float x)
+	{
+		return _mm256_set1_ps(x);
+	}
+
+	static MFSIMD_AVX2 void compress_store(std::int32_t* out, const std::int32_t* p, __m256i perm)
+	{
+		_mm256_storeu_si256((__m256i*) out, _mm256_permutevar8x32_epi32(_mm256_loadu_si256((const __m256i*) p), perm));
+	}
+
+	static MFSIMD_AVX2 void compress_store(float* out, const float* p, __m256i perm)
+	{
+		_mm256_storeu_ps(out, _mm256_permutevar8x32_ps(_mm256_loadu_ps(p), perm));
+	}
+
+	template<typename T>
+	static MFSIMD_AVX2 const T* find(const T* first, const T* last, T value)
+	{
+		auto v = set1(value);
+		for (; last - first >= 8; first += 8)
+		{
+			if (int m = eq_mask(first, v))
+			{
+				return first + __builtin_ctz(m);
+			}
+		}
+		return std::find(first, last, value);
+	}
+
+	template<typename T>
+	static MFSIMD_AVX2 std::size_t count(const T* first, const T* last, T value)
+	{
+		auto v = set1(value);
+		std::size_t n = 0;
+		for (; last - first >= 8; first += 8)
+		{
+			n += __builtin_popcount(eq_mask(first, v));
+		}
+		return n + std::count(first, last, value);
+	}
+
+	static MFSIMD_AVX2 std::int32_t min(const std::int32_t* first, const std::int32_t* last)
+	{
+		std::int32_t r = *first;
+		if (last - first >= 8)
+		{
+			__m256i m = _mm256_loadu_si256((const __m256i*) first);
+			for (first += 8; last - first >= 8; first += 8)
+			{
+				m = _mm256_min_epi32(m, _mm256_loadu_si256((const __m256i*) first));
+			}
+			std::int32_t l[8];
+			_mm256_storeu_si256((__m256i*) l, m);
+			r = *std::min_element(l, l + 8);
+		}
+		for (; first != last; ++first)
+		{
+			r = std::min(r, *first);
+		}
+		return r;
+	}
+
+	static MFSIMD_AVX2 float min(const float* first, const float* last)
+	{
+		float r = *first;
+		if (last - first >= 8)
+		{
+			__m256 m = _mm256_loadu_ps(first);
+			for (first += 8; last - first >= 8; first += 8)
+			{
+				m = _mm256_min_ps(m, _mm256_loadu_ps(first));
+			}
+			float l[8];
+			_mm256_storeu_ps(l, m);
+			r = *std::min_element(l, l + 8);
+		}
+		for (; first != last; ++first)
+		{
+			r = std::min(r, *first);
+		}
+		return r;
+	}
+
+	static MFSIMD_AVX2 std::int32_t max(const std::int32_t* first, const std::int32_t* last)
+	{
+		std::int32_t r = *first;
+		if (last - first >= 8)
+		{
+			__m256i m = _mm256_loadu_si256((const __m256i*) first);
+			for (first += 8; last - first >= 8; first += 8)
+			{
+				m = _mm256_max_epi32(m, _mm256_loadu_si256((const __m256i*) first));
+			}
+			std::int32_t l[8];
+			_mm256_storeu_si256((__m256i*) l, m);
+			r = *std::max_element(l, l + 8);
+		}
+		for (; first != last; ++first)
+		{
+			r = std::max(r, *first);
+		}
+		return r;
+	}
+
+	static MFSIMD_AVX2 float max(const float* first, const float* last)
+	{
+		float r = *first;
+		if (last - first >= 8)
+		{
+			__m256 m = _mm256_loadu_ps(first);
+			for (first += 8; last - first >= 8; first += 8)
+			{
+				m = _mm256_max_ps(m, _mm256_loadu_ps(first));
+			}
+			float l[8];
+			_mm256_storeu_ps(l, m);
+			r = *std::max_element(l, l + 8);
+		}
+		for (; first != last; ++first)
+		{
+			r = std::max(r, *first);
+		}
+		return r;
+	}
+
+	static MFSIMD_AVX2 std::int64_t sum(const std::int32_t* first, const std::int32_t* last)
+	{
+		__m256i s = _mm256_setzero_si256();
+		for (; last - first >= 8; first += 8)
+		{
+			__m256i x = _mm256_loadu_si256((const __m256i*) first);
+			s = _mm256_add_epi64(s, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(x)));
+			s = _mm256_add_epi64(s, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(x, 1)));
+		}
+		std::int64_t l[4];
+		_mm256_storeu_si256((__m256i*) l, s);
+		return (l[0] + l[1]) + (l[2] + l[3]) + mfalgo_scalar<std::int32_t>::sum(first, last);
+	}
+
+	static MFSIMD_AVX2 float sum(const float* first, const float* last)
+	{
+		__m256 s = _mm256_setzero_ps();
+		for (; last - first >= 8; first += 8)
+		{
+			s = _mm256_add_ps(s, _mm256_loadu_ps(first));
+		}
+		float l[8];
+		_mm256_storeu_ps(l, s);
+		return ((l[0] + l[1]) + (l[2] + l[3])) + ((l[4] + l[5]) + (l[6] + l[7]))
+		       + mfalgo_scalar<float>::sum(first, last);
+	}
+
+	template<typename T>
+	static MFSIMD_AVX2 std::size_t count_range(const T* first, const T* last, T lo, T hi)
+	{
+		auto l = set1(lo);
+		auto h = set1(hi);
+		std::size_t n = 0;
+		for (; last - first >= 8; first += 8)
+		{
+			n += __builtin_popcount(range_mask(first, l, h));
+		}
+		return n + mfalgo_scalar<T>::count_range(first, last, lo, hi);
+	}
+
+	/**
+	 * Stores whole registers while at least 8 slots are left in the output,
+	 * as the compressed lanes are followed by garbage.
+	 */
+	template<typename T>
+	static MFSIMD_AVX2 T* filter_range(const T* first, const T* last, T lo, T hi, T* out, T* out_end)
+	{
+		const std::uint64_t* lanes = mfalgo_compress_table::get();
+		auto l = set1(lo);
+		auto h = set1(hi);
+		for (; last - first >= 8 && out_end - out >= 8; first += 8)
+		{
+			int m = range_mask(first, l, h);
+			__m256i perm = _mm256_cvtepu8_epi32(_mm_cvtsi64_si128((long long) lanes[m]));
+			compress_store(out, first, perm);
+			out += __builtin_popcount(m);
+		}
+		return mfalgo_scalar<T>::filter_range(first, last, lo, hi, out);
+	}
+};
+
+#endif
+
+template<typename T>
+const T* mffind(const T* first, const T* last, const T& value, std::false_type)
+{
+	return mfalgo_scalar<T>::find(first, last, value);
+}
+
+template<typename T>
+const T* mffind(const T* first, const T* last, const T& value, std::true_type)
+{
+#if MFSIMD_X86
+	switch (mfsimd_level())
+	{
+		case mfsimd_avx2:
+			return mfalgo_avx2::find(first, last, value);
+		case mfsimd_sse2:
+			return mfalgo_sse2::find(first, last, value);
+		default:
+			break;
+	}
+#endif
+	return mfalgo_scalar<T>::find(first, last, value);
+}
+
+/** Returns the first element equal to value, or last. */
+template<typename T>
+const T* mffind(const T* first, const T* last, const T& value)
+{
+	return mffind(first, last, value, mfalgo_simd_type<T>());
+}
+
+template<typename T>
+std::size_t mfcount(const T* first, const T* last, const T& value, std::false_type)
+{
+	return mfalgo_scalar<T>::count(first, last, value);
+}
+
+template<typename T>
+std::size_t mfcount(const T* first, const T* last, const T& value, std::true_type)
+{
+#if MFSIMD_X86
+	switch (mfsimd_level())
+	{
+		case mfsimd_avx2:
+			return mfalgo_avx2::count(first, last, value);
+		case mfsimd_sse2:
+			return mfalgo_sse2::count(first, last, value);
+		default:
+			break;
+	}
+#endif
+	return mfalgo_scalar<T>::count(first, last, value);
+}
+
+/** Returns the number of elements equal to value. */
+template<typename T>
+std::size_t mfcount(const T* first, const T* last, const T& value)
+{
+	return mfcount(first, last, value, mfalgo_simd_type<T>());
+}
+
+template<typename T>
+T mfmin(const T* first, const T* last, std::false_type)
+{
+	return mfalgo_scalar<T>::min(first, last);
+}
+
+template<typename T>
+T mfmin(const T* first, const T* last, std::true_type)
+{
+#if MFSIMD_X86
+	switch (mfsimd_level())
+	{
+		case mfsimd_avx2:
+			return mfalgo_avx2::min(first, last);
+		case mfsimd_sse2:
+			return mfalgo_sse2::min(first, last);
+		default:
+			break;
+	}
+#endif
+	return mfalgo_scalar<T>::min(first, last);
+}
+
+/** Returns the smallest element of a non-empty range. */
+template<typename T>
+T mfmin(const T* first, const T* last)
+{
+	return mfmin(first, last, mfalgo_simd_type<T>());
+}
+
+template<typename T>
+T mfmax(const T* first, const T* last, std::false_type)
+{
+	return mfalgo_scalar<T>::max(first, last);
+}
+
+template<typename T>
+T mfmax(const T* first, const T* last, std::true_type)
+{
+#if MFSIMD_X86
+	switch (mfsimd_level())
+	{
+		case mfsimd_avx2:
+			return mfalgo_avx2::max(first, last);
+		case mfsimd_sse2:
+			return mfalgo_sse2::max(first, last);
+		default:
+			break;
+	}
+#endif
+	return mfalgo_scalar<T>::max(first, last);
+}
+
+/** Returns the largest element of a non-empty range. */
+template<typename T>
+T mfmax(const T* first, const T* last)
+{
+	return mfmax(first, last, mfalgo_simd_type<T>());
+}
+
+/**
+ * Returns the first smallest element, or last for an empty range. The
+ * minimum is found first and then searched for, both vectorised.
+ */
+template<typename T>
+const T* mfmin_element(const T* first, const T* last)
+{
+	return first == last ? last : mffind(first, last, mfmin(first, last));
+}
+
+/** Returns the first largest element, or last for an empty range. */
+template<typename T>
+const T* mfmax_element(const T* first, const T* last)
+{
+	return first == last ? last : mffind(first, last, mfmax(first, last));
+}
+
+template<typename T>
+typename mfsum_type<T>::type mfsum(const T* first, const T* last, std::false_type)
+{
+	return mfalgo_scalar<T>::sum(first, last);
+}
+
+template<typename T>
+typename mfsum_type<T>::type mfsum(const T* first, const T* last, std::true_type)
+{
+#if MFSIMD_X86
+	switch (mfsimd_level())
+	{
+		case mfsimd_avx2:
+			return mfalgo_avx2::sum(first, last);
+		case mfsimd_sse2:
+			return mfalgo_sse2::sum(first, last);
+		default:
+			break;
+	}
+#endif
+	return mfalgo_scalar<T>::sum(first, last);
+}
+
+/** Returns the sum of the elements; int32_t is summed up in 64 bits. */
+template<typename T>
+typename mfsum_type<T>::type mfsum(const T* first, const T* last)
+{
+	return mfsum(first, last, mfalgo_simd_type<T>());
+}
+
+template<typename T>
+std::size_t mfcount_range(const T* first, const T* last, const T& lo, const T& hi, std::false_type)
+{
+	return mfalgo_scalar<T>::count_range(first, last, lo, hi);
+}
+
+template<typename T>
+std::size_t mfcount_range(const T* first, const T* last, const T& lo, const T& hi, std::true_type)
+{
+#if MFSIMD_X86
+	switch (mfsimd_level())
+	{
+		case mfsimd_avx2:
+			return mfalgo_avx2::count_range(first, last, lo, hi);
+		case mfsimd_sse2:
+			return mfalgo_sse2::count_range(first, last, lo, hi);
+		default:
+			break;
+	}
+#endif
+	return mfalgo_scalar<T>::count_range(first, last, lo, hi);
+}
+
+/** Returns the number of elements x with lo <= x <= hi. */
+template<typename T>
+std::size_t mfcount_range(const T* first, const T* last, const T& lo, const T& hi)
+{
+	return mfcount_range(first, last, lo, hi, mfalgo_simd_type<T>());
+}
+
+template<typename T>
+T* mffilter_range(const T* first, const T* last, const T& lo, const T& hi, T* out, T*, std::false_type)
+{
+	return mfalgo_scalar<T>::filter_range(first, last, lo, hi, out);
+}
+
+template<typename T>
+T* mffilter_range(const T* first, const T* last, const T& lo, const T& hi, T* out, T* out_end, std::true_type)
+{
+#if MFSIMD_X86
+	switch (mfsimd_level())
+	{
+		case mfsimd_avx2:
+			return mfalgo_avx2::filter_range(first, last, lo, hi, out, out_end);
+		case mfsimd_sse2:
+			return mfalgo_sse2::filter_range(first, last, lo, hi, out);
+		default:
+			break;
+	}
+#endif
+	(void) out_end;
+	return mfalgo_scalar<T>::filter_range(first, last, lo, hi, out);
+}
+
+template<typename T>
+void mfalgo_resize(mfvector<T>& v, std::size_t n, std::false_type)
+{
+	v.resize(n);
+}
+
+template<typename T>
+void mfalgo_resize(mfvector<T>& v, std::size_t n, std::true_type)
+{
+	v.resize_uninitialized(n);
+}
+
+/**
+ * Returns a new mfvector holding the elements x with lo <= x <= hi. The
+ * matches are counted first, so the result is allocated with the exact
+ * capacity at the price of reading the input twice.
+ */
+template<typename T>
+mfvector<T> mffilter_range(const T* first, const T* last, const T& lo, const T& hi)
+{
+	std::size_t n = mfcount_range(first, last, lo, hi);
+	mfvector<T> r(n);
+	mfalgo_resize(r, n, mfalgo_simd_type<T>());
+	mffilter_range(first, last, lo, hi, r.begin(), r.end(), mfalgo_simd_type<T>());
+	return r;
+}
+
+
+#endif
@@ -0,0 +1,101 @@
+//
+// Copyright (c) 2014 Jakub Jabłoński
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <numeric>
+#include <string>
+
+#include "mfbench.h"
+#include "mfvector_algorithms.h"
+
+static const char* level_names[] = { "scalar", "sse2", "avx2" };
+
+template<typename T>
+static void fill(mfvector<T>& v, std::size_t n)
+{
+	v.resize_uninitialized(n);
+	std::srand(1);
+	for (std::size_t i = 0; i < n; ++i)
+	{
+		v[i] = T(std::rand() % 100000);
+	}
+}
+
+/**
+ * Compares the std algorithms with the mf ones at each instruction set
+ * available, for a cache resident and a memory bound range.
+ */
+template<typename T>
+static void bench_algorithms(mfbench& b, const char* type)
+{
+	static const std::size_t sizes[] = { 4096, 1 << 24 };
+	for (std::size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s)
+	{
+		std::size_t n = sizes[s];
+		mfvector<T> v(n);
+		fill(v, n);
+		const T* first = v.begin();
+		const T* last = v.end();
+		const T missing = T(-1);
+		const T lo = T(1000);
+		const T hi = T(11000); // selects about 10%
+		std::size_t bytes = n * sizeof(T);
+		std::string suffix = std::string("/") + type + "/" + std::to_string(n);
+
+		b.run("std_find" + suffix, n, bytes, [&] { mfbench_keep(std::find(first, last, missing)); });
+		b.run("std_count" + suffix, n, bytes, [&] { mfbench_keep(std::count(first, last, lo)); });
+		b.run("std_min_element" + suffix, n, bytes, [&] { mfbench_keep(std::min_element(first, last)); });
+		b.run("std_accumulate" + suffix, n, bytes, [&] { mfbench_keep(std::accumulate(first, last, typename mfsum_type<T>::type())); });
+		b.run("std_copy_if" + suffix, n, bytes, [&] {
+			mfvector<T> r(n);
+			r.resize_uninitialized(n);
+			T* e = std::copy_if(first, last, r.begin(), [&](T x) { return x >= lo && x <= hi; });
+			mfbench_keep(e);
+		});
+
+		for (int l = mfsimd_scalar; l <= mfsimd_avx2; ++l)
+		{
+			if (mfsimd_set_level(mfsimd_level_t(l)) != l)
+			{
+				continue;
+			}
+			std::string level = std::string("_") + level_names[l] + suffix;
+			b.run("mffind" + level, n, bytes, [&] { mfbench_keep(mffind(first, last, missing)); });
+			b.run("mfcount" + level, n, bytes, [&] { mfbench_keep(mfcount(first, last, lo)); });
+			b.run("mfmin_element" + level, n, bytes, [&] { mfbench_keep(mfmin_element(first, last)); });
+			b.run("mfsum" + level, n, bytes, [&] { mfbench_keep(mfsum(first, last)); });
+			b.run("mffilter_range" + level, n, bytes, [&] { mfbench_keep(mffilter_range(first, last, lo, hi)); });
+		}
+		mfsimd_set_level(mfsimd_avx2);
+	}
+}
+
+MFBENCH(vector_algorithms_int32)
+{
+	bench_algorithms<std::int32_t>(b, "int32");
+}
+
+MFBENCH(vector_algorithms_float)
+{
+	bench_algorithms<float>(b, "float");
+}
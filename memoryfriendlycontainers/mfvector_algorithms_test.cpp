@@ -0,0 +1,118 @@
+//
+// Copyright (c) 2014 Jakub Jabłoński
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <numeric>
+
+#include "mfvector_algorithms.h"
+#include "object.h"
+#include "gtest/gtest.h"
+
+class VectorAlgorithmsTest : public ::testing::TestWithParam<mfsimd_level_t>
+{
+protected:
+    VectorAlgorithmsTest() : ints(1003), floats(1003)
+    {
+        std::srand(7);
+        for (int i = 0; i < 1003; ++i)
+        {
+            ints.push_back(std::rand() % 2000 - 1000);
+            floats.push_back((std::rand() % 2000 - 1000) / 8.0f);
+        }
+        mfsimd_set_level(GetParam());
+    }
+    
+    ~VectorAlgorithmsTest()
+    {
+        mfsimd_set_level(mfsimd_avx2);
+    }
+    
+    mfvector<std::int32_t> ints;
+    mfvector<float> floats;
+};
+
+TEST_P(VectorAlgorithmsTest, Find)
+{
+    for (std::size_t n = 0; n < 20; ++n)
+    {
+        EXPECT_EQ(std::find(ints.begin(), ints.begin() + n, ints[7]), mffind(ints.begin(), ints.begin() + n, ints[7]));
+        EXPECT_EQ(std::find(floats.begin() + n, floats.end(), floats[900]), mffind(floats.begin() + n, floats.end(), floats[900]));
+    }
+    EXPECT_EQ(ints.end(), mffind(ints.begin(), ints.end(), 5000));
+}
+
+TEST_P(VectorAlgorithmsTest, Count)
+{
+    EXPECT_EQ(std::count(ints.begin(), ints.end(), ints[3]), mfcount(ints.begin(), ints.end(), ints[3]));
+    EXPECT_EQ(std::count(floats.begin() + 1, floats.end(), floats[5]), mfcount(floats.begin() + 1, floats.end(), floats[5]));
+}
+
+TEST_P(VectorAlgorithmsTest, MinMax)
+{
+    for (std::size_t n = 1; n < 20; ++n)
+    {
+        EXPECT_EQ(*std::min_element(ints.begin(), ints.begin() + n), mfmin(ints.begin(), ints.begin() + n));
+        EXPECT_EQ(*std::max_element(ints.begin(), ints.begin() + n), mfmax(ints.begin(), ints.begin() + n));
+    }
+    EXPECT_EQ(std::min_element(ints.begin(), ints.end()), mfmin_element(ints.begin(), ints.end()));
+    EXPECT_EQ(std::max_element(ints.begin(), ints.end()), mfmax_element(ints.begin(), ints.end()));
+    EXPECT_EQ(std::min_element(floats.begin(), floats.end()), mfmin_element(floats.begin(), floats.end()));
+    EXPECT_EQ(std::max_element(floats.begin(), floats.end()), mfmax_element(floats.begin(), floats.end()));
+    EXPECT_EQ(ints.end(), mfmin_element(ints.end(), ints.end()));
+}
+
+TEST_P(VectorAlgorithmsTest, Sum)
+{
+    EXPECT_EQ(std::accumulate(ints.begin(), ints.end(), std::int64_t(0)), mfsum(ints.begin(), ints.end()));
+    // Values are multiples of 1/8, so the sum is exact in any order.
+    EXPECT_EQ(std::accumulate(floats.begin(), floats.end(), 0.0f), mfsum(floats.begin(), floats.end()));
+}
+
+TEST_P(VectorAlgorithmsTest, FilterRange)
+{
+    mfvector<std::int32_t> r = mffilter_range(ints.begin(), ints.end(), -100, 250);
+    std::size_t n = std::count_if(ints.begin(), ints.end(), [](std::int32_t x) { return x >= -100 && x <= 250; });
+    ASSERT_EQ(n, r.size());
+    EXPECT_EQ(n, r.capacity());
+    EXPECT_EQ(n, mfcount_range(ints.begin(), ints.end(), -100, 250));
+    for (const std::int32_t *i = ints.begin(), *j = r.begin(); i != ints.end(); ++i)
+    {
+        if (*i >= -100 && *i <= 250)
+        {
+            EXPECT_EQ(*i, *j++);
+        }
+    }
+
+    mfvector<float> f = mffilter_range(floats.begin(), floats.end(), 0.0f, 1000.0f);
+    EXPECT_EQ(std::size_t(std::count_if(floats.begin(), floats.end(), [](float x) { return x >= 0; })), f.size());
+}
+
+INSTANTIATE_TEST_CASE_P(Levels, VectorAlgorithmsTest, ::testing::Values(mfsimd_scalar, mfsimd_sse2, mfsimd_avx2));
+
+TEST(VectorAlgorithmsGenericTest, Object)
+{
+    object o[] = { object("b"), object("a"), object("c") };
+    EXPECT_EQ(o + 2, mffind(o, o + 3, object("c")));
+    EXPECT_EQ(1, mfcount(o, o + 3, object("a")));
+}
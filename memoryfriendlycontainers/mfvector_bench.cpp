@@ -0,0 +1,163 @@
+//
+// Copyright (c) 2014 Jakub Jabłoński
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#include <cstddef>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "mfbench.h"
+#include "mfvector.h"
+#include "object.h"
+
+/** Vector footprints: within L1, within L2, within the last level cache, far beyond it. */
+static const std::size_t vector_footprints[] = { 16 << 10, 256 << 10, 4 << 20, 64 << 20 };
+
+static std::size_t weight(int x)
+{
+	return std::size_t(x);
+}
+
+static std::size_t weight(const object& x)
+{
+	return x.name.size();
+}
+
+template<typename T>
+T make_element(std::size_t i);
+
+template<>
+int make_element<int>(std::size_t i)
+{
+	return int(i);
+}
+
+template<>
+object make_element<object>(std::size_t)
+{
+	return object();
+}
+
+template<typename V>
+static std::size_t sum_all(const V& v)
+{
+	std::size_t sum = 0;
+	for (auto i = v.begin(); i != v.end(); ++i)
+	{
+		sum += weight(*i);
+	}
+	return sum;
+}
+
+/**
+ * mfvector against std::vector: filling with and without a preallocated
+ * capacity, a sequential scan and random reads, for footprints from L1 to
+ * main memory.
+ */
+template<typename T>
+static void vector_suite(mfbench& b)
+{
+	static const std::size_t queries = 1 << 16;
+	for (std::size_t f = 0; f < sizeof(vector_footprints) / sizeof(vector_footprints[0]); ++f)
+	{
+		std::size_t bytes = vector_footprints[f];
+		std::size_t n = bytes / sizeof(T);
+		std::vector<T> src;
+		for (std::size_t i = 0; i < n; ++i)
+		{
+			src.push_back(make_element<T>(i));
+		}
+		std::vector<std::size_t> positions(queries);
+		std::srand(1);
+		for (std::size_t q = 0; q < queries; ++q)
+		{
+			positions[q] = (std::size_t(std::rand()) << 15 ^ std::rand()) % n;
+		}
+		std::string suffix = "/" + std::to_string(n);
+
+		b.run("std_vector/push_back_reserved" + suffix, n, bytes, [&] {
+			std::vector<T> v;
+			v.reserve(n);
+			for (std::size_t i = 0; i < n; ++i)
+			{
+				v.push_back(src[i]);
+			}
+			mfbench_keep(v.size());
+		});
+		b.run("mfvector/push_back_reserved" + suffix, n, bytes, [&] {
+			mfvector<T> v(n);
+			for (std::size_t i = 0; i < n; ++i)
+			{
+				v.push_back(src[i]);
+			}
+			mfbench_keep(v.size());
+		});
+		b.run("std_vector/push_back_grow" + suffix, n, bytes, [&] {
+			std::vector<T> v;
+			for (std::size_t i = 0; i < n; ++i)
+			{
+				v.push_back(src[i]);
+			}
+			mfbench_keep(v.size());
+		});
+		b.run("mfvector/push_back_grow" + suffix, n, bytes, [&] {
+			mfvector<T, mfgrowth_geometric> v;
+			for (std::size_t i = 0; i < n; ++i)
+			{
+				v.push_back(src[i]);
+			}
+			mfbench_keep(v.size());
+		});
+
+		const std::vector<T>& sv = src;
+		mfvector<T> mv(n);
+		mv.append(src.begin(), src.end());
+		b.run("std_vector/scan" + suffix, n, bytes, [&] { mfbench_keep(sum_all(sv)); });
+		b.run("mfvector/scan" + suffix, n, bytes, [&] { mfbench_keep(sum_all(mv)); });
+		b.run("std_vector/random_read" + suffix, queries, 0, [&] {
+			std::size_t sum = 0;
+			for (std::size_t q = 0; q < queries; ++q)
+			{
+				sum += weight(sv[positions[q]]);
+			}
+			mfbench_keep(sum);
+		});
+		b.run("mfvector/random_read" + suffix, queries, 0, [&] {
+			std::size_t sum = 0;
+			for (std::size_t q = 0; q < queries; ++q)
+			{
+				sum += weight(mv[positions[q]]);
+			}
+			mfbench_keep(sum);
+		});
+	}
+}
+
+MFBENCH(vector_int)
+{
+	vector_suite<int>(b);
+}
+
+MFBENCH(vector_object)
+{
+	vector_suite<object>(b);
+}
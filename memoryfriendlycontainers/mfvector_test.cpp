@@ -20,6 +20,8 @@
 // THE SOFTWARE.
 
 #include <cassert>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <iterator>
 #include <ostream>
@@ -91,3 +93,339 @@ TEST_F(VectorTest, Erase)
     EXPECT_EQ(r, v10.begin());
 }
 
+
+TEST_F(VectorTest, Reserve)
+{
+	v1.push_back(object("a"));
+	v1.reserve(8);
+    EXPECT_EQ(1, v1.size());
+    EXPECT_EQ(8, v1.capacity());
+    EXPECT_EQ(object("a"), v1[0]);
+
+	v1.reserve(4);
+    EXPECT_EQ(8, v1.capacity());
+}
+
+TEST_F(VectorTest, Resize)
+{
+	v1.resize(3, object("x"));
+    EXPECT_EQ(3, v1.size());
+    EXPECT_EQ(3, v1.capacity());
+    EXPECT_EQ(object("x"), v1[2]);
+
+	v1.resize(1);
+    EXPECT_EQ(1, v1.size());
+    EXPECT_EQ(3, v1.capacity());
+
+	v1.shrink_to_fit();
+    EXPECT_EQ(1, v1.size());
+    EXPECT_EQ(1, v1.capacity());
+    EXPECT_EQ(object("x"), v1[0]);
+
+	v1.resize(0);
+	v1.shrink_to_fit();
+    EXPECT_EQ(0, v1.capacity());
+	EXPECT_EQ(v1.begin(), v1.end());
+}
+
+TEST(VectorGrowthTest, Geometric)
+{
+	mfvector<object, mfgrowth_geometric> v(2, mfgrowth_geometric(1.5));
+	v.push_back(object("a"));
+	v.push_back(object("b"));
+	v.push_back(object("c"));
+    EXPECT_EQ(3, v.size());
+    EXPECT_EQ(3, v.capacity());
+
+	v.push_back(v[0]);
+    EXPECT_EQ(4, v.size());
+    EXPECT_EQ(4, v.capacity());
+    EXPECT_EQ(object("a"), v[3]);
+    EXPECT_EQ(object("c"), v[2]);
+}
+
+TEST(VectorGrowthTest, Fixed)
+{
+	mfvector<object, mfgrowth_fixed> v(0, mfgrowth_fixed(4));
+	for (int i = 0; i < 5; ++i)
+	{
+		v.push_back(object("a"));
+	}
+    EXPECT_EQ(5, v.size());
+    EXPECT_EQ(8, v.capacity());
+}
+
+TEST(VectorGrowthTest, Relocatable)
+{
+	mfvector<int, mfgrowth_geometric> v;
+	for (int i = 0; i < 1000000; ++i)
+	{
+		v.push_back(i);
+	}
+    ASSERT_EQ(1000000, v.size());
+    EXPECT_LE(1000000, v.capacity());
+    EXPECT_EQ(0, v[0]);
+    EXPECT_EQ(999999, v[999999]);
+
+	v.shrink_to_fit();
+    EXPECT_EQ(1000000, v.capacity());
+    EXPECT_EQ(123456, v[123456]);
+}
+
+TEST_F(VectorTest, EraseRange)
+{
+	v10.push_back(object("a"));
+	v10.push_back(object("b"));
+	v10.push_back(object("c"));
+	v10.push_back(object("d"));
+
+    object* r = v10.erase(v10.begin() + 1, v10.begin() + 3);
+    EXPECT_EQ(r, v10.begin() + 1);
+    ASSERT_EQ(2, v10.size());
+    EXPECT_EQ(object("a"), v10[0]);
+    EXPECT_EQ(object("d"), v10[1]);
+
+	v10.erase(v10.begin());
+    ASSERT_EQ(1, v10.size());
+    EXPECT_EQ(object("d"), v10[0]);
+}
+
+TEST_F(VectorTest, Insert)
+{
+	v10.push_back(object("a"));
+	v10.push_back(object("c"));
+
+    object* r = v10.insert(v10.begin() + 1, object("b"));
+    EXPECT_EQ(r, v10.begin() + 1);
+	v10.insert(v10.begin(), v10[2]);
+    ASSERT_EQ(4, v10.size());
+    EXPECT_EQ(object("c"), v10[0]);
+    EXPECT_EQ(object("a"), v10[1]);
+    EXPECT_EQ(object("b"), v10[2]);
+    EXPECT_EQ(object("c"), v10[3]);
+
+    object more[] = { object("x"), object("y") };
+	v10.insert(v10.end() - 1, more, more + 2);
+    ASSERT_EQ(6, v10.size());
+    EXPECT_EQ(object("x"), v10[3]);
+    EXPECT_EQ(object("y"), v10[4]);
+    EXPECT_EQ(object("c"), v10[5]);
+
+	v1.push_back(object("a"));
+    EXPECT_EQ(v1.end(), v1.insert(v1.begin(), object("b")));
+    EXPECT_EQ(1, v1.size());
+}
+
+TEST_F(VectorTest, UnorderedErase)
+{
+	v10.push_back(object("a"));
+	v10.push_back(object("b"));
+	v10.push_back(object("c"));
+
+	v10.unordered_erase(v10.begin());
+    ASSERT_EQ(2, v10.size());
+    EXPECT_EQ(object("c"), v10[0]);
+    EXPECT_EQ(object("b"), v10[1]);
+
+	v10.unordered_erase(v10.begin() + 1);
+    ASSERT_EQ(1, v10.size());
+    EXPECT_EQ(object("c"), v10[0]);
+}
+
+TEST_F(VectorTest, EraseIf)
+{
+	v10.push_back(object("a"));
+	v10.push_back(object("b"));
+	v10.push_back(object("a"));
+	v10.push_back(object("c"));
+
+    std::size_t n = v10.erase_if([](const object& o) { return o.name == "a"; });
+    EXPECT_EQ(2, n);
+    ASSERT_EQ(2, v10.size());
+    EXPECT_EQ(object("b"), v10[0]);
+    EXPECT_EQ(object("c"), v10[1]);
+}
+
+TEST(VectorRelocatableTest, EraseInsert)
+{
+	mfvector<int> v(10);
+	for (int i = 0; i < 8; ++i)
+	{
+		v.push_back(i);
+	}
+
+	v.erase(v.begin() + 2, v.begin() + 5);
+    ASSERT_EQ(5, v.size());
+    EXPECT_EQ(5, v[2]);
+    EXPECT_EQ(7, v[4]);
+
+	v.insert(v.begin() + 1, 42);
+    ASSERT_EQ(6, v.size());
+    EXPECT_EQ(42, v[1]);
+    EXPECT_EQ(1, v[2]);
+
+    std::size_t n = v.erase_if([](int x) { return x % 2 == 1; });
+    EXPECT_EQ(3, n);
+    ASSERT_EQ(3, v.size());
+    EXPECT_EQ(0, v[0]);
+    EXPECT_EQ(42, v[1]);
+    EXPECT_EQ(6, v[2]);
+
+	v.unordered_erase(v.begin());
+    ASSERT_EQ(2, v.size());
+    EXPECT_EQ(6, v[0]);
+    EXPECT_EQ(42, v[1]);
+}
+
+TEST_F(VectorTest, EmplaceBack)
+{
+	v1.emplace_back("a");
+	v1.emplace_back("b");
+    ASSERT_EQ(1, v1.size());
+    EXPECT_EQ(object("a"), v1[0]);
+
+	mfvector<object, mfgrowth_geometric> v;
+	v.emplace_back("a");
+	v.emplace_back(v[0]);
+    ASSERT_EQ(2, v.size());
+    EXPECT_EQ(object("a"), v[1]);
+}
+
+TEST_F(VectorTest, Append)
+{
+    object more[] = { object("x"), object("y"), object("z") };
+    std::size_t n = v10.append(more, more + 3);
+    EXPECT_EQ(3, n);
+    ASSERT_EQ(3, v10.size());
+    EXPECT_EQ(object("z"), v10[2]);
+
+    n = v1.append(more, more + 3);
+    EXPECT_EQ(1, n);
+    ASSERT_EQ(1, v1.size());
+    EXPECT_EQ(object("x"), v1[0]);
+}
+
+TEST_F(VectorTest, Assign)
+{
+	v10.push_back(object("a"));
+	v10.assign(4, object("b"));
+    ASSERT_EQ(4, v10.size());
+    EXPECT_EQ(object("b"), v10[3]);
+
+	v10.assign(2, v10[1]);
+    ASSERT_EQ(2, v10.size());
+    EXPECT_EQ(object("b"), v10[0]);
+
+	v1.assign(3, object("c"));
+    EXPECT_EQ(1, v1.size());
+}
+
+TEST(VectorRelocatableTest, ResizeUninitialized)
+{
+	mfvector<char> v(4);
+	v.resize_uninitialized(16);
+    ASSERT_EQ(16, v.size());
+    EXPECT_EQ(16, v.capacity());
+	std::memset(v.begin(), 'x', v.size());
+	v.resize_uninitialized(2);
+    EXPECT_EQ(2, v.size());
+    EXPECT_EQ('x', v[1]);
+}
+
+class VectorMappedTest : public ::testing::Test
+{
+protected:
+    struct record
+    {
+        int id;
+        double value;
+    };
+    
+    VectorMappedTest()
+    {
+        std::strcpy(path, "/tmp/mfvector_test_XXXXXX");
+        close(mkstemp(path));
+    }
+    
+    ~VectorMappedTest()
+    {
+        unlink(path);
+    }
+    
+    char path[32];
+};
+
+TEST_F(VectorMappedTest, CreateAndReopen)
+{
+    {
+        mfvector<record> v = mfvector<record>::map_file(path, mfvector_map_shared, 4);
+        ASSERT_TRUE(v.mapped());
+        EXPECT_EQ(0, v.size());
+        EXPECT_EQ(4, v.capacity());
+		for (int i = 0; i < 5; ++i)
+		{
+			record r = { i, i * 0.5 };
+			v.push_back(r);
+		}
+        EXPECT_EQ(4, v.size());
+    }
+    {
+        mfvector<record> v = mfvector<record>::map_file(path, mfvector_map_read);
+        ASSERT_TRUE(v.mapped());
+        ASSERT_EQ(4, v.size());
+        EXPECT_EQ(4, v.capacity());
+        EXPECT_EQ(3, v[3].id);
+        EXPECT_EQ(1.5, v[3].value);
+        
+        record r = { 9, 9 };
+        v.push_back(r);
+        EXPECT_EQ(4, v.size());
+        
+        mfvector<record> copy(v);
+        EXPECT_FALSE(copy.mapped());
+        copy[0].id = 7;
+        EXPECT_EQ(0, v[0].id);
+    }
+}
+
+TEST_F(VectorMappedTest, Grow)
+{
+    {
+        mfvector<record, mfgrowth_geometric> v = mfvector<record, mfgrowth_geometric>::map_file(path, mfvector_map_shared, 2);
+		for (int i = 0; i < 100000; ++i)
+		{
+			record r = { i, 0 };
+			v.push_back(r);
+		}
+        ASSERT_EQ(100000, v.size());
+        EXPECT_TRUE(v.sync());
+        
+        mfvector<record> w = mfvector<record>::map_file(path, mfvector_map_read);
+        ASSERT_EQ(100000, w.size());
+        EXPECT_EQ(99999, w[99999].id);
+        
+        v.resize(10);
+        v.shrink_to_fit();
+        EXPECT_EQ(10, v.capacity());
+    }
+    {
+        mfvector<record> v = mfvector<record>::map_file(path, mfvector_map_shared, 20);
+        EXPECT_EQ(10, v.size());
+        EXPECT_EQ(20, v.capacity());
+        v.reserve(30);
+        EXPECT_EQ(30, v.capacity());
+        EXPECT_EQ(9, v[9].id);
+    }
+}
+
+TEST_F(VectorMappedTest, Invalid)
+{
+    mfvector<record> v = mfvector<record>::map_file(path, mfvector_map_read);
+    EXPECT_FALSE(v.mapped());
+    EXPECT_EQ(0, v.capacity());
+    EXPECT_FALSE(v.sync());
+    
+    mfvector<int>::map_file(path, mfvector_map_shared, 10);
+    EXPECT_FALSE(mfvector<record>::map_file(path, mfvector_map_shared).mapped());
+    EXPECT_FALSE(mfvector<int>::map_file("/nonexistent/dir/file", mfvector_map_shared).mapped());
+}
@@ -44,7 +44,7 @@ struct object
 		name = org.name;
 //		std::cout << (*this) << ": copy constructor from " << org << std::endl;
 	}
-	object(object&& org)
+	object(object&& org) noexcept
 	{
 		init();
 		swap(org);
@@ -58,7 +58,7 @@ struct object
 //		std::cout << (*this) << ": copy assignment operator from " << org << std::endl;
 		return *this;
 	}
-	object& operator=(object&& org)
+	object& operator=(object&& org) noexcept
 	{
 		swap(org);
 //		std::cout << (*this) << ": move assignment operator from " << org << std::endl;
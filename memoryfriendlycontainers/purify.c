@@ -19,13 +19,385 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 // THE SOFTWARE.
 
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
 #include "purify.h"
 
-int purify_watch_n(char *a, size_t b, char *c)
+#include <string.h>
+
+#if defined(__linux__)
+
+#include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+/*
+ * Watches live in a fixed table, indexed by the watch number; free slots
+ * are chained through next. Only the whole pages [lo, hi) inside a region
+ * are protected, so a watch never touches memory its owner does not own.
+ *
+ * The SIGSEGV handler reads addr, n, lo and hi on whichever thread faults,
+ * and the owner of a watch updates addr and n without the lock, so those
+ * fields, purify_used and purify_current are only accessed with __atomic
+ * builtins. The rest is guarded by purify_lock.
+ */
+#define PURIFY_MAX_WATCHES 16384
+
+struct purify_watch
+{
+    char *addr;
+    size_t n;
+    char *lo;
+    char *hi;
+    int prot;
+    int next;
+};
+
+static struct purify_watch purify_watches[PURIFY_MAX_WATCHES];
+static int purify_free = -1;
+static int purify_used = 0;
+static size_t purify_page;
+static enum purify_mode purify_current = purify_off;
+static struct purify_stats purify_counts;
+static pthread_mutex_t purify_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t purify_once = PTHREAD_ONCE_INIT;
+static struct sigaction purify_old_segv;
+static int purify_handler_installed = 0;
+
+static char *purify_append(char *p, const char *s)
+{
+    while (*s)
+    {
+        *p++ = *s++;
+    }
+    return p;
+}
+
+static char *purify_append_number(char *p, uintptr_t x, unsigned base)
+{
+    char digits[2 * sizeof(x) + 1];
+    int k = 0;
+    do
+    {
+        digits[k++] = "0123456789abcdef"[x % base];
+        x /= base;
+    } while (x);
+    if (base == 16)
+    {
+        p = purify_append(p, "0x");
+    }
+    while (k)
+    {
+        *p++ = digits[--k];
+    }
+    return p;
+}
+
+/* Reports an access to a watched region, then lets it fault again without us. */
+static void purify_segv(int sig, siginfo_t *info, void *context)
+{
+    char *a = (char *) info->si_addr;
+    int i;
+    (void) sig;
+    (void) context;
+    int used = __atomic_load_n(&purify_used, __ATOMIC_ACQUIRE);
+    for (i = 0; i < used; ++i)
+    {
+        struct purify_watch *w = &purify_watches[i];
+        char *addr = __atomic_load_n(&w->addr, __ATOMIC_RELAXED);
+        if (addr && a >= __atomic_load_n(&w->lo, __ATOMIC_RELAXED) && a < __atomic_load_n(&w->hi, __ATOMIC_RELAXED))
+        {
+            char message[256];
+            char *p = purify_append(message, "purify: access to ");
+            p = purify_append_number(p, (uintptr_t) a, 16);
+            p = purify_append(p, ", ");
+            p = purify_append_number(p, (uintptr_t) (a - addr), 10);
+            p = purify_append(p, " bytes into watched region ");
+            p = purify_append_number(p, (uintptr_t) addr, 16);
+            p = purify_append(p, " of ");
+            p = purify_append_number(p, __atomic_load_n(&w->n, __ATOMIC_RELAXED), 10);
+            p = purify_append(p, " bytes (watch ");
+            p = purify_append_number(p, (uintptr_t) i, 10);
+            p = purify_append(p, ")\n");
+            ssize_t written = write(2, message, p - message);
+            (void) written;
+            break;
+        }
+    }
+    sigaction(SIGSEGV, &purify_old_segv, 0);
+}
+
+static void purify_init(void)
+{
+    const char *mode = getenv("PURIFY_MODE");
+    if (mode && strcmp(mode, "exact") == 0)
+    {
+        __atomic_store_n(&purify_current, purify_exact, __ATOMIC_RELAXED);
+    }
+    else if (mode && strcmp(mode, "amortised") == 0)
+    {
+        __atomic_store_n(&purify_current, purify_amortised, __ATOMIC_RELAXED);
+    }
+    __atomic_store_n(&purify_page, (size_t) sysconf(_SC_PAGESIZE), __ATOMIC_RELEASE);
+}
+
+/* Reads the mode once; later calls only check a flag, so a disabled purify costs a load. */
+static void purify_start(void)
+{
+    if (!__atomic_load_n(&purify_page, __ATOMIC_ACQUIRE))
+    {
+        pthread_once(&purify_once, purify_init);
+    }
+}
+
+static void purify_install_handler(void)
+{
+    struct sigaction action;
+    if (purify_handler_installed)
+    {
+        return;
+    }
+    memset(&action, 0, sizeof(action));
+    action.sa_sigaction = purify_segv;
+    action.sa_flags = SA_SIGINFO;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGSEGV, &action, &purify_old_segv);
+    purify_handler_installed = 1;
+}
+
+static void purify_protect(char *lo, char *hi, int prot)
+{
+    if (lo < hi)
+    {
+        mprotect(lo, hi - lo, prot);
+        ++purify_counts.mprotect_calls;
+    }
+}
+
+/* Changes the guarded pages of w from [w->lo, w->hi) to [lo, hi), touching only pages that differ. */
+static void purify_reprotect(struct purify_watch *w, char *lo, char *hi, int prot)
+{
+    char *keep_lo = lo > w->lo ? lo : w->lo;
+    char *keep_hi = hi < w->hi ? hi : w->hi;
+    if (keep_lo >= keep_hi || prot != w->prot)
+    {
+        purify_protect(w->lo, w->hi, PROT_READ | PROT_WRITE);
+        purify_protect(lo, hi, prot);
+    }
+    else
+    {
+        purify_protect(w->lo, keep_lo, PROT_READ | PROT_WRITE);
+        purify_protect(keep_hi, w->hi, PROT_READ | PROT_WRITE);
+        purify_protect(lo, keep_lo, prot);
+        purify_protect(keep_hi, hi, prot);
+    }
+    purify_counts.protected_bytes += (hi > lo ? hi - lo : 0);
+    purify_counts.protected_bytes -= (w->hi > w->lo ? w->hi - w->lo : 0);
+    __atomic_store_n(&w->lo, lo, __ATOMIC_RELAXED);
+    __atomic_store_n(&w->hi, hi, __ATOMIC_RELAXED);
+    w->prot = prot;
+}
+
+static void purify_region(char *addr, size_t n, char **lo, char **hi)
+{
+    *lo = (char *) (((uintptr_t) addr + purify_page - 1) & ~(uintptr_t) (purify_page - 1));
+    *hi = (char *) (((uintptr_t) addr + n) & ~(uintptr_t) (purify_page - 1));
+    if (*hi < *lo)
+    {
+        *hi = *lo;
+    }
+}
+
+static int purify_prot(const char *mode)
+{
+    return mode && strchr(mode, 'r') ? PROT_NONE : PROT_READ;
+}
+
+static void purify_release(int watch)
 {
-    return 0;
+    struct purify_watch *w = &purify_watches[watch];
+    purify_reprotect(w, w->lo, w->lo, w->prot);
+    __atomic_store_n(&w->addr, (char *) 0, __ATOMIC_RELAXED);
+    w->next = purify_free;
+    purify_free = watch;
+    --purify_counts.watches;
 }
 
-void purify_watch_remove(int w)
+static int purify_add(char *addr, size_t n, int prot)
 {
+    struct purify_watch *w;
+    char *lo, *hi;
+    int watch;
+    if (purify_free != -1)
+    {
+        watch = purify_free;
+        purify_free = purify_watches[watch].next;
+    }
+    else if (purify_used < PURIFY_MAX_WATCHES)
+    {
+        watch = purify_used;
+        __atomic_store_n(&purify_used, watch + 1, __ATOMIC_RELEASE);
+    }
+    else
+    {
+        return -1;
+    }
+    purify_install_handler();
+    w = &purify_watches[watch];
+    purify_region(addr, n, &lo, &hi);
+    __atomic_store_n(&w->n, n, __ATOMIC_RELAXED);
+    __atomic_store_n(&w->lo, lo, __ATOMIC_RELAXED);
+    __atomic_store_n(&w->hi, hi, __ATOMIC_RELAXED);
+    __atomic_store_n(&w->addr, addr, __ATOMIC_RELAXED);
+    w->prot = prot;
+    purify_protect(lo, hi, prot);
+    purify_counts.protected_bytes += hi - lo;
+    ++purify_counts.watches;
+    return watch;
 }
+
+int purify_watch_n(char *addr, size_t n, char *mode)
+{
+    int watch = -1;
+    purify_start();
+    if (purify_get_mode() != purify_off && n)
+    {
+        pthread_mutex_lock(&purify_lock);
+        watch = purify_add(addr, n, purify_prot(mode));
+        pthread_mutex_unlock(&purify_lock);
+    }
+    return watch;
+}
+
+void purify_watch_remove(int watch)
+{
+    if (watch < 0 || watch >= PURIFY_MAX_WATCHES)
+    {
+        return;
+    }
+    pthread_mutex_lock(&purify_lock);
+    if (__atomic_load_n(&purify_watches[watch].addr, __ATOMIC_RELAXED))
+    {
+        purify_release(watch);
+    }
+    pthread_mutex_unlock(&purify_lock);
+}
+
+int purify_watch_move(int watch, char *addr, size_t n, char *mode)
+{
+    enum purify_mode current;
+    purify_start();
+    current = purify_get_mode();
+    if (watch < 0 || watch >= PURIFY_MAX_WATCHES)
+    {
+        return current != purify_off ? purify_watch_n(addr, n, mode) : -1;
+    }
+    if (current == purify_amortised && n)
+    {
+        /*
+         * Only the owner of a watch moves or removes it, so when the same
+         * pages stay guarded the entry can be updated without the lock. The
+         * pages stay right whatever the mode changes to meanwhile; the next
+         * move that needs the lock catches up with it.
+         */
+        struct purify_watch *w = &purify_watches[watch];
+        char *lo, *hi;
+        purify_region(addr, n, &lo, &hi);
+        if (__atomic_load_n(&w->addr, __ATOMIC_RELAXED) && lo == __atomic_load_n(&w->lo, __ATOMIC_RELAXED)
+            && hi == __atomic_load_n(&w->hi, __ATOMIC_RELAXED) && purify_prot(mode) == w->prot)
+        {
+            __atomic_store_n(&w->n, n, __ATOMIC_RELAXED);
+            __atomic_store_n(&w->addr, addr, __ATOMIC_RELAXED);
+            return watch;
+        }
+    }
+    pthread_mutex_lock(&purify_lock);
+    current = purify_get_mode();
+    if (!__atomic_load_n(&purify_watches[watch].addr, __ATOMIC_RELAXED))
+    {
+        watch = -1;
+    }
+    else if (current != purify_amortised || !n)
+    {
+        purify_release(watch);
+        watch = current != purify_off && n ? purify_add(addr, n, purify_prot(mode)) : -1;
+    }
+    else
+    {
+        struct purify_watch *w = &purify_watches[watch];
+        char *lo, *hi;
+        purify_region(addr, n, &lo, &hi);
+        purify_reprotect(w, lo, hi, purify_prot(mode));
+        __atomic_store_n(&w->n, n, __ATOMIC_RELAXED);
+        __atomic_store_n(&w->addr, addr, __ATOMIC_RELAXED);
+    }
+    pthread_mutex_unlock(&purify_lock);
+    return watch;
+}
+
+void purify_set_mode(enum purify_mode mode)
+{
+    purify_start();
+    pthread_mutex_lock(&purify_lock);
+    __atomic_store_n(&purify_current, mode, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&purify_lock);
+}
+
+enum purify_mode purify_get_mode(void)
+{
+    purify_start();
+    return __atomic_load_n(&purify_current, __ATOMIC_RELAXED);
+}
+
+void purify_get_stats(struct purify_stats *stats)
+{
+    pthread_mutex_lock(&purify_lock);
+    *stats = purify_counts;
+    pthread_mutex_unlock(&purify_lock);
+}
+
+#else
+
+int purify_watch_n(char *addr, size_t n, char *mode)
+{
+    (void) addr;
+    (void) n;
+    (void) mode;
+    return -1;
+}
+
+void purify_watch_remove(int watch)
+{
+    (void) watch;
+}
+
+int purify_watch_move(int watch, char *addr, size_t n, char *mode)
+{
+    (void) watch;
+    (void) addr;
+    (void) n;
+    (void) mode;
+    return -1;
+}
+
+void purify_set_mode(enum purify_mode mode)
+{
+    (void) mode;
+}
+
+enum purify_mode purify_get_mode(void)
+{
+    return purify_off;
+}
+
+void purify_get_stats(struct purify_stats *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+}
+
+#endif
@@ -31,8 +31,52 @@ extern "C"
 {
 #endif
 
-    int purify_watch_n(char *, size_t, char *);
-    void purify_watch_remove(int);
+    /*
+     * Containers watch their unused capacity so stray accesses to it fault.
+     * On Linux the watched region is guarded with mprotect: every whole page
+     * inside it is made inaccessible ("rw") or read-only ("w"), and a SIGSEGV
+     * handler reports accesses to it on stderr before the process dies.
+     * Elsewhere, or with purify_off, nothing is watched.
+     */
+    enum purify_mode
+    {
+        purify_off,       /* watch nothing; the default unless PURIFY_MODE is set */
+        purify_exact,     /* every update unprotects and protects the whole region */
+        purify_amortised  /* updates only change pages that enter or leave the region */
+    };
+
+    struct purify_stats
+    {
+        size_t watches;         /* live watches */
+        size_t protected_bytes; /* bytes in guarded pages */
+        size_t mprotect_calls;  /* since start */
+    };
+
+    /*
+     * Watches n bytes at addr for the accesses in mode ("rw" or "w").
+     * Returns the watch to pass to purify_watch_remove, or -1 if nothing is
+     * watched.
+     */
+    int purify_watch_n(char *addr, size_t n, char *mode);
+    void purify_watch_remove(int watch);
+
+    /*
+     * Replaces the region of watch (which may be -1) by n bytes at addr and
+     * returns the new watch. A container growing or shrinking in place calls
+     * it once per update, before touching the memory that leaves the region;
+     * in amortised mode that costs a system call only when a page boundary
+     * is crossed.
+     */
+    int purify_watch_move(int watch, char *addr, size_t n, char *mode);
+
+    /*
+     * The mode is read from the PURIFY_MODE environment variable ("exact" or
+     * "amortised") at the first call. Existing watches keep working when it
+     * changes.
+     */
+    void purify_set_mode(enum purify_mode mode);
+    enum purify_mode purify_get_mode(void);
+    void purify_get_stats(struct purify_stats *stats);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,78 @@
+//
+// Copyright (c) 2014 Jakub Jabłoński
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "mfbench.h"
+#include "mfvector.h"
+#include "purify.h"
+
+static const char* mode_names[] = { "off", "exact", "amortised" };
+
+/**
+ * Cost of guarding the unused capacity of an mfvector while filling it
+ * with push_back, for each purify mode, against an unguarded std::vector.
+ * The mprotect_per_push counter shows how often a push crossed into a
+ * system call. Exact mode makes one or two per push, so it fills a much
+ * smaller vector (still spanning several whole pages) to keep a full mfbench
+ * run short; items per second stay comparable.
+ */
+MFBENCH(purify)
+{
+	static const std::size_t n = 1 << 20;
+	static const std::size_t exact_n = 1 << 14;
+	std::vector<int> ref;
+	ref.reserve(n);
+	b.run("std_vector", n, n * sizeof(int), [&] {
+		ref.clear();
+		for (std::size_t i = 0; i < n; ++i)
+		{
+			ref.push_back(int(i));
+		}
+		mfbench_keep(ref.back());
+	});
+
+	purify_mode old = purify_get_mode();
+	for (int m = purify_off; m <= purify_amortised; ++m)
+	{
+		purify_set_mode(purify_mode(m));
+		std::size_t count = m == purify_exact ? exact_n : n;
+		mfvector<int> v(count);
+		purify_stats before, after;
+		std::size_t runs = 0;
+		purify_get_stats(&before);
+		mfbench::result& r = b.run(std::string("mfvector/") + mode_names[m], count, count * sizeof(int), [&] {
+			v.clear();
+			for (std::size_t i = 0; i < count; ++i)
+			{
+				v.push_back(int(i));
+			}
+			mfbench_keep(v[count - 1]);
+			++runs;
+		});
+		purify_get_stats(&after);
+		r.counter("mprotect_per_push", double(after.mprotect_calls - before.mprotect_calls) / (double(runs) * count));
+	}
+	purify_set_mode(old);
+}
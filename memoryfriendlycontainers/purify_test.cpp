@@ -0,0 +1,140 @@
+//
+// Copyright (c) 2014 Jakub Jabłoński
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+
+#include <cstddef>
+#include <vector>
+
+#include <unistd.h>
+
+#include "mfvector.h"
+#include "purify.h"
+#include "gtest/gtest.h"
+
+#if defined(__linux__)
+
+class PurifyTest : public ::testing::TestWithParam<purify_mode>
+{
+protected:
+    PurifyTest() : page(sysconf(_SC_PAGESIZE)), old(purify_get_mode())
+    {
+        purify_set_mode(GetParam());
+        purify_get_stats(&before);
+    }
+    
+    ~PurifyTest()
+    {
+        purify_set_mode(old);
+    }
+    
+    std::size_t calls() const
+    {
+        purify_stats now;
+        purify_get_stats(&now);
+        return now.mprotect_calls - before.mprotect_calls;
+    }
+    
+    std::size_t page;
+    purify_mode old;
+    purify_stats before;
+};
+
+TEST_P(PurifyTest, WatchRemove)
+{
+    std::vector<char> buffer(8 * page);
+    char* p = &buffer[0];
+    
+    purify_stats s;
+    int w = purify_watch_n(p + 1, page, (char *) "rw");
+    purify_get_stats(&s);
+    EXPECT_EQ(before.protected_bytes, s.protected_bytes) << "no whole page inside";
+    p[1] = 1;
+    purify_watch_remove(w);
+    
+    w = purify_watch_n(p, 8 * page, (char *) "rw");
+    ASSERT_NE(-1, w);
+    purify_get_stats(&s);
+    EXPECT_EQ(before.watches + 1, s.watches);
+    EXPECT_GE(s.protected_bytes - before.protected_bytes, 6 * page);
+    
+    w = purify_watch_move(w, p + 4 * page, 4 * page, (char *) "w");
+    purify_get_stats(&s);
+    EXPECT_EQ(before.watches + 1, s.watches);
+    EXPECT_LE(s.protected_bytes - before.protected_bytes, 4 * page);
+    EXPECT_EQ(0, p[5 * page]) << "readable with \"w\"";
+    
+    purify_watch_remove(w);
+    purify_get_stats(&s);
+    EXPECT_EQ(before.watches, s.watches);
+    EXPECT_EQ(before.protected_bytes, s.protected_bytes);
+}
+
+TEST_P(PurifyTest, VectorPushBack)
+{
+    std::size_t n = 64 * page;
+    mfvector<char> v(n);
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        v.push_back(char(i));
+    }
+    EXPECT_EQ(n, v.size());
+    EXPECT_EQ(char(n - 1), v[n - 1]);
+    if (GetParam() == purify_amortised)
+    {
+        // one mprotect per page left behind, plus the initial watch
+        EXPECT_LE(calls(), 64 + 2);
+    }
+    else
+    {
+        EXPECT_GE(calls(), n);
+    }
+}
+
+TEST_P(PurifyTest, VectorAppendGrow)
+{
+    mfvector<int, mfgrowth_geometric> v(page / sizeof(int));
+    std::vector<int> chunk(3 * page, 7);
+    for (int i = 0; i < 4; ++i)
+    {
+        v.append(chunk.begin(), chunk.end());
+        v.push_back(i);
+    }
+    EXPECT_EQ(4 * (chunk.size() + 1), v.size());
+    EXPECT_EQ(3, v[v.size() - 1]);
+    v.clear();
+    v.shrink_to_fit();
+    purify_stats s;
+    purify_get_stats(&s);
+    EXPECT_EQ(before.protected_bytes, s.protected_bytes);
+}
+
+TEST_P(PurifyTest, OverflowFaults)
+{
+    ::testing::FLAGS_gtest_death_test_style = "threadsafe";
+    mfvector<char> v(4 * page);
+    v.push_back('a');
+    EXPECT_DEATH(v.begin()[2 * page] = 'x', "purify: access to .* bytes into watched region");
+}
+
+INSTANTIATE_TEST_CASE_P(Modes, PurifyTest, ::testing::Values(purify_exact, purify_amortised));
+
+#endif
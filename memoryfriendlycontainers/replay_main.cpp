@@ -0,0 +1,200 @@
+//
+// Copyright (c) 2014 Jakub Jabłoński
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "mfhashmapsc.h"
+#include "mftrace.h"
+
+/*
+ * Replays a trace recorded with mfhashmapsc::set_trace against several maps
+ * and prints their throughput and latency percentiles.
+ */
+
+/** mfhashmapsc keyed by the traced hashes; present keys map to 1, none_ is 0. */
+struct hashmap_replay
+{
+	mfhashmapsc<std::uint64_t, unsigned char> map;
+
+	explicit hashmap_replay(std::size_t capacity) : map(capacity)
+	{}
+
+	bool insert(std::uint64_t key)
+	{
+		if (map[key])
+		{
+			return false;
+		}
+		std::size_t n = map.size();
+		map.insert(key, 1);
+		return map.size() != n;
+	}
+
+	bool find(std::uint64_t key)
+	{
+		return map[key] != 0;
+	}
+
+	/** mfhashmapsc can't erase; the entry stays. */
+	bool erase(std::uint64_t)
+	{
+		return false;
+	}
+};
+
+struct unordered_replay
+{
+	std::unordered_map<std::uint64_t, unsigned char> map;
+
+	bool insert(std::uint64_t key)
+	{
+		return map.insert(std::make_pair(key, 1)).second;
+	}
+
+	bool find(std::uint64_t key)
+	{
+		return map.count(key) != 0;
+	}
+
+	bool erase(std::uint64_t key)
+	{
+		return map.erase(key) != 0;
+	}
+};
+
+static bool csv = false;
+
+static const char* const op_names[mftrace_ops] = { "insert", "find", "erase" };
+
+static void usage(const char* argv0)
+{
+	std::fprintf(stderr, "usage: %s [--csv] [--capacity=entries] trace\n", argv0);
+}
+
+static void report(const char* map, const mftrace_replay_result& r, std::size_t ops)
+{
+	for (std::size_t k = 0; k < mftrace_ops; ++k)
+	{
+		const mftrace_latency& l = r.latency[k];
+		if (!l.count)
+		{
+			continue;
+		}
+		if (csv)
+		{
+			std::printf("%s,%.0f,%.4f,%s,%zu,%.1f,%.1f,%.1f,%.1f,%.1f\n", map, r.ops_per_second, ops ? double(r.hits) / ops : 0.0,
+			            op_names[k], l.count, l.p50, l.p90, l.p99, l.p999, l.max);
+		}
+		else
+		{
+			std::printf("%-22s %12.0f %7.3f  %-7s %10zu %8.1f %8.1f %8.1f %8.1f %10.1f\n", map, r.ops_per_second,
+			            ops ? double(r.hits) / ops : 0.0, op_names[k], l.count, l.p50, l.p90, l.p99, l.p999, l.max);
+		}
+	}
+}
+
+int main(int argc, char **argv)
+{
+	const char* path = 0;
+	std::size_t capacity = 0;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (!std::strcmp(argv[i], "--csv"))
+		{
+			csv = true;
+		}
+		else if (!std::strncmp(argv[i], "--capacity=", 11))
+		{
+			capacity = std::strtoul(argv[i] + 11, 0, 10);
+		}
+		else if (argv[i][0] != '-' && !path)
+		{
+			path = argv[i];
+		}
+		else
+		{
+			usage(argv[0]);
+			return 1;
+		}
+	}
+	if (!path)
+	{
+		usage(argv[0]);
+		return 1;
+	}
+
+	std::vector<mftrace_record> ops;
+	if (!mftrace_load(path, ops))
+	{
+		std::fprintf(stderr, "%s: can't read trace %s\n", argv[0], path);
+		return 1;
+	}
+
+	std::size_t counts[mftrace_ops] = { 0, 0, 0 };
+	std::size_t hits = 0;
+	double duration_ns = 0;
+	std::unordered_set<std::uint64_t> inserted;
+	for (std::size_t i = 0; i < ops.size(); ++i)
+	{
+		++counts[ops[i].op];
+		hits += ops[i].hit;
+		duration_ns += ops[i].delta_ns;
+		if (ops[i].op == mftrace_insert)
+		{
+			inserted.insert(ops[i].key);
+		}
+	}
+	if (!capacity)
+	{
+		capacity = std::max<std::size_t>(inserted.size(), 1);
+	}
+
+	if (csv)
+	{
+		std::printf("map,ops_per_second,hit_ratio,op,count,p50_ns,p90_ns,p99_ns,p999_ns,max_ns\n");
+	}
+	else
+	{
+		std::printf("%s: %zu operations (%zu inserts, %zu finds, %zu erases), %zu keys inserted, %.3f hit ratio, %.3f s recorded\n",
+		            path, ops.size(), counts[mftrace_insert], counts[mftrace_find], counts[mftrace_erase], inserted.size(),
+		            ops.empty() ? 0.0 : double(hits) / ops.size(), duration_ns * 1e-9);
+		std::printf("%-22s %12s %7s  %-7s %10s %8s %8s %8s %8s %10s\n", "map", "ops/s", "hits", "op", "count", "p50 ns",
+		            "p90 ns", "p99 ns", "p99.9 ns", "max ns");
+	}
+
+	char name[64];
+	for (std::size_t factor = 1; factor <= 2; ++factor)
+	{
+		std::size_t n = capacity * factor;
+		std::snprintf(name, sizeof(name), "mfhashmapsc/%zu", n);
+		report(name, mftrace_replay(ops, [n] { return hashmap_replay(n); }), ops.size());
+	}
+	report("unordered_map", mftrace_replay(ops, [] { return unordered_replay(); }), ops.size());
+	return 0;
+}